@@ -0,0 +1,132 @@
+#ifndef CLINIC_ARENA_H
+#define CLINIC_ARENA_H
+
+// Арена объектов одного типа (--arena). Все ячейки выделяются одним блоком
+// заранее, каждая выровнена по кэш-линии, чтобы соседние пациенты не делили
+// линию между потоками. Свободные ячейки лежат в lock-free стеке Трайбера:
+// голова - 64-битное слово (номер ячейки + счетчик версий против ABA), так
+// что взять и вернуть ячейку можно из любого потока без мьютексов. Ячейка
+// освобождается при уходе пациента и сразу доступна следующему, поэтому при
+// открытом потоке пациентов (-arrival) хватает арены размером с наибольшее
+// число пациентов в клинике одновременно. Если свободных ячеек нет, объект
+// создается в куче обычным new - такие выделения считаются отдельно.
+
+#include <atomic>  // Подключаем атомарные операции (std::atomic)
+#include <cstddef> // Подключаем size_t
+#include <cstdint> // Подключаем целые фиксированного размера
+#include <new>     // Подключаем размещающий new
+
+#include "ClinicMpmcQueue.h" // Подключаем CLINIC_CACHE_LINE
+
+template <typename T> class ObjectArena {
+public:
+  ObjectArena()
+      : slots_(NULL), capacity_(0), owned_(false), head_(0), arenaAllocs_(0),
+        heapAllocs_(0), inUse_(0), peakInUse_(0) {}
+  ~ObjectArena() { release_block(); }
+
+  // Выделение capacity ячеек одним блоком (0 - без арены, все в куче)
+  void init(size_t capacity) {
+    release_block();
+    slots_ = capacity > 0 ? new Slot[capacity] : NULL;
+    owned_ = true;
+    reset(capacity);
+  }
+
+  // Ячейки во внешнем блоке не меньше block_bytes(capacity) байт, выровненном
+  // по кэш-линии (например, в памяти нужного узла NUMA); арена его не
+  // освобождает
+  void init(size_t capacity, void *memory) {
+    release_block();
+    slots_ = (Slot *)memory;
+    owned_ = false;
+    for (size_t i = 0; i < capacity; i++) {
+      new (&slots_[i]) Slot(); // Ячейки в чужой памяти
+    }
+    reset(capacity);
+  }
+
+  static size_t block_bytes(size_t capacity) {
+    return capacity * sizeof(Slot);
+  }
+
+  // Новый объект: из свободной ячейки арены или из кучи
+  T *acquire() {
+    int used = inUse_.fetch_add(1, std::memory_order_relaxed) + 1;
+    int peak = peakInUse_.load(std::memory_order_relaxed);
+    while (used > peak && !peakInUse_.compare_exchange_weak(
+                              peak, used, std::memory_order_relaxed)) {
+    } // Обновляем максимум
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while ((uint32_t)head != 0) { // Пока есть свободные ячейки
+      Slot &slot = slots_[(uint32_t)head - 1]; // Верхняя свободная ячейка
+      uint64_t next = ((head >> 32) + 1) << 32 |
+                      slot.next.load(std::memory_order_relaxed);
+      if (head_.compare_exchange_weak(head, next, std::memory_order_acquire,
+                                      std::memory_order_acquire)) {
+        arenaAllocs_.fetch_add(1, std::memory_order_relaxed);
+        return new (slot.storage) T(); // Создаем объект в ячейке
+      }
+    }
+    heapAllocs_.fetch_add(1, std::memory_order_relaxed);
+    return new T(); // Арена занята целиком
+  }
+
+  // Возврат объекта: ячейка снова свободна, объект из кучи удаляется
+  void release(T *obj) {
+    inUse_.fetch_sub(1, std::memory_order_relaxed);
+    Slot *slot = reinterpret_cast<Slot *>(obj); // storage - начало ячейки
+    if (slots_ == NULL || slot < slots_ || slot >= slots_ + capacity_) {
+      delete obj; // Объект из кучи
+      return;
+    }
+    obj->~T();
+    uint32_t index = (uint32_t)(slot - slots_) + 1; // Номер ячейки с 1
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    do {
+      slot->next.store((uint32_t)head, std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(
+        head, ((head >> 32) + 1) << 32 | index, std::memory_order_release,
+        std::memory_order_relaxed));
+  }
+
+  size_t capacity() const { return capacity_; }
+  uint64_t arena_allocs() const { return arenaAllocs_.load(); }
+  uint64_t heap_allocs() const { return heapAllocs_.load(); }
+  int peak_in_use() const { return peakInUse_.load(); }
+
+private:
+  struct alignas(CLINIC_CACHE_LINE) Slot {
+    alignas(T) unsigned char storage[sizeof(T)]; // Место под объект
+    std::atomic<uint32_t> next; // Следующая свободная ячейка (с 1, 0 - нет)
+  };
+
+  void release_block() {
+    if (owned_) {
+      delete[] slots_;
+    }
+    slots_ = NULL;
+    owned_ = false;
+  }
+
+  // Все capacity ячеек свободны
+  void reset(size_t capacity) {
+    capacity_ = capacity;
+    for (size_t i = 0; i < capacity; i++) { // Все ячейки свободны
+      slots_[i].next.store(i + 1 < capacity ? (uint32_t)(i + 2) : 0,
+                           std::memory_order_relaxed);
+    }
+    head_.store(capacity > 0 ? 1 : 0, std::memory_order_relaxed);
+  }
+
+  Slot *slots_;                       // Ячейки арены
+  size_t capacity_;                   // Число ячеек
+  bool owned_;                        // Блок выделен ареной
+  std::atomic<uint64_t> head_;        // Версия << 32 | верхняя свободная
+  std::atomic<uint64_t> arenaAllocs_; // Объектов, созданных в арене
+  std::atomic<uint64_t> heapAllocs_;  // Объектов, созданных в куче
+  std::atomic<int> inUse_;            // Объектов сейчас
+  std::atomic<int> peakInUse_;        // Наибольшее число объектов
+};
+
+#endif // CLINIC_ARENA_H
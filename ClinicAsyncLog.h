@@ -0,0 +1,201 @@
+#ifndef CLINIC_ASYNC_LOG_H
+#define CLINIC_ASYNC_LOG_H
+
+// Асинхронный пакетный логгер (--log=async). Поток, вызвавший log_event(),
+// только форматирует сообщение один раз в запись своего кольцевого буфера
+// (один производитель - один потребитель, без блокировок) и берет номер из
+// общего атомарного счетчика. Отдельный поток-писатель собирает записи из всех
+// буферов, восстанавливает по номерам исходный порядок, дописывает метку
+// времени и выводит накопленное большими вызовами write(2) в файл и, если
+// нужно, в консоль.
+
+#include <algorithm> // Подключаем std::min
+#include <atomic>    // Подключаем атомарные операции (std::atomic)
+#include <cstdarg>   // Подключаем va_list
+#include <cstdint>   // Подключаем целые фиксированного размера
+#include <cstdio>    // Подключаем vsnprintf
+#include <cstring>   // Подключаем memcpy
+#include <functional> // Подключаем std::greater
+#include <pthread.h> // Подключаем потоки POSIX для потока-писателя
+#include <queue>     // Подключаем std::priority_queue
+#include <unistd.h>  // Подключаем write(2) и usleep
+#include <vector>    // Подключаем std::vector
+
+const int ASYNC_LOG_TEXT = 240;    // Максимальная длина сообщения (байт)
+const int ASYNC_LOG_RING = 64;     // Записей в буфере одного потока
+const int ASYNC_LOG_BATCH = 65536; // Размер пакета для write(2) (байт)
+
+// Одна запись лога
+struct AsyncLogRecord {
+  uint64_t seq;              // Порядковый номер сообщения
+  int64_t ms;                // Время события (мс с начала программы)
+  uint32_t len;              // Длина текста
+  char text[ASYNC_LOG_TEXT]; // Отформатированный текст сообщения
+};
+
+// Кольцевой буфер записей одного потока. Когда поток завершается, буфер
+// освобождается и достается следующему новому потоку, поэтому при модели
+// "поток на пациента" буферов столько, сколько потоков пишет одновременно.
+struct AsyncLogBuffer {
+  AsyncLogRecord ring[ASYNC_LOG_RING]; // Кольцо записей
+  std::atomic<uint64_t> head;  // Сколько записей опубликовал производитель
+  std::atomic<uint64_t> tail;  // Сколько записей забрал писатель
+  std::atomic<bool> owned;     // Занят ли буфер каким-либо потоком
+  AsyncLogBuffer *next;        // Следующий буфер в реестре
+};
+
+std::atomic<AsyncLogBuffer *> asyncLogBuffers(NULL); // Реестр буферов
+std::atomic<uint64_t> asyncLogSeq(0); // Счетчик номеров сообщений
+std::atomic<bool> asyncLogStop(false); // Флаг остановки писателя
+int asyncLogFileFd = -1;   // Дескриптор файла лога
+bool asyncLogConsole = true; // Дублировать ли лог в консоль
+pthread_t asyncLogWriter;  // Поток-писатель
+
+// Владение буфером текущего потока: при выходе из потока буфер освобождается
+struct AsyncLogOwner {
+  AsyncLogBuffer *buffer = NULL; // Буфер текущего потока
+  ~AsyncLogOwner() {
+    if (buffer) {
+      buffer->owned.store(false, std::memory_order_release); // Отдаем буфер
+    }
+  }
+};
+thread_local AsyncLogOwner asyncLogOwner; // Буфер текущего потока
+
+// Буфер текущего потока: берем свободный из реестра или создаем новый
+inline AsyncLogBuffer *async_log_buffer() {
+  if (asyncLogOwner.buffer) {
+    return asyncLogOwner.buffer;
+  }
+  for (AsyncLogBuffer *b = asyncLogBuffers.load(std::memory_order_acquire); b;
+       b = b->next) {
+    bool expected = false;
+    if (b->owned.compare_exchange_strong(expected, true,
+                                         std::memory_order_acquire)) {
+      return asyncLogOwner.buffer = b; // Нашли свободный буфер
+    }
+  }
+  AsyncLogBuffer *b = new AsyncLogBuffer(); // Свободных нет - создаем
+  b->head.store(0, std::memory_order_relaxed);
+  b->tail.store(0, std::memory_order_relaxed);
+  b->owned.store(true, std::memory_order_relaxed);
+  b->next = asyncLogBuffers.load(std::memory_order_relaxed);
+  while (!asyncLogBuffers.compare_exchange_weak(
+      b->next, b, std::memory_order_release, std::memory_order_relaxed)) {
+  } // Добавляем в голову реестра
+  return asyncLogOwner.buffer = b;
+}
+
+// Публикация сообщения (вызывается из log_event вместо printf/fprintf)
+inline void async_log_vsubmit(int64_t ms, const char *fmt, va_list args) {
+  AsyncLogBuffer *b = async_log_buffer(); // Буфер текущего потока
+  uint64_t head = b->head.load(std::memory_order_relaxed);
+  while (head - b->tail.load(std::memory_order_acquire) >= ASYNC_LOG_RING) {
+    usleep(50); // Буфер полон - ждем, пока писатель его разберет
+  }
+  AsyncLogRecord &r = b->ring[head % ASYNC_LOG_RING]; // Свободная запись
+  int len = vsnprintf(r.text, ASYNC_LOG_TEXT, fmt, args); // Форматируем
+  r.len = len < 0 ? 0 : std::min(len, ASYNC_LOG_TEXT - 1);
+  r.ms = ms;
+  r.seq = asyncLogSeq.fetch_add(1, std::memory_order_relaxed); // Номер
+  b->head.store(head + 1, std::memory_order_release); // Публикуем запись
+}
+
+// Запись всего пакета в дескриптор (write может записать не все сразу)
+inline void async_log_write_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(fd, data, size);
+    if (n <= 0) {
+      return; // Ошибка записи - пакет теряется, как и при fprintf
+    }
+    data += n;
+    size -= n;
+  }
+}
+
+// Сброс накопленного пакета в файл и консоль
+inline void async_log_flush(std::vector<char> &batch) {
+  if (batch.empty()) {
+    return;
+  }
+  if (asyncLogFileFd >= 0) {
+    async_log_write_all(asyncLogFileFd, batch.data(), batch.size());
+  }
+  if (asyncLogConsole) {
+    async_log_write_all(STDOUT_FILENO, batch.data(), batch.size());
+  }
+  batch.clear();
+}
+
+// Добавление записи в пакет с меткой времени "[mm:ss:mmm] "
+inline void async_log_append(std::vector<char> &batch,
+                             const AsyncLogRecord &r) {
+  int minutes = (int)(r.ms / 60000);       // Минуты
+  int seconds = (int)((r.ms / 1000) % 60); // Секунды
+  int millis = (int)(r.ms % 1000);         // Миллисекунды
+  char stamp[32];
+  int n = snprintf(stamp, sizeof(stamp), "[%02d:%02d:%03d] ", minutes, seconds,
+                   millis);
+  batch.insert(batch.end(), stamp, stamp + n);
+  batch.insert(batch.end(), r.text, r.text + r.len);
+  if (batch.size() >= (size_t)ASYNC_LOG_BATCH) {
+    async_log_flush(batch); // Пакет набран - пишем
+  }
+}
+
+struct AsyncLogSeqGreater { // Порядок записей в куче писателя
+  bool operator()(const AsyncLogRecord &a, const AsyncLogRecord &b) const {
+    return a.seq > b.seq;
+  }
+};
+
+// Поток-писатель: собирает записи и выводит их строго по номерам
+inline void *async_log_writer_thread(void *) {
+  std::priority_queue<AsyncLogRecord, std::vector<AsyncLogRecord>,
+                      AsyncLogSeqGreater>
+      pending;           // Записи, пришедшие раньше предыдущих номеров
+  uint64_t nextSeq = 0;  // Номер следующей записи для вывода
+  std::vector<char> batch;
+  batch.reserve(ASYNC_LOG_BATCH + ASYNC_LOG_TEXT + 32);
+
+  while (true) {
+    bool stopping = asyncLogStop.load(std::memory_order_acquire);
+    int drained = 0; // Сколько записей собрано за проход
+    for (AsyncLogBuffer *b = asyncLogBuffers.load(std::memory_order_acquire);
+         b; b = b->next) {
+      uint64_t tail = b->tail.load(std::memory_order_relaxed);
+      uint64_t head = b->head.load(std::memory_order_acquire);
+      for (; tail < head; tail++, drained++) {
+        pending.push(b->ring[tail % ASYNC_LOG_RING]); // Забираем запись
+      }
+      b->tail.store(tail, std::memory_order_release); // Освобождаем место
+    }
+    while (!pending.empty() && pending.top().seq == nextSeq) {
+      async_log_append(batch, pending.top()); // Выводим по порядку
+      pending.pop();
+      nextSeq++;
+    }
+    async_log_flush(batch); // Пишем все, что набралось за проход
+    if (stopping && drained == 0 && pending.empty()) {
+      return NULL; // Все производители закончили и все выведено
+    }
+    if (drained == 0) {
+      usleep(500); // Новых записей нет - даем им накопиться
+    }
+  }
+}
+
+// Запуск писателя
+inline void async_log_start(int file_fd, bool console) {
+  asyncLogFileFd = file_fd;
+  asyncLogConsole = console;
+  pthread_create(&asyncLogWriter, NULL, async_log_writer_thread, NULL);
+}
+
+// Остановка писателя: дописывает все опубликованные записи
+inline void async_log_stop() {
+  asyncLogStop.store(true, std::memory_order_release);
+  pthread_join(asyncLogWriter, NULL);
+}
+
+#endif // CLINIC_ASYNC_LOG_H
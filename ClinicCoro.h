@@ -0,0 +1,294 @@
+#ifndef CLINIC_CORO_H
+#define CLINIC_CORO_H
+
+// Сопрограммы C++20 для --engine=coro. Пациенты, дежурные врачи и
+// специалисты - сопрограммы CoroTask, которые CoroScheduler выполняет на
+// небольшом пуле потоков (M сопрограмм на N потоков). Где поток спал бы в
+// pthread_cond_wait или sleep(), сопрограмма приостанавливается:
+//   CoroChannel - очередь с ожиданием: co_await pop() ждет элемента или
+//                 закрытия очереди (тогда возвращает T())
+//   CoroEvent   - одноразовое событие "пациент вылечен"
+//   sleep_for   - таймер вместо sleep(t_d) / sleep(t_s) на колесе таймеров
+//                 (ClinicTimerWheel.h): занятый врач не держит поток, и
+//                 тысячи одновременных приемов обслуживают несколько потоков
+// Приостановленная сопрограмма - это только ее кадр в куче (сотни байт), так
+// что миллион одновременно ждущих пациентов не требует миллиона потоков.
+// Сопрограммы есть только при сборке с -std=c++20: тогда заголовок определяет
+// CLINIC_HAVE_CORO.
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define CLINIC_HAVE_CORO 1
+
+#include <atomic>     // Подключаем атомарные операции (std::atomic)
+#include <coroutine>  // Подключаем std::coroutine_handle
+#include <cstdint>    // Подключаем целые фиксированного размера
+#include <ctime>      // Подключаем clock_gettime
+#include <deque>      // Подключаем std::deque
+#include <exception>  // Подключаем std::terminate
+#include <pthread.h>  // Подключаем потоки POSIX для пула
+#include <vector>     // Подключаем std::vector
+
+#include "ClinicTimerWheel.h" // Подключаем колесо таймеров
+#include "ClinicTriage.h"     // Подключаем TriageQueue
+
+class CoroScheduler;
+
+// Сопрограмма-актор. Создается приостановленной, запускается через
+// CoroScheduler::spawn, кадр освобождается сам после завершения.
+struct CoroTask {
+  struct promise_type {
+    CoroScheduler *sched = nullptr; // Планировщик, выполняющий задачу
+
+    CoroTask get_return_object() {
+      return CoroTask{
+          std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void(); // Задача закончилась (определено ниже)
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  std::coroutine_handle<promise_type> handle; // Кадр сопрограммы
+};
+
+const uint64_t CORO_TICK_NS = 100000; // Тик колеса таймеров (0.1 мс)
+
+// Планировщик: очередь готовых сопрограмм и колесо таймеров под одним
+// мьютексом. Свободный поток пула берет готовую сопрограмму, а если таких
+// нет - спит до ближайшего занятого тика колеса. run() возвращается, когда
+// завершились все задачи.
+class CoroScheduler {
+public:
+  CoroScheduler() : timers_(CORO_TICK_NS, now_ns()), live_(0) {
+    pthread_condattr_t attr; // Условная переменная на монотонных часах
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wake_, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&lock_, NULL);
+  }
+  ~CoroScheduler() {
+    pthread_cond_destroy(&wake_);
+    pthread_mutex_destroy(&lock_);
+  }
+
+  // Текущее время по монотонным часам (нс)
+  static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+
+  // Запуск новой задачи: она встает в очередь готовых
+  void spawn(CoroTask task) {
+    task.handle.promise().sched = this;
+    pthread_mutex_lock(&lock_);
+    live_++;
+    ready_.push_back(task.handle);
+    pthread_cond_signal(&wake_);
+    pthread_mutex_unlock(&lock_);
+  }
+
+  // Продолжение приостановленной сопрограммы на любом потоке пула
+  void schedule(std::coroutine_handle<> h) {
+    pthread_mutex_lock(&lock_);
+    ready_.push_back(h);
+    pthread_cond_signal(&wake_);
+    pthread_mutex_unlock(&lock_);
+  }
+
+  // Продолжение сопрограммы в момент due (нс по now_ns)
+  void schedule_at(uint64_t due, std::coroutine_handle<> h) {
+    pthread_mutex_lock(&lock_);
+    timers_.add(due, h); // O(1) при любом числе ожидающих приемов
+    pthread_cond_signal(&wake_); // Спящий поток пересчитает срок сна
+    pthread_mutex_unlock(&lock_);
+  }
+
+  // Ожидание до момента due: co_await sched.sleep_until(due)
+  struct SleepAwaiter {
+    CoroScheduler *sched; // Планировщик с таймерами
+    uint64_t due;         // Момент пробуждения (нс)
+
+    bool await_ready() const { return due <= now_ns(); }
+    void await_suspend(std::coroutine_handle<> h) {
+      sched->schedule_at(due, h);
+    }
+    void await_resume() const {}
+  };
+  SleepAwaiter sleep_until(uint64_t due) { return SleepAwaiter{this, due}; }
+  SleepAwaiter sleep_for(double ms) {
+    return SleepAwaiter{this, now_ns() + (uint64_t)(ms * 1000000.0)};
+  }
+
+  // Выполнение задач на workers потоках до завершения всех задач
+  void run(int workers) {
+    std::vector<pthread_t> pool(workers); // Потоки пула
+    for (int i = 0; i < workers; i++) {
+      pthread_create(&pool[i], NULL, worker_thread, this);
+    }
+    for (int i = 0; i < workers; i++) {
+      pthread_join(pool[i], NULL);
+    }
+  }
+
+  // Задача закончилась: последняя будит пул, чтобы он завершился
+  void task_done() {
+    pthread_mutex_lock(&lock_);
+    if (--live_ == 0) {
+      pthread_cond_broadcast(&wake_);
+    }
+    pthread_mutex_unlock(&lock_);
+  }
+
+private:
+  static void *worker_thread(void *arg) {
+    CoroScheduler *s = (CoroScheduler *)arg;
+    pthread_mutex_lock(&s->lock_);
+    while (true) {
+      s->timers_.advance(now_ns(), [s](std::coroutine_handle<> h) {
+        s->ready_.push_back(h); // Срок таймера вышел
+      });
+      if (!s->ready_.empty()) { // Есть готовая сопрограмма - выполняем
+        std::coroutine_handle<> h = s->ready_.front();
+        s->ready_.pop_front();
+        pthread_mutex_unlock(&s->lock_);
+        h.resume(); // До следующей приостановки или завершения
+        pthread_mutex_lock(&s->lock_);
+        continue;
+      }
+      if (s->live_ == 0) { // Все задачи завершены
+        break;
+      }
+      if (s->timers_.empty()) {
+        pthread_cond_wait(&s->wake_, &s->lock_); // Ждем готовую сопрограмму
+      } else {
+        uint64_t due = s->timers_.next_due_ns(); // Спим до занятого тика
+        struct timespec ts;
+        ts.tv_sec = due / 1000000000ULL;
+        ts.tv_nsec = due % 1000000000ULL;
+        pthread_cond_timedwait(&s->wake_, &s->lock_, &ts);
+      }
+    }
+    pthread_mutex_unlock(&s->lock_);
+    return NULL;
+  }
+
+  pthread_mutex_t lock_; // Мьютекс очередей планировщика
+  pthread_cond_t wake_;  // Появилась работа или таймер
+  std::deque<std::coroutine_handle<>> ready_; // Готовые к продолжению
+  TimerWheel<std::coroutine_handle<>> timers_; // Ожидающие таймеры
+  long live_; // Незавершенных задач
+};
+
+inline void CoroTask::promise_type::return_void() { sched->task_done(); }
+
+// Одноразовое событие: co_await приостанавливает сопрограмму до complete().
+// Слово хранит адрес кадра ожидающей сопрограммы или DONE.
+class CoroEvent {
+public:
+  CoroEvent() : state_(0) {}
+
+  bool await_ready() const {
+    return state_.load(std::memory_order_acquire) == DONE;
+  }
+  bool await_suspend(std::coroutine_handle<> h) {
+    uintptr_t expected = 0; // Если событие уже случилось - не засыпаем
+    return state_.compare_exchange_strong(expected, (uintptr_t)h.address(),
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire);
+  }
+  void await_resume() const {}
+
+  // Событие случилось: ожидающая сопрограмма продолжится на пуле sched
+  void complete(CoroScheduler &sched) {
+    uintptr_t old = state_.exchange(DONE, std::memory_order_acq_rel);
+    if (old != 0 && old != DONE) {
+      sched.schedule(std::coroutine_handle<>::from_address((void *)old));
+    }
+  }
+
+private:
+  static const uintptr_t DONE = 1; // Кадры выровнены, адрес 1 невозможен
+  std::atomic<uintptr_t> state_;   // 0, адрес кадра ожидающего или DONE
+};
+
+// Очередь с ожиданием для сопрограмм. Элементы выходят по срочности
+// (TriageQueue); если очередь пуста, pop() ставит сопрограмму в список
+// ожидающих, и push() передает элемент первому ожидающему напрямую.
+template <typename T> class CoroChannel {
+public:
+  explicit CoroChannel(CoroScheduler &sched) : sched_(sched), closed_(false) {
+    pthread_mutex_init(&lock_, NULL);
+  }
+  ~CoroChannel() { pthread_mutex_destroy(&lock_); }
+
+  void set_aging(uint64_t aging) { items_.set_aging(aging); }
+
+  // Постановка элемента уровня level; since - время постановки
+  void push(T item, int level, uint64_t since) {
+    pthread_mutex_lock(&lock_);
+    if (waiters_.empty()) {
+      items_.push(item, level, since); // Никто не ждет - в очередь
+      pthread_mutex_unlock(&lock_);
+      return;
+    }
+    Waiter w = waiters_.front(); // Отдаем первому ожидающему
+    waiters_.pop_front();
+    *w.slot = item;
+    pthread_mutex_unlock(&lock_);
+    sched_.schedule(w.h);
+  }
+
+  // Закрытие: новых элементов не будет, ожидающие получают T()
+  void close() {
+    pthread_mutex_lock(&lock_);
+    closed_ = true;
+    std::deque<Waiter> waiters;
+    waiters.swap(waiters_);
+    pthread_mutex_unlock(&lock_);
+    for (size_t i = 0; i < waiters.size(); i++) {
+      sched_.schedule(waiters[i].h);
+    }
+  }
+
+  struct PopAwaiter {
+    CoroChannel *ch; // Очередь
+    T item;          // Полученный элемент (T() - очередь закрыта)
+
+    bool await_ready() const { return false; }
+    bool await_suspend(std::coroutine_handle<> h) {
+      pthread_mutex_lock(&ch->lock_);
+      if (!ch->items_.empty()) { // Элемент есть - продолжаем сразу
+        item = ch->items_.pop();
+      } else if (!ch->closed_) { // Ждем элемента или закрытия
+        ch->waiters_.push_back(Waiter{h, &item});
+        pthread_mutex_unlock(&ch->lock_);
+        return true;
+      }
+      pthread_mutex_unlock(&ch->lock_);
+      return false;
+    }
+    T await_resume() const { return item; }
+  };
+
+  // Следующий элемент: co_await ch.pop()
+  PopAwaiter pop() { return PopAwaiter{this, T()}; }
+
+private:
+  struct Waiter {
+    std::coroutine_handle<> h; // Ожидающая сопрограмма
+    T *slot;                   // Куда положить элемент
+  };
+
+  CoroScheduler &sched_;       // Планировщик ожидающих
+  pthread_mutex_t lock_;       // Мьютекс очереди
+  TriageQueue<T> items_;       // Элементы по срочности
+  std::deque<Waiter> waiters_; // Ожидающие сопрограммы
+  bool closed_;                // Новых элементов не будет
+};
+
+#endif // __cpp_impl_coroutine
+
+#endif // CLINIC_CORO_H
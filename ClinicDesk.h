@@ -0,0 +1,91 @@
+#ifndef CLINIC_DESK_H
+#define CLINIC_DESK_H
+
+// Управляющий блок очереди: очередь к дежурным врачам или к специалистам
+// одного типа вместе с ее мьютексом, условной переменной и счетчиками
+// нагрузки. Раньше мьютексы, условные переменные, очереди и счетчики трех
+// типов специалистов лежали соседними массивами, и захват мьютекса
+// стоматолога выбивал из кэша хирурга линию с его мьютексом (ложное
+// разделение). Каждый блок начинается с новой кэш-линии, а счетчики,
+// которые пишутся без мьютекса при каждой смене состояния пациента, лежат
+// на своей линии, отдельно от мьютекса. Мьютекс и условная переменная -
+// pthread или гибридные из ClinicSpinPark.h (--lock=hybrid); очередь
+// захватывают через acquire()/release(), не зная, какие из них выбраны.
+
+#include <atomic>    // Подключаем атомарные операции (std::atomic)
+#include <pthread.h> // Подключаем pthread_mutex_t, pthread_cond_t
+
+#include "ClinicMpmcQueue.h" // Подключаем ParkingMpmcQueue и CLINIC_CACHE_LINE
+#include "ClinicSpinPark.h"  // Подключаем SpinParkMutex и SpinParkCond
+#include "ClinicTriage.h"    // Подключаем TriageQueue
+
+template <typename T> struct alignas(CLINIC_CACHE_LINE) QueueDesk {
+  QueueDesk()
+      : hybrid(false), queued(0), queuedPeak(0), busy(0), referrals(0) {
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&notEmpty, NULL);
+  }
+  ~QueueDesk() {
+    pthread_mutex_destroy(&lock);
+    pthread_cond_destroy(&notEmpty);
+  }
+  QueueDesk(const QueueDesk &) = delete;
+  QueueDesk &operator=(const QueueDesk &) = delete;
+
+  // Захват мьютекса очереди и ожидание на ней: pthread или гибридные
+  void acquire() {
+    if (hybrid) {
+      spinLock.lock();
+    } else {
+      pthread_mutex_lock(&lock);
+    }
+  }
+  void release() {
+    if (hybrid) {
+      spinLock.unlock();
+    } else {
+      pthread_mutex_unlock(&lock);
+    }
+  }
+  void wait() { // Мьютекс захвачен; может вернуться без сигнала
+    if (hybrid) {
+      spinNotEmpty.wait(spinLock);
+    } else {
+      pthread_cond_wait(&notEmpty, &lock);
+    }
+  }
+  void signal() {
+    if (hybrid) {
+      spinNotEmpty.signal();
+    } else {
+      pthread_cond_signal(&notEmpty);
+    }
+  }
+  void broadcast() {
+    if (hybrid) {
+      spinNotEmpty.broadcast();
+    } else {
+      pthread_cond_broadcast(&notEmpty);
+    }
+  }
+
+  // Состояние --queue=mutex: пишется только под мьютексом
+  bool hybrid;               // Гибридные мьютекс и условная переменная
+  pthread_mutex_t lock;      // Мьютекс очереди
+  pthread_cond_t notEmpty;   // Оповещение о новых пациентах в очереди
+  SpinParkMutex spinLock;    // Мьютекс очереди для --lock=hybrid
+  SpinParkCond spinNotEmpty; // Оповещение для --lock=hybrid
+  TriageQueue<T> queue;      // Очередь по срочности
+
+  // Нагрузка на очередь: пишется без мьютекса, читается политикой
+  // направления (--referral) и отчетами
+  alignas(CLINIC_CACHE_LINE) std::atomic<int> queued; // Ждут в очереди
+  std::atomic<int> queuedPeak; // Наибольшая длина очереди за день
+  std::atomic<int> busy;       // На приеме
+  std::atomic<int> referrals;  // Направлено в очередь за день
+
+  // Та же очередь для --queue=lockfree (позиции на своих кэш-линиях)
+  ParkingMpmcQueue<T> lockfree;
+};
+
+#endif // CLINIC_DESK_H
@@ -0,0 +1,109 @@
+#ifndef CLINIC_HISTOGRAM_H
+#define CLINIC_HISTOGRAM_H
+
+// Гистограмма задержек в духе HdrHistogram (--stats). Значения (мкс) делятся
+// на диапазоны по степеням двойки, а каждый диапазон - на 64 равных
+// поддиапазона, поэтому относительная погрешность процентилей не больше 1/64
+// (~1.6%) на всем диапазоне от микросекунд до часов. Запись значения - один
+// атомарный fetch_add по счетчику ячейки без блокировок, так что ее можно
+// вызывать из любого числа потоков врачей.
+
+#include <atomic>  // Подключаем атомарные операции (std::atomic)
+#include <cstdint> // Подключаем целые фиксированного размера
+#include <cstdio>  // Подключаем snprintf
+
+const int HIST_SUB_BITS = 6;                 // Бит точности в диапазоне
+const int HIST_SUB = 1 << HIST_SUB_BITS;     // Поддиапазонов в диапазоне
+const int HIST_BUCKETS = (64 - HIST_SUB_BITS + 1) * HIST_SUB; // Всего ячеек
+
+// Номер старшего единичного бита (value > 0)
+inline int hist_msb(uint64_t value) {
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(value);
+#else
+  int msb = 0;
+  while (value >>= 1) {
+    msb++;
+  }
+  return msb;
+#endif
+}
+
+// Ячейка для значения: до 2*HIST_SUB - по одной на значение, дальше - по
+// HIST_SUB ячеек на каждую степень двойки
+inline int hist_index(uint64_t value) {
+  if (value < (uint64_t)(2 * HIST_SUB)) {
+    return (int)value;
+  }
+  int shift = hist_msb(value) - HIST_SUB_BITS; // Сколько младших бит теряем
+  return (shift + 1) * HIST_SUB + (int)(value >> shift) - HIST_SUB;
+}
+
+// Наибольшее значение, попадающее в ячейку
+inline uint64_t hist_highest(int index) {
+  if (index < 2 * HIST_SUB) {
+    return (uint64_t)index;
+  }
+  int shift = index / HIST_SUB - 1;                        // Сдвиг диапазона
+  uint64_t sub = (uint64_t)(index % HIST_SUB + HIST_SUB);  // Поддиапазон
+  return ((sub + 1) << shift) - 1;
+}
+
+class LatencyHistogram {
+public:
+  LatencyHistogram() : count_(0), max_(0) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+      counts_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Запись значения (мкс)
+  void record(uint64_t value) {
+    counts_[hist_index(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t prev = max_.load(std::memory_order_relaxed);
+    while (value > prev && !max_.compare_exchange_weak(
+                               prev, value, std::memory_order_relaxed)) {
+    } // Обновляем максимум
+  }
+
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+  // Значение, не меньше которого q-я доля записей (q от 0 до 1)
+  uint64_t percentile(double q) const {
+    uint64_t total = count();
+    if (total == 0) {
+      return 0;
+    }
+    uint64_t rank = (uint64_t)(q * total + 0.5); // Номер нужной записи
+    if (rank < 1) {
+      rank = 1;
+    }
+    uint64_t seen = 0; // Записей в пройденных ячейках
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+      seen += counts_[i].load(std::memory_order_relaxed);
+      if (seen >= rank) {
+        uint64_t value = hist_highest(i);
+        return value < max() ? value : max(); // Не выше максимума
+      }
+    }
+    return max();
+  }
+
+  // Строка отчета "n=... p50=... p90=... p99=... max=..." в мс
+  int format(char *buf, size_t size) const {
+    return snprintf(buf, size,
+                    "n=%llu p50=%.3f p90=%.3f p99=%.3f max=%.3f",
+                    (unsigned long long)count(), percentile(0.50) / 1000.0,
+                    percentile(0.90) / 1000.0, percentile(0.99) / 1000.0,
+                    max() / 1000.0);
+  }
+
+private:
+  std::atomic<uint64_t> counts_[HIST_BUCKETS]; // Счетчики ячеек
+  std::atomic<uint64_t> count_;                // Всего записей
+  std::atomic<uint64_t> max_;                  // Наибольшее значение
+};
+
+#endif // CLINIC_HISTOGRAM_H
@@ -0,0 +1,71 @@
+#ifndef CLINIC_LATCH_H
+#define CLINIC_LATCH_H
+
+// Определение конца дня без общего мьютекса. Каждый дежурный врач считает
+// направленных им пациентов в своем счетчике на отдельной кэш-линии, так что
+// на горячем пути врачи не пишут в общую память. Сумму счетчиков читает
+// только тот, кто проверяет конец дня; когда все пациенты направлены,
+// защелка открывается один раз, и открывший ее будит всех ждущих.
+
+#include <atomic>  // Подключаем атомарные операции (std::atomic)
+#include <cstddef> // Подключаем size_t
+
+#include "ClinicMpmcQueue.h" // Подключаем CLINIC_CACHE_LINE
+
+// Счетчик, разнесенный по ячейкам: в ячейку slot пишет только ее владелец
+class ShardedCounter {
+public:
+  ShardedCounter() : slots_(NULL), count_(0) {}
+  ~ShardedCounter() { delete[] slots_; }
+
+  // Ячейки для slots владельцев, все счетчики нулевые
+  void init(int slots) {
+    delete[] slots_;
+    slots_ = new Slot[slots];
+    count_ = slots;
+    for (int i = 0; i < slots; i++) {
+      slots_[i].value.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Прибавление в свою ячейку: запись без захвата чужих кэш-линий
+  void add(int slot, long n) {
+    slots_[slot].value.fetch_add(n, std::memory_order_release);
+  }
+
+  // Сумма всех ячеек. Счетчики только растут, поэтому сумма не больше
+  // истинной: если она достигла цели, цель действительно достигнута
+  long sum() const {
+    long total = 0;
+    for (int i = 0; i < count_; i++) {
+      total += slots_[i].value.load(std::memory_order_acquire);
+    }
+    return total;
+  }
+
+private:
+  struct alignas(CLINIC_CACHE_LINE) Slot {
+    std::atomic<long> value; // Счетчик владельца ячейки
+  };
+
+  Slot *slots_; // Ячейки владельцев
+  int count_;   // Число ячеек
+};
+
+// Одноразовая защелка: закрыта до конца дня, открывается один раз
+class CompletionLatch {
+public:
+  CompletionLatch() : open_(false) {}
+
+  // Открыта ли защелка (одна загрузка, без захвата мьютекса)
+  bool is_open() const { return open_.load(std::memory_order_acquire); }
+
+  // Открытие защелки: true только у того, кто открыл ее первым, - он и
+  // будит ждущих
+  bool open() { return !open_.exchange(true, std::memory_order_acq_rel); }
+
+private:
+  std::atomic<bool> open_; // Защелка открыта
+};
+
+#endif // CLINIC_LATCH_H
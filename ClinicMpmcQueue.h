@@ -0,0 +1,354 @@
+#ifndef CLINIC_MPMC_QUEUE_H
+#define CLINIC_MPMC_QUEUE_H
+
+// Ограниченная lock-free очередь "много производителей - много потребителей"
+// (кольцевой буфер Д. Вьюкова) и eventcount для парковки простаивающих
+// потребителей. Используется как альтернативный бэкенд очередей commonQueue и
+// specialistQueue во всех трех программах (--queue=lockfree). Здесь же
+// одноразовое событие на futex, которым специалист будит вылеченного пациента.
+
+#include <atomic>  // Подключаем атомарные операции (std::atomic)
+#include <cstddef> // Подключаем size_t
+#include <cstdint> // Подключаем целые фиксированного размера (uint32_t)
+#include <new>     // Подключаем размещающий new
+
+#if defined(__linux__)
+#include <linux/futex.h> // Подключаем константы futex (FUTEX_WAIT_PRIVATE)
+#include <sys/syscall.h> // Подключаем номера системных вызовов (SYS_futex)
+#include <unistd.h>      // Подключаем syscall()
+#elif defined(_WIN32)
+#include <windows.h> // Подключаем SwitchToThread()
+#else
+#include <sched.h> // Подключаем sched_yield() для систем без futex
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h> // Подключаем _mm_pause() для циклов ожидания
+#define CLINIC_CPU_RELAX() _mm_pause() // Подсказка процессору: мы крутимся
+#else
+#define CLINIC_CPU_RELAX() ((void)0) // На других архитектурах ничего не делаем
+#endif
+
+const size_t CLINIC_CACHE_LINE = 64; // Размер кэш-линии (байт)
+
+// Ожидание, пока 32-битное слово равно expected (futex на Linux). Слово в
+// памяти, разделяемой между процессами (mmap MAP_SHARED), требует shared:
+// приватный futex ищет спящих только в своем процессе.
+inline void clinic_futex_wait(std::atomic<uint32_t> *word, uint32_t expected,
+                              bool shared = false) {
+#if defined(__linux__)
+  syscall(SYS_futex, (uint32_t *)word,
+          shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE, expected, NULL, NULL,
+          0); // Спим, пока значение не изменится и нас не разбудят
+#else
+  (void)shared; // Без futex разделяемое слово опрашивается так же
+  while (word->load(std::memory_order_acquire) == expected) { // Без futex
+#if defined(_WIN32)
+    SwitchToThread(); // Уступаем процессор
+#else
+    sched_yield(); // Уступаем процессор
+#endif
+  }
+#endif
+}
+
+// Пробуждение до count потоков, спящих на слове
+inline void clinic_futex_wake(std::atomic<uint32_t> *word, int count,
+                              bool shared = false) {
+#if defined(__linux__)
+  syscall(SYS_futex, (uint32_t *)word,
+          shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE, count, NULL, NULL,
+          0); // Будим спящие потоки
+#else
+  (void)word;  // Без futex ожидающие сами опрашивают слово
+  (void)count;
+  (void)shared;
+#endif
+}
+
+// Eventcount: позволяет уснуть "если ничего не изменилось с момента проверки"
+// без потерянных пробуждений. Потребитель: key = prepare_wait(); повторная
+// проверка условия; затем cancel_wait() или wait(key). Производитель: меняет
+// состояние и вызывает notify_one()/notify_all(). Eventcount в памяти,
+// разделяемой между процессами, создают с shared = true.
+class EventCount {
+public:
+  explicit EventCount(bool shared = false)
+      : epoch_(0), waiters_(0), shared_(shared) {}
+
+  uint32_t prepare_wait() {
+    waiters_.fetch_add(1, std::memory_order_seq_cst); // Регистрируемся
+    return epoch_.load(std::memory_order_seq_cst); // Запоминаем эпоху
+  }
+
+  void cancel_wait() {
+    waiters_.fetch_sub(1, std::memory_order_seq_cst); // Снимаем регистрацию
+  }
+
+  void wait(uint32_t key) {
+    while (epoch_.load(std::memory_order_acquire) == key) { // Эпоха та же
+      clinic_futex_wait(&epoch_, key, shared_); // Спим до смены эпохи
+    }
+    waiters_.fetch_sub(1, std::memory_order_seq_cst); // Снимаем регистрацию
+  }
+
+  void notify_one() { notify(1); } // Будим одного ожидающего
+  void notify_all() { notify(INT32_MAX); } // Будим всех ожидающих
+
+private:
+  void notify(int count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst); // Барьер Деккера
+    if (waiters_.load(std::memory_order_seq_cst) == 0) { // Никто не спит -
+      return; // системный вызов не нужен
+    }
+    epoch_.fetch_add(1, std::memory_order_seq_cst); // Новая эпоха
+    clinic_futex_wake(&epoch_, count, shared_);     // Будим спящих
+  }
+
+  alignas(CLINIC_CACHE_LINE) std::atomic<uint32_t> epoch_; // Номер эпохи
+  std::atomic<int> waiters_; // Число зарегистрированных ожидающих
+  bool shared_;              // Futex между процессами
+};
+
+// Одноразовое событие на одном 32-битном слове: complete() вызывается один
+// раз, wait() возвращается после него, даже если complete() случился раньше
+// wait() (потерянного пробуждения нет). Системный вызов нужен, только если
+// ожидающий уже уснул: wait() ставит слово в SLEEPING перед сном, и
+// complete() будит его, лишь увидев это значение. Ожидающий может освободить
+// объект сразу после wait(), поэтому futex_wake иногда приходится на уже
+// переиспользованную память; для futex это безопасно - лишний проснувшийся
+// просто перепроверит свое слово.
+class OneShotEvent {
+public:
+  OneShotEvent() : state_(PENDING) {}
+
+  void complete() {
+    if (state_.exchange(DONE, std::memory_order_acq_rel) == SLEEPING) {
+      clinic_futex_wake(&state_, 1); // Ожидающий спит - будим его
+    }
+  }
+
+  void wait() {
+    uint32_t s = state_.load(std::memory_order_acquire);
+    while (s != DONE) {
+      if (s == PENDING && !state_.compare_exchange_weak(
+                              s, SLEEPING, std::memory_order_acquire)) {
+        continue; // Слово изменилось - смотрим новое значение
+      }
+      clinic_futex_wait(&state_, SLEEPING); // Спим, пока слово SLEEPING
+      s = state_.load(std::memory_order_acquire);
+    }
+  }
+
+private:
+  enum : uint32_t {
+    PENDING = 0,  // Событие еще не случилось, никто не спит
+    SLEEPING = 1, // Событие не случилось, ожидающий спит на futex
+    DONE = 2      // Событие случилось
+  };
+  std::atomic<uint32_t> state_; // Состояние события
+};
+
+// Ограниченная MPMC-очередь Вьюкова. Каждая ячейка хранит номер
+// последовательности, по которому производитель и потребитель понимают, чья
+// сейчас очередь писать в ячейку, поэтому push/pop - это один CAS по позиции.
+template <typename T> class MpmcQueue {
+public:
+  MpmcQueue()
+      : cells_(NULL), mask_(0), owned_(false), enqueuePos_(0),
+        dequeuePos_(0) {}
+  ~MpmcQueue() { release(); }
+
+  // Выделение буфера: вместимость округляется вверх до степени двойки
+  void init(size_t capacity) {
+    size_t size = ring_size(capacity); // Размер буфера
+    release();                         // Освобождаем прежний буфер
+    cells_ = new Cell[size];           // Выделяем ячейки
+    owned_ = true;
+    reset(size);
+  }
+
+  // Буфер во внешней памяти (например, разделяемой между процессами) не
+  // меньше buffer_bytes(capacity) байт; очередь его не освобождает
+  void init(size_t capacity, void *memory) {
+    size_t size = ring_size(capacity); // Размер буфера
+    release();
+    cells_ = (Cell *)memory;
+    for (size_t i = 0; i < size; i++) {
+      new (&cells_[i]) Cell(); // Ячейки в чужой памяти
+    }
+    owned_ = false;
+    reset(size);
+  }
+
+  static size_t buffer_bytes(size_t capacity) {
+    return ring_size(capacity) * sizeof(Cell);
+  }
+
+  bool try_push(const T &value) {
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell *cell = &cells_[pos & mask_]; // Ячейка для записи
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) { // Ячейка свободна - пытаемся занять позицию
+        if (enqueuePos_.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          cell->data = value; // Записываем значение
+          cell->seq.store(pos + 1, std::memory_order_release); // Публикуем
+          return true;
+        }
+      } else if (diff < 0) { // Ячейка еще не прочитана - очередь полна
+        return false;
+      } else { // Другой производитель нас опередил
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool try_pop(T &value) {
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell *cell = &cells_[pos & mask_]; // Ячейка для чтения
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (diff == 0) { // Ячейка заполнена - пытаемся забрать позицию
+        if (dequeuePos_.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          value = cell->data; // Читаем значение
+          cell->seq.store(pos + mask_ + 1,
+                          std::memory_order_release); // Освобождаем ячейку
+          return true;
+        }
+      } else if (diff < 0) { // Ячейка пуста - очередь пуста
+        return false;
+      } else { // Другой потребитель нас опередил
+        pos = dequeuePos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Приблизительная длина очереди (для статистики и проверок)
+  size_t size_approx() const {
+    size_t tail = enqueuePos_.load(std::memory_order_relaxed);
+    size_t head = dequeuePos_.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> seq; // Номер последовательности ячейки
+    T data;                  // Значение
+  };
+
+  // Вместимость, округленная вверх до степени двойки
+  static size_t ring_size(size_t capacity) {
+    size_t size = 2; // Минимальный размер буфера
+    while (size < capacity) {
+      size <<= 1; // Округляем до степени двойки
+    }
+    return size;
+  }
+
+  void release() {
+    if (owned_) {
+      delete[] cells_;
+    }
+    cells_ = NULL;
+    owned_ = false;
+  }
+
+  // Все ячейки свободны, позиции в начале
+  void reset(size_t size) {
+    mask_ = size - 1; // Маска для индекса в кольце
+    for (size_t i = 0; i < size; i++) {
+      cells_[i].seq.store(i, std::memory_order_relaxed); // Ячейка i свободна
+    }
+    enqueuePos_.store(0, std::memory_order_relaxed);
+    dequeuePos_.store(0, std::memory_order_relaxed);
+  }
+
+  Cell *cells_; // Кольцевой буфер ячеек
+  size_t mask_; // Размер буфера минус один
+  bool owned_;  // Буфер выделен очередью и освобождается ею
+  alignas(CLINIC_CACHE_LINE) std::atomic<size_t> enqueuePos_; // Позиция записи
+  alignas(CLINIC_CACHE_LINE) std::atomic<size_t> dequeuePos_; // Позиция чтения
+};
+
+// Очередь с блокирующими операциями: lock-free буфер плюс eventcount'ы для
+// парковки потребителей на пустой очереди и производителей на полной.
+template <typename T> class ParkingMpmcQueue {
+public:
+  static const int SPIN_TRIES = 64; // Попыток до парковки потока
+
+  void init(size_t capacity) { queue_.init(capacity); }
+
+  // Буфер во внешней памяти (см. MpmcQueue::init)
+  void init(size_t capacity, void *memory) { queue_.init(capacity, memory); }
+  static size_t buffer_bytes(size_t capacity) {
+    return MpmcQueue<T>::buffer_bytes(capacity);
+  }
+
+  // Добавление; если очередь полна - ждем, пока потребитель освободит место
+  void push(const T &value) {
+    while (!queue_.try_push(value)) { // Очередь полна
+      uint32_t key = notFull_.prepare_wait(); // Готовимся уснуть
+      if (queue_.try_push(value)) {           // Повторная проверка
+        notFull_.cancel_wait();
+        break;
+      }
+      notFull_.wait(key); // Спим, пока не освободится место
+    }
+    notEmpty_.notify_one(); // Будим одного потребителя, если он спит
+  }
+
+  // Извлечение; ждем, пока появится элемент или done() станет истинным.
+  // Возвращает false, если очередь пуста и ждать больше нечего.
+  template <typename Done> bool pop(T &value, Done done) {
+    while (true) {
+      for (int i = 0; i < SPIN_TRIES; i++) { // Короткое активное ожидание
+        if (queue_.try_pop(value)) {
+          notFull_.notify_one(); // Место освободилось
+          return true;
+        }
+        CLINIC_CPU_RELAX();
+      }
+      uint32_t key = notEmpty_.prepare_wait(); // Готовимся уснуть
+      if (queue_.try_pop(value)) {             // Повторная проверка
+        notEmpty_.cancel_wait();
+        notFull_.notify_one();
+        return true;
+      }
+      if (done()) { // Больше элементов не будет
+        notEmpty_.cancel_wait();
+        // Последний элемент мог появиться между try_pop и done()
+        if (queue_.try_pop(value)) {
+          notFull_.notify_one();
+          return true;
+        }
+        return false;
+      }
+      notEmpty_.wait(key); // Спим до push() или wake_all()
+    }
+  }
+
+  bool try_pop(T &value) {
+    if (!queue_.try_pop(value)) {
+      return false;
+    }
+    notFull_.notify_one(); // Место освободилось
+    return true;
+  }
+
+  // Будим всех спящих потребителей, чтобы они перепроверили done()
+  void wake_all() { notEmpty_.notify_all(); }
+
+  size_t size_approx() const { return queue_.size_approx(); }
+
+private:
+  MpmcQueue<T> queue_; // Lock-free буфер
+  EventCount notEmpty_; // Парковка потребителей
+  EventCount notFull_;  // Парковка производителей
+};
+
+#endif // CLINIC_MPMC_QUEUE_H
@@ -6,7 +6,6 @@
 #include <iostream> //   - C++ (cin, cout)
 #include <omp.h> //  OpenMP
 #include <queue> //    (std::queue)
-#include <random> //     (std::mt19937)
 #include <stdarg.h> //    variadic  (va_list)
 #include <string> //   std::string
 
@@ -19,14 +18,40 @@
   usleep(1000L * (x)) //  sleep_ms  usleep ()
 #endif
 
+#include "ClinicArena.h" //  
+#include "ClinicAsyncLog.h" //    --log=async
+#include "ClinicHistogram.h" //    --stats
+#include "ClinicMpmcQueue.h" // Lock-free   --queue=lockfree
+#include "ClinicTrace.h" //     --trace
+#include "ClinicWorkload.h" //    (-service)
+
 //   
 enum SpecialistType { NONE = -1, DENTIST = 0, SURGEON = 1, THERAPIST = 2 };
 
+//  
+enum LogMode {
+  LOG_SYNC = 0,  //    log_event ( )
+  LOG_ASYNC = 1, //   - 
+  LOG_OFF = 2    //   
+};
+
+//        
+enum QueueBackend {
+  QUEUE_MUTEX = 0,   // std::queue  omp_lock_t
+  QUEUE_LOCKFREE = 1 // Lock-free MPMC-
+};
+
+// :  (   )    
+struct SpecialistId {
+  int type;   //  
+  int number; //      ( )
+};
+
 //  
 struct Patient {
   int id; //  
   SpecialistType specialist_type; //  ,   
-  bool treated; // , ,   
+  uint64_t stage_since = 0; //    (,  --stats)
 };
 
 //  
@@ -36,15 +61,57 @@ int t_s = 2000; // 
 std::string output_filename = "clinic_log.txt"; //     
 bool from_file = false; //     
 std::string config_filename; //   
+QueueBackend queue_backend = QUEUE_MUTEX; //  
+LogMode log_mode = LOG_SYNC; //  
+bool log_console = true;     //     
+std::string trace_filename; //    ( -  )
+ServiceDist serviceDist[SERVICE_STAGES]; //   
+bool stats_enabled = false; //      
+int duty_count = 2; //   
+int specialist_count[3] = {1, 1, 1}; //    
+int specialist_total = 3;            //    
+SpecialistId *specialistIds = NULL; //     
 
 //   
 std::queue<Patient *> commonQueue; //     
 omp_lock_t commonQueueLock; //    
 
 //   : (0), (1), (2)
-std::queue<Patient *> specialistQueue[3]; //     
+std::queue<Patient *> specialistQueue[3]; //     
 omp_lock_t specialistLock[3]; //     
 
+//     .     ,
+//     ,  ,   . ,
+//   ,      , 
+//    ,    .  
+//  OpenMP     .
+enum ActorState {
+  ACTOR_IDLE = 0, // ,    
+  ACTOR_BUSY = 1, //      
+  ACTOR_GONE = 2  //  
+};
+ActorState *dutyState = NULL;       //   
+ActorState *specialistState = NULL; //  
+omp_lock_t dutyStaffLock;           //   
+omp_lock_t specialistStaffLock[3];  //   
+
+//  :      ,  
+// -,  new/delete   
+ObjectArena<Patient> patientArena;
+
+//     --stats ()
+LatencyHistogram dutyWaitHist;            //     
+LatencyHistogram dutyTimeHist;            //    
+LatencyHistogram specialistWaitHist;      //   ( )
+LatencyHistogram specialistWaitHistBy[3]; //    
+LatencyHistogram treatmentHist;           //  ( )
+LatencyHistogram treatmentHistBy[3];      //   
+
+//     --queue=lockfree
+ParkingMpmcQueue<Patient *> commonQueueLF; // Lock-free   
+ParkingMpmcQueue<Patient *>
+    specialistQueueLF[3]; // Lock-free   
+
 // Spinlocks    
 omp_lock_t consoleLogLock; //     
 omp_lock_t fileLogLock; //     
@@ -58,18 +125,21 @@ FILE *log_file = NULL; // 
 auto program_start =
     std::chrono::high_resolution_clock::now(); //   
 
-//   
-std::mt19937
-    rng(42); //       
-std::uniform_int_distribution<int>
-    specialist_dist(0, 2); //    
+//     (Philox   (, ),  
+//   )
+unsigned referral_seed = 42;
 
 //        
-std::string get_time_since_start() {
+long long get_elapsed_ms() {
   auto now = std::chrono::high_resolution_clock::now(); //  
-  auto elapsed =
-      std::chrono::duration_cast<std::chrono::milliseconds>(now - program_start)
-          .count();                    //    
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             now - program_start)
+      .count(); //    
+}
+
+//         
+std::string get_time_since_start() {
+  long long elapsed = get_elapsed_ms(); //    
   int minutes = elapsed / 60000;       //   
   int seconds = (elapsed / 1000) % 60; //   
   int milliseconds = elapsed % 1000;   // 
@@ -81,19 +151,32 @@ std::string get_time_since_start() {
 
 //  
 void log_event(const char *fmt, ...) {
+  if (log_mode == LOG_OFF) {
+    return; //   
+  }
+
   va_list args;
   va_start(args, fmt);
 
+  //  :     ,   
+  if (log_mode == LOG_ASYNC) {
+    async_log_vsubmit(get_elapsed_ms(), fmt, args);
+    va_end(args);
+    return;
+  }
+
   va_list args2;
   va_copy(args2, args);
 
   std::string time_str = get_time_since_start();
 
   //      
-  omp_set_lock(&consoleLogLock);
-  printf("%s ", time_str.c_str());
-  vprintf(fmt, args);
-  omp_unset_lock(&consoleLogLock);
+  if (log_console) {
+    omp_set_lock(&consoleLogLock);
+    printf("%s ", time_str.c_str());
+    vprintf(fmt, args);
+    omp_unset_lock(&consoleLogLock);
+  }
 
   //      
   if (log_file) {
@@ -106,120 +189,342 @@ void log_event(const char *fmt, ...) {
   va_end(args);
 }
 
+//        ( )
+uint64_t get_elapsed_ns() {
+  auto now = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now -
+                                                              program_start)
+      .count();
+}
+
+//     --stats:     
+//     stage ,  ,   
+//  by_type.   (stage == NULL)   .
+void stats_mark(Patient *p, LatencyHistogram *stage,
+                LatencyHistogram *by_type) {
+  if (!stats_enabled) {
+    return;
+  }
+  uint64_t now = get_elapsed_ns();
+  if (stage) {
+    uint64_t us = (now - p->stage_since) / 1000; //   ()
+    stage->record(us);
+    if (by_type) {
+      by_type->record(us);
+    }
+  }
+  p->stage_since = now;
+}
+
+//    p   stage (): t_d / t_s   
+//  -service
+double service_time(const Patient *p, int stage) {
+  return service_sample(serviceDist[stage], stage == SERVICE_DUTY ? t_d : t_s,
+                        p->id, stage);
+}
+
+//     ,   
+void trace_event(TraceKind kind, int actor, int patient, int specialist) {
+  if (traceEnabled) {
+    trace_emit(get_elapsed_ns(), kind, actor, patient, specialist);
+  }
+}
+
+//        (NULL -  )
+Patient *try_pop_common() {
+  Patient *p = nullptr;
+  if (queue_backend == QUEUE_LOCKFREE) {
+    commonQueueLF.try_pop(p);
+    return p;
+  }
+  omp_set_lock(&commonQueueLock);
+  if (!commonQueue.empty()) {
+    p = commonQueue.front();
+    commonQueue.pop();
+  }
+  omp_unset_lock(&commonQueueLock);
+  return p;
+}
+
+//       p->specialist_type
+void push_specialist(Patient *p) {
+  if (queue_backend == QUEUE_LOCKFREE) {
+    specialistQueueLF[p->specialist_type].push(p);
+    return;
+  }
+  omp_set_lock(&specialistLock[p->specialist_type]);
+  specialistQueue[p->specialist_type].push(p);
+  omp_unset_lock(&specialistLock[p->specialist_type]);
+}
+
+//       (NULL -  )
+Patient *try_pop_specialist(int sid) {
+  Patient *p = nullptr;
+  if (queue_backend == QUEUE_LOCKFREE) {
+    specialistQueueLF[sid].try_pop(p);
+    return p;
+  }
+  omp_set_lock(&specialistLock[sid]);
+  if (!specialistQueue[sid].empty()) {
+    p = specialistQueue[sid].front();
+    specialistQueue[sid].pop();
+  }
+  omp_unset_lock(&specialistLock[sid]);
+  return p;
+}
+
+// ,      
+bool all_patients_sent() {
+  omp_set_lock(&patientsToSpecialistLock);
+  bool all_sent = (patientsToSpecialist == N);
+  omp_unset_lock(&patientsToSpecialistLock);
+  return all_sent;
+}
+
+void duty_doctor(int did);
+void specialist(int w);
+
+//     (  , -1 -  ).
+//     .
+int claim_duty_doctor() {
+  int found = -1;
+  omp_set_lock(&dutyStaffLock);
+  for (int i = 0; i < duty_count; i++) {
+    if (dutyState[i] == ACTOR_IDLE) {
+      dutyState[i] = ACTOR_BUSY;
+      found = i;
+      break;
+    }
+  }
+  omp_unset_lock(&dutyStaffLock);
+  return found;
+}
+
+//     sid (  specialistIds, -1 - )
+int claim_specialist(int sid) {
+  int found = -1;
+  omp_set_lock(&specialistStaffLock[sid]);
+  for (int w = 0; w < specialist_total; w++) {
+    if (specialistIds[w].type == sid && specialistState[w] == ACTOR_IDLE) {
+      specialistState[w] = ACTOR_BUSY;
+      found = w;
+      break;
+    }
+  }
+  omp_unset_lock(&specialistStaffLock[sid]);
+  return found;
+}
+
+//     :  (all == false)  .
+//      : libgomp   
+//    .
+void start_duty_doctors(bool all) {
+  int did;
+  while ((did = claim_duty_doctor()) >= 0) {
+#pragma omp task firstprivate(did)
+    { duty_doctor(did + 1); }
+    if (!all) {
+      break;
+    }
+  }
+}
+
+//      sid:   
+void start_specialists(int sid, bool all) {
+  int w;
+  while ((w = claim_specialist(sid)) >= 0) {
+#pragma omp task firstprivate(w)
+    { specialist(w); }
+    if (!all) {
+      break;
+    }
+  }
+}
+
+//   :       
+//  
+void wake_all_actors() {
+  start_duty_doctors(true);
+  for (int i = 0; i < 3; i++) {
+    start_specialists(i, true);
+  }
+}
+
 //         
 void create_patient(int pid) {
-  Patient *p = new Patient();
+  Patient *p = patientArena.acquire(); //     
   p->id = pid;
   p->specialist_type = NONE;
-  p->treated = false;
 
   //      
-  omp_set_lock(&commonQueueLock);
-  commonQueue.push(p);
-  log_event("Patient P%d entered the queue to the duty doctors\n", p->id);
-  omp_unset_lock(&commonQueueLock);
+  stats_mark(p, NULL, NULL); //    
+  if (queue_backend == QUEUE_LOCKFREE) {
+    commonQueueLF.push(p);
+    log_event("Patient P%d entered the queue to the duty doctors\n", p->id);
+    trace_event(TRACE_PATIENT_ENTERED, 0, p->id, NONE);
+  } else {
+    omp_set_lock(&commonQueueLock);
+    commonQueue.push(p);
+    log_event("Patient P%d entered the queue to the duty doctors\n", p->id);
+    trace_event(TRACE_PATIENT_ENTERED, 0, p->id, NONE);
+    omp_unset_lock(&commonQueueLock);
+  }
+  start_duty_doctors(false); //    
 }
 
-//     
+//   :  ,    
 void duty_doctor(int did) {
   while (true) {
-    Patient *p = nullptr;
-
     //     
-    omp_set_lock(&commonQueueLock);
-    if (!commonQueue.empty()) {
-      p = commonQueue.front();
-      commonQueue.pop();
-    }
-    omp_unset_lock(&commonQueueLock);
-
-    if (p != nullptr) {
-      //  
-      log_event("Duty Doctor D%d accepted patient P%d\n", did, p->id);
-      sleep_ms(t_d); //   
-
-      //  
-      p->specialist_type = static_cast<SpecialistType>(specialist_dist(rng));
-      const char *specName = (p->specialist_type == DENTIST)   ? "Dentist"
-                             : (p->specialist_type == SURGEON) ? "Surgeon"
-                                                               : "Therapist";
-      log_event("Duty Doctor D%d referred patient P%d to %s\n", did, p->id,
-                specName);
-
-      //      
-      omp_set_lock(&specialistLock[p->specialist_type]);
-      specialistQueue[p->specialist_type].push(p);
-      omp_unset_lock(&specialistLock[p->specialist_type]);
-
-      //    
-      omp_set_lock(&patientsToSpecialistLock);
-      patientsToSpecialist++;
-      bool now_all_sent = (patientsToSpecialist == N);
-      omp_unset_lock(&patientsToSpecialistLock);
-
-      //    ,  
-      if (now_all_sent) {
-        break;
+    Patient *p = try_pop_common();
+
+    if (p == nullptr) {
+      //  :       , 
+      //   ,     
+      omp_set_lock(&dutyStaffLock);
+      p = try_pop_common();
+      bool all_sent = (p == nullptr) && all_patients_sent();
+      if (p == nullptr) {
+        dutyState[did - 1] = all_sent ? ACTOR_GONE : ACTOR_IDLE;
       }
-    } else {
-      //   , ,    
-      omp_set_lock(&patientsToSpecialistLock);
-      bool all_sent = (patientsToSpecialist == N);
-      omp_unset_lock(&patientsToSpecialistLock);
-
-      if (all_sent) {
-        break; //   
-      } else {
-        //     
-        sleep_ms(100); // 100 
+      omp_unset_lock(&dutyStaffLock);
+      if (p == nullptr) {
+        if (all_sent) {
+          log_event("Duty Doctor D%d ended his workday\n", did);
+          trace_event(TRACE_DUTY_ENDED, did, 0, NONE);
+        }
+        return; //       
       }
     }
+
+    //  
+    stats_mark(p, &dutyWaitHist, NULL); //    
+    log_event("Duty Doctor D%d accepted patient P%d\n", did, p->id);
+    trace_event(TRACE_DUTY_ACCEPTED, did, p->id, NONE);
+    sleep_ms(service_time(p, SERVICE_DUTY)); //   
+
+    //  
+    p->specialist_type =
+        static_cast<SpecialistType>(workload_referral(referral_seed, p->id, 3));
+    const char *specName = (p->specialist_type == DENTIST)   ? "Dentist"
+                           : (p->specialist_type == SURGEON) ? "Surgeon"
+                                                             : "Therapist";
+    log_event("Duty Doctor D%d referred patient P%d to %s\n", did, p->id,
+              specName);
+    trace_event(TRACE_DUTY_REFERRED, did, p->id, p->specialist_type);
+
+    //         
+    stats_mark(p, &dutyTimeHist, NULL); //     
+    int sid = p->specialist_type;
+    push_specialist(p);
+    start_specialists(sid, false);
+
+    //    
+    omp_set_lock(&patientsToSpecialistLock);
+    patientsToSpecialist++;
+    bool now_all_sent = (patientsToSpecialist == N);
+    omp_unset_lock(&patientsToSpecialistLock);
+
+    //    ,    
+    if (now_all_sent) {
+      wake_all_actors();
+    }
   }
+}
 
-  log_event("Duty Doctor D%d ended his workday\n", did);
+//    : "Dentist",   , 
+// "Dentist#2"
+std::string specialist_name(const SpecialistId &s) {
+  std::string name = (s.type == DENTIST)   ? "Dentist"
+                     : (s.type == SURGEON) ? "Surgeon"
+                                           : "Therapist";
+  if (specialist_count[s.type] > 1) {
+    name += "#" + std::to_string(s.number);
+  }
+  return name;
 }
 
-//    
-void specialist(int sid) {
-  const char *specName = (sid == DENTIST)   ? "Dentist"
-                         : (sid == SURGEON) ? "Surgeon"
-                                            : "Therapist";
+//   w (  specialistIds):  , 
+//     
+void specialist(int w) {
+  const SpecialistId &me = specialistIds[w];
+  int sid = me.type; //  
+  std::string name = specialist_name(me);
+  const char *specName = name.c_str();
 
   while (true) {
-    Patient *p = nullptr;
-
     //      
-    omp_set_lock(&specialistLock[sid]);
-    if (!specialistQueue[sid].empty()) {
-      p = specialistQueue[sid].front();
-      specialistQueue[sid].pop();
+    Patient *p = try_pop_specialist(sid);
+
+    if (p == nullptr) {
+      //  :     
+      omp_set_lock(&specialistStaffLock[sid]);
+      p = try_pop_specialist(sid);
+      bool all_sent = (p == nullptr) && all_patients_sent();
+      if (p == nullptr) {
+        specialistState[w] = all_sent ? ACTOR_GONE : ACTOR_IDLE;
+      }
+      omp_unset_lock(&specialistStaffLock[sid]);
+      if (p == nullptr) {
+        if (all_sent) {
+          log_event("%s ended his workday\n", specName);
+          trace_event(TRACE_SPECIALIST_ENDED, me.number, 0, sid);
+        }
+        return; //    
+      }
     }
-    omp_unset_lock(&specialistLock[sid]);
 
-    if (p != nullptr) {
-      //  
-      log_event("%s started treating patient P%d\n", specName, p->id);
-      sleep_ms(t_s); //   
-      log_event("%s finished treating patient P%d\n", specName, p->id);
+    //  
+    stats_mark(p, &specialistWaitHist, &specialistWaitHistBy[sid]);
+    log_event("%s started treating patient P%d\n", specName, p->id);
+    trace_event(TRACE_TREATMENT_STARTED, me.number, p->id, sid);
+    sleep_ms(service_time(p, sid)); //   
+    stats_mark(p, &treatmentHist, &treatmentHistBy[sid]);
+    log_event("%s finished treating patient P%d\n", specName, p->id);
+    trace_event(TRACE_TREATMENT_FINISHED, me.number, p->id, sid);
 
-      //  
-      p->treated = true;
-    } else {
-      //   , ,    
-      omp_set_lock(&patientsToSpecialistLock);
-      bool all_sent = (patientsToSpecialist == N);
-      omp_unset_lock(&patientsToSpecialistLock);
-
-      if (all_sent) {
-        break; //   
-      } else {
-        //     
-        sleep_ms(100); // 100 
-      }
+    patientArena.release(p); //  ,  
+  }
+}
+
+//  specialistIds     
+void setup_staff() {
+  specialist_total = specialist_count[DENTIST] + specialist_count[SURGEON] +
+                     specialist_count[THERAPIST];
+  specialistIds = new SpecialistId[specialist_total];
+  int w = 0;
+  for (int type = 0; type < 3; type++) {
+    for (int k = 0; k < specialist_count[type]; k++) {
+      specialistIds[w++] = {type, k + 1};
     }
   }
+}
 
-  log_event("%s ended his workday\n", specName);
+//  --stats:     ()
+void log_stats_report() {
+  const char *types[3] = {"dentist", "surgeon", "therapist"};
+  char text[128];
+  log_event("Latency report (ms):\n");
+  dutyWaitHist.format(text, sizeof(text));
+  log_event("  duty queue wait: %s\n", text);
+  dutyTimeHist.format(text, sizeof(text));
+  log_event("  duty doctor time: %s\n", text);
+  specialistWaitHist.format(text, sizeof(text));
+  log_event("  specialist wait: %s\n", text);
+  for (int i = 0; i < 3; i++) {
+    specialistWaitHistBy[i].format(text, sizeof(text));
+    log_event("    %s: %s\n", types[i], text);
+  }
+  treatmentHist.format(text, sizeof(text));
+  log_event("  treatment: %s\n", text);
+  for (int i = 0; i < 3; i++) {
+    treatmentHistBy[i].format(text, sizeof(text));
+    log_event("    %s: %s\n", types[i], text);
+  }
+  log_event("  patient allocations: arena=%llu heap=%llu slots=%zu peak=%d\n",
+            (unsigned long long)patientArena.arena_allocs(),
+            (unsigned long long)patientArena.heap_allocs(),
+            patientArena.capacity(), patientArena.peak_in_use());
 }
 
 //   
@@ -231,6 +536,30 @@ void print_help() {
             << "  -t_d <ms>      Time for duty doctor to process a patient\n"
             << "  -t_s <ms>      Time for specialist to treat a patient\n"
             << "  -o <file>      Output log file\n"
+            << "  -d <count>     Number of duty doctors (default 2)\n"
+            << "  -s <list>      Specialists per specialty (default 1 each),\n"
+            << "                 e.g. dentist=4,surgeon=2,therapist=8\n"
+            << "  -seed <number> Seed of specialist referrals (default 42)\n"
+            << "  -service <stage>=<dist>\n"
+            << "                 Service time distribution of a stage (duty,\n"
+            << "                 dentist, surgeon, therapist or specialist):\n"
+            << "                 const (default), exp[:mean=<ms>],\n"
+            << "                 lognormal[:mean=<ms>,sigma=<s>] or\n"
+            << "                 empirical:<file>; all take ,seed=<n>\n"
+            << "  --queue=<mutex|lockfree>\n"
+            << "                 Queue backend: std::queue under omp_lock_t\n"
+            << "                 (default) or a lock-free MPMC ring\n"
+            << "  --log=<sync|async|off>\n"
+            << "                 Write log lines from the calling thread\n"
+            << "                 (default), batch them on a writer thread or\n"
+            << "                 skip the text log entirely\n"
+            << "  --console=<on|off>\n"
+            << "                 Duplicate the log to the console (default\n"
+            << "                 on)\n"
+            << "  --trace=<file> Write a binary event trace (clinic-trace)\n"
+            << "  --stats=<on|off>\n"
+            << "                 Report p50/p90/p99/max latency of every\n"
+            << "                 stage at the end of the day (default off)\n"
             << "  --help [-h]    Display this help message\n";
 }
 
@@ -240,9 +569,109 @@ void log_parameters() {
   log_event("Number of patients: %d\n", N);
   log_event("Duty doctor's processing time (ms): %d\n", t_d);
   log_event("Specialist's treatment time (ms): %d\n", t_s);
+  if (duty_count != 2 || specialist_count[DENTIST] != 1 ||
+      specialist_count[SURGEON] != 1 || specialist_count[THERAPIST] != 1) {
+    log_event("Duty doctors: %d\n", duty_count);
+    log_event("Specialists: dentist=%d, surgeon=%d, therapist=%d\n",
+              specialist_count[DENTIST], specialist_count[SURGEON],
+              specialist_count[THERAPIST]);
+  }
+  if (referral_seed != 42) {
+    log_event("Referral seed: %u\n", referral_seed);
+  }
+  std::string service = service_describe(serviceDist);
+  if (!service.empty()) {
+    log_event("Service times: %s\n", service.c_str());
+  }
   log_event("Log file: %s\n\n", output_filename.c_str());
 }
 
+//    
+bool parse_queue_backend(const char *name) {
+  if (strcmp(name, "mutex") == 0) {
+    queue_backend = QUEUE_MUTEX;
+  } else if (strcmp(name, "lockfree") == 0) {
+    queue_backend = QUEUE_LOCKFREE;
+  } else {
+    std::cerr << "Unknown queue backend: " << name << "\n";
+    return false;
+  }
+  return true;
+}
+
+//   
+bool parse_log_mode(const char *name) {
+  if (strcmp(name, "sync") == 0) {
+    log_mode = LOG_SYNC;
+  } else if (strcmp(name, "async") == 0) {
+    log_mode = LOG_ASYNC;
+  } else if (strcmp(name, "off") == 0) {
+    log_mode = LOG_OFF;
+  } else {
+    std::cerr << "Unknown log mode: " << name << "\n";
+    return false;
+  }
+  return true;
+}
+
+//     "dentist=4,surgeon=2,therapist=8"
+bool parse_specialists(const char *list) {
+  std::string text = list;
+  size_t pos = 0;
+  while (pos <= text.size()) {
+    size_t end = text.find(',', pos);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    std::string item = text.substr(pos, end - pos); //  "="
+    size_t eq = item.find('=');
+    if (eq == std::string::npos) {
+      std::cerr << "Bad specialist entry: " << item << "\n";
+      return false;
+    }
+    std::string name = item.substr(0, eq);
+    int count = atoi(item.substr(eq + 1).c_str());
+    if (name == "dentist") {
+      specialist_count[DENTIST] = count;
+    } else if (name == "surgeon") {
+      specialist_count[SURGEON] = count;
+    } else if (name == "therapist") {
+      specialist_count[THERAPIST] = count;
+    } else {
+      std::cerr << "Unknown specialist: " << name << "\n";
+      return false;
+    }
+    pos = end + 1;
+  }
+  return true;
+}
+
+//      
+bool parse_console(const char *value) {
+  if (strcmp(value, "on") == 0) {
+    log_console = true;
+  } else if (strcmp(value, "off") == 0) {
+    log_console = false;
+  } else {
+    std::cerr << "Unknown console option: " << value << "\n";
+    return false;
+  }
+  return true;
+}
+
+//     
+bool parse_stats(const char *value) {
+  if (strcmp(value, "on") == 0) {
+    stats_enabled = true;
+  } else if (strcmp(value, "off") == 0) {
+    stats_enabled = false;
+  } else {
+    std::cerr << "Unknown stats option: " << value << "\n";
+    return false;
+  }
+  return true;
+}
+
 //      
 bool parse_args(int argc, char **argv) {
   for (int i = 1; i < argc; i++) { //      
@@ -260,6 +689,36 @@ bool parse_args(int argc, char **argv) {
       t_s = atoi(argv[++i]);
     } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
       output_filename = argv[++i];
+    } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      duty_count = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      if (!parse_specialists(argv[++i])) {
+        return false;
+      }
+    } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+      referral_seed = (unsigned)atol(argv[++i]);
+    } else if (strcmp(argv[i], "-service") == 0 && i + 1 < argc) {
+      if (!service_parse_assignment(argv[++i], serviceDist)) {
+        return false;
+      }
+    } else if (strncmp(argv[i], "--queue=", 8) == 0) {
+      if (!parse_queue_backend(argv[i] + 8)) {
+        return false;
+      }
+    } else if (strncmp(argv[i], "--log=", 6) == 0) {
+      if (!parse_log_mode(argv[i] + 6)) {
+        return false;
+      }
+    } else if (strncmp(argv[i], "--console=", 10) == 0) {
+      if (!parse_console(argv[i] + 10)) {
+        return false;
+      }
+    } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+      trace_filename = argv[i] + 8;
+    } else if (strncmp(argv[i], "--stats=", 8) == 0) {
+      if (!parse_stats(argv[i] + 8)) {
+        return false;
+      }
     }
   }
 
@@ -279,10 +738,51 @@ bool parse_args(int argc, char **argv) {
         t_s = atoi(line.substr(4).c_str());
       } else if (line.find("o=") == 0) {
         output_filename = line.substr(2);
+      } else if (line.find("d=") == 0) {
+        duty_count = atoi(line.substr(2).c_str());
+      } else if (line.find("s=") == 0) {
+        if (!parse_specialists(line.substr(2).c_str())) {
+          return false;
+        }
+      } else if (line.find("seed=") == 0) {
+        referral_seed = (unsigned)atol(line.substr(5).c_str());
+      } else if (line.find("service=") == 0) {
+        if (!service_parse_assignment(line.substr(8).c_str(), serviceDist)) {
+          return false;
+        }
+      } else if (line.find("queue=") == 0) {
+        if (!parse_queue_backend(line.substr(6).c_str())) {
+          return false;
+        }
+      } else if (line.find("log=") == 0) {
+        if (!parse_log_mode(line.substr(4).c_str())) {
+          return false;
+        }
+      } else if (line.find("console=") == 0) {
+        if (!parse_console(line.substr(8).c_str())) {
+          return false;
+        }
+      } else if (line.find("trace=") == 0) {
+        trace_filename = line.substr(6);
+      } else if (line.find("stats=") == 0) {
+        if (!parse_stats(line.substr(6).c_str())) {
+          return false;
+        }
       }
     }
   }
 
+  if (duty_count < 1) {
+    std::cerr << "Clinic must have at least one duty doctor\n";
+    return false;
+  }
+  for (int i = 0; i < 3; i++) {
+    if (specialist_count[i] < 1) {
+      std::cerr << "Clinic must have at least one specialist of each type\n";
+      return false;
+    }
+  }
+
   return true;
 }
 
@@ -291,8 +791,10 @@ int main(int argc, char **argv) {
 
   //  
   omp_init_lock(&commonQueueLock);
+  omp_init_lock(&dutyStaffLock);
   for (int i = 0; i < 3; i++) {
     omp_init_lock(&specialistLock[i]);
+    omp_init_lock(&specialistStaffLock[i]);
   }
   omp_init_lock(&consoleLogLock);
   omp_init_lock(&fileLogLock);
@@ -303,6 +805,9 @@ int main(int argc, char **argv) {
     std::cerr << "Error reading parameters\n";
     return 1;
   }
+  setup_staff(); //   
+  dutyState = new ActorState[duty_count]();             //   
+  specialistState = new ActorState[specialist_total](); //  
 
   //     
   log_file = fopen(output_filename.c_str(), "w+");
@@ -311,28 +816,43 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  //  -  
+  if (log_mode == LOG_ASYNC) {
+    async_log_start(fileno(log_file), log_console);
+  }
+
+  //   :   6     
+  //    
+  if (!trace_filename.empty() &&
+      !trace_open(trace_filename.c_str(),
+                  6ULL * N + duty_count + specialist_total + 16,
+                  TRACE_PROGRAM_OPENMP, N, t_d, t_s, output_filename.c_str(),
+                  duty_count, specialist_count)) {
+    std::cerr << "Failed to open trace file\n";
+    return 1;
+  }
+
   log_parameters(); //   
+  patientArena.init(N); //     
+
+  // Lock-free    
+  if (queue_backend == QUEUE_LOCKFREE) {
+    commonQueueLF.init(N);
+    for (int i = 0; i < 3; i++) {
+      specialistQueueLF[i].init(N);
+    }
+  }
 
 //   
 #pragma omp parallel
   {
 #pragma omp single
     {
-      //    
-      for (int i = 0; i < 2; i++) {
-        int did = i + 1;
-#pragma omp task firstprivate(did)
-        { duty_doctor(did); }
-      }
+      //        
+      wake_all_actors();
 
-      //   
-      for (int i = 0; i < 3; i++) {
-        int sid = i;
-#pragma omp task firstprivate(sid)
-        { specialist(sid); }
-      }
-
-      //   
+      //   :    ,   
+      // ,      
       for (int i = 0; i < N; i++) {
         int pid = i + 1;
 #pragma omp task firstprivate(pid)
@@ -343,17 +863,32 @@ int main(int argc, char **argv) {
 
   log_event(
       "The hospital workday has ended\n"); //    
+  trace_event(TRACE_DAY_ENDED, 0, 0, NONE);
+  if (stats_enabled) {
+    log_stats_report(); //   
+  }
 
   //  
   omp_destroy_lock(&commonQueueLock);
+  omp_destroy_lock(&dutyStaffLock);
   for (int i = 0; i < 3; i++) {
     omp_destroy_lock(&specialistLock[i]);
+    omp_destroy_lock(&specialistStaffLock[i]);
   }
   omp_destroy_lock(&consoleLogLock);
   omp_destroy_lock(&fileLogLock);
   omp_destroy_lock(&patientsToSpecialistLock);
 
-  fclose(log_file); //   
+  //     ,  
+  if (log_mode == LOG_ASYNC) {
+    async_log_stop();
+  }
+  trace_close();
+
+  fclose(log_file);         //   
+  delete[] dutyState;       //   
+  delete[] specialistState;
+  delete[] specialistIds;   //   
 
   return 0; //   
 }
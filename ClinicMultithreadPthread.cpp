@@ -2,13 +2,16 @@
 #include <cstdio> // Подключаем стандартную библиотеку ввода-вывода C (printf, fprintf)
 #include <cstdlib> // Подключаем стандартную библиотеку C (atoi, rand и др.)
 #include <cstring> // Подключаем библиотеку для работы со строками C (strcmp)
+#include <deque> // Подключаем двустороннюю очередь (std::deque)
 #include <fstream> // Подключаем библиотеку для работы с файлами (ifstream, ofstream)
+#include <functional> // Подключаем std::greater для календаря событий
 #include <iostream> // Подключаем стандартную библиотеку ввода-вывода C++ (cin, cout)
 #include <pthread.h> // Подключаем библиотеку для работы с потоками POSIX (pthread_*)
 #include <queue> // Подключаем контейнер очередь (std::queue)
-#include <random> // Подключаем библиотеку для работы со случайными числами (std::random)
 #include <stdarg.h> // Подключаем для работы с variadic аргументами (va_list)
 #include <string>   // Подключаем класс std::string
+#include <thread>   // Подключаем std::this_thread::sleep_for
+#include <vector>   // Подключаем контейнер std::vector
 
 #if _WIN32                // Если компиляция под Windows
 #include <windows.h>      // Подключаем Windows.h для Sleep
@@ -18,6 +21,21 @@
 #define sleep(x) usleep(1000L * x) // Определяем sleep(x) через usleep
 #endif
 
+#include "ClinicArena.h" // Подключаем арену пациентов для --arena
+#include "ClinicAsyncLog.h" // Подключаем асинхронный логгер для --log=async
+#include "ClinicCoro.h" // Подключаем сопрограммы для --engine=coro
+#include "ClinicDesk.h" // Подключаем управляющие блоки очередей
+#include "ClinicHistogram.h" // Подключаем гистограммы задержек для --stats
+#include "ClinicLatch.h" // Подключаем счетчики и защелку конца дня
+#include "ClinicMpmcQueue.h" // Подключаем lock-free очередь для --queue=lockfree
+#include "ClinicPlacement.h" // Подключаем размещение потоков для --pin
+#include "ClinicReferral.h" // Подключаем политики направления (--referral)
+#include "ClinicShard.h" // Подключаем сеть клиник для --shards
+#include "ClinicSpinPark.h" // Подключаем гибридные мьютексы для --lock
+#include "ClinicTrace.h" // Подключаем бинарную трассу событий для --trace
+#include "ClinicTriage.h" // Подключаем очереди по срочности для --triage
+#include "ClinicWorkload.h" // Подключаем генератор потока пациентов (-arrival)
+
 // Структура пациента
 enum SpecialistType {
   NONE = -1,
@@ -26,14 +44,73 @@ enum SpecialistType {
   THERAPIST = 2
 }; // Перечисление типов специалистов
 
+// Состояния пациента на конвейере: очередь к дежурным -> к специалисту
+enum PatientState {
+  WAITING_DUTY = 0,       // Стоит в очереди к дежурным врачам
+  AT_DUTY_DOCTOR = 1,     // На приеме у дежурного врача
+  WAITING_SPECIALIST = 2, // Стоит в очереди к специалисту
+  IN_TREATMENT = 3,       // На лечении у специалиста
+  TREATED = 4             // Вылечен
+};
+
+// Модель пациентов: отдельный поток на пациента или объект-состояние
+enum PatientModel {
+  MODEL_THREAD = 0, // Каждый пациент - отдельный поток (по умолчанию)
+  MODEL_POOL = 1 // Пациенты - объекты, завершение обрабатывает пул потоков
+};
+
+// Движок симуляции: реальное время со sleep() или виртуальное время
+enum SimEngine {
+  ENGINE_REALTIME = 0, // Потоки и sleep(), как в жизни (по умолчанию)
+  ENGINE_VIRTUAL = 1, // Дискретно-событийная симуляция на виртуальных часах
+  ENGINE_CORO = 2     // Сопрограммы C++20 на небольшом пуле потоков
+};
+
+// Реализация очередей к дежурным врачам и к специалистам
+enum QueueBackend {
+  QUEUE_MUTEX = 0,   // std::queue под мьютексом и условной переменной
+  QUEUE_LOCKFREE = 1 // Lock-free MPMC-кольцо с парковкой на futex
+};
+
+// Мьютексы и условные переменные очередей (--queue=mutex)
+enum LockKind {
+  LOCK_PTHREAD = 0, // pthread_mutex_t и pthread_cond_t (по умолчанию)
+  LOCK_HYBRID = 1   // Сначала крутимся, затем паркуемся (ClinicSpinPark.h)
+};
+
+// Очередь к дежурным врачам: общая или своя у каждого врача
+enum DutyQueueMode {
+  DUTY_SHARED = 0, // Одна очередь dutyDesk на всех врачей (по умолчанию)
+  DUTY_STEAL = 1 // Своя очередь у каждого врача, свободные врачи воруют работу
+};
+
+// Режим логирования
+enum LogMode {
+  LOG_SYNC = 0, // Запись в консоль и файл прямо из log_event (по умолчанию)
+  LOG_ASYNC = 1, // Запись отдельным потоком-писателем пакетами
+  LOG_OFF = 2    // Текстовый лог отключен (например, пишется только трасса)
+};
+
+// Специалист: тип (общая очередь этого типа) и номер среди коллег
+struct SpecialistId {
+  int type;   // Тип специалиста (индекс очереди specialistDesk)
+  int number; // Номер среди специалистов этого типа (с единицы)
+};
+
 struct Patient {
   int id; // Идентификатор пациента
   SpecialistType
       specialist_type; // Тип специалиста, к которому пациент направлен
-  pthread_cond_t treated =
-      PTHREAD_COND_INITIALIZER; // Условная переменная для ожидания лечения
-  pthread_mutex_t patientLock =
-      PTHREAD_MUTEX_INITIALIZER; // Мьютекс для синхронизации состояния пациента
+  PatientState state; // Текущее состояние пациента на конвейере
+  uint64_t state_since = 0; // Время перехода в это состояние (нс, для --stats)
+  uint64_t entered_at = 0;  // Время прихода в очередь (нс, для --stats)
+  TriageLevel priority = TRIAGE_NORMAL; // Уровень срочности (--triage)
+  void (*on_treated)(
+      Patient *); // Обработчик, вызываемый специалистом после лечения
+  OneShotEvent treated; // Событие "пациент вылечен" (futex, 4 байта)
+#ifdef CLINIC_HAVE_CORO
+  CoroEvent treatedCoro; // То же событие для --engine=coro
+#endif
 };
 
 // Глобальные переменные (для простоты)
@@ -44,54 +121,198 @@ std::string output_filename =
     "data/clinic_log.txt"; // Имя файла для вывода логов
 bool from_file = false; // Флаг чтения параметров из файла
 std::string config_filename; // Имя файла конфигурации
+PatientModel patient_model = MODEL_THREAD; // Модель пациентов
+int pool_workers = 4; // Число потоков пула в режиме --patient-model=pool
+int coro_workers = 2; // Число потоков, выполняющих сопрограммы (--engine=coro)
+SimEngine engine = ENGINE_REALTIME; // Движок симуляции
+QueueBackend queue_backend = QUEUE_MUTEX; // Реализация очередей
+LockKind lock_kind = LOCK_PTHREAD; // Мьютексы очередей
+int spin_budget = SPIN_PARK_DEFAULT_BUDGET; // Бюджет ожидания в цикле
+DutyQueueMode duty_queue = DUTY_SHARED; // Очередь к дежурным врачам
+LogMode log_mode = LOG_SYNC; // Режим логирования
+bool log_console = true;     // Выводить ли лог в консоль
+std::string trace_filename; // Файл бинарной трассы (пусто - без трассы)
+bool stats_enabled = false; // Собирать ли гистограммы задержек по этапам
+ArrivalSpec arrival; // Поток пациентов (по умолчанию все приходят сразу)
+ServiceDist serviceDist[SERVICE_STAGES]; // Распределения времени приема
+std::vector<uint64_t> arrivalTimes; // Моменты прихода пациентов (мкс)
+int duty_count = 2; // Число дежурных врачей
+int specialist_count[3] = {1, 1, 1}; // Число специалистов каждого типа
+int specialist_total = 3;  // Число специалистов всех типов
+SpecialistId *specialistIds = NULL; // Тип и номер каждого специалиста
 
 // Потоки
 pthread_t *patients; // Массив потоков пациентов
-pthread_t duty_docs[2]; // Массив потоков дежурных врачей (2 врача)
-pthread_t specialists[3]; // Массив потоков специалистов (3 специалиста)
-
-// Очередь к дежурным
-std::queue<Patient *> commonQueue; // Очередь пациентов к дежурным врачам
-pthread_mutex_t commonQueueLock =
-    PTHREAD_MUTEX_INITIALIZER; // Мьютекс для очереди дежурных
-pthread_cond_t commonQueueNotEmpty =
-    PTHREAD_COND_INITIALIZER; // Условная переменная для оповещения о новых
-                              // пациентах в очереди дежурных
-
-// Очереди к специалистам: стоматолог(0), хирург(1), терапевт(2)
-std::queue<Patient *> specialistQueue[3]; // Три очереди для трех специалистов
-pthread_mutex_t specialistLock[3]; // Мьютексы для каждой очереди специалистов
-pthread_cond_t
-    specialistNotEmpty[3]; // Условные переменные для очередей специалистов
+pthread_t *duty_docs; // Массив потоков дежурных врачей (duty_count врачей)
+pthread_t *specialists; // Массив потоков специалистов (specialist_total)
+
+// Очередь к дежурным и очереди к специалистам: стоматолог(0), хирург(1),
+// терапевт(2). Очередь одного типа разбирают все специалисты этого типа. Обе
+// стадии выбирают пациентов по срочности (--triage), без нее - по порядку
+// прихода. Каждая очередь со своим мьютексом, условной переменной и
+// счетчиками - в отдельном блоке на своих кэш-линиях (ClinicDesk.h)
+QueueDesk<Patient *> dutyDesk;          // Очередь к дежурным врачам
+QueueDesk<Patient *> specialistDesk[3]; // Три очереди для трех типов
+
+// Очереди дежурных врачей для --duty-queue=steal. Пациенты раздаются врачам по
+// кругу; врач берет пациентов из начала своей очереди, а свободный врач
+// забирает пациента из конца очереди занятого коллеги. Каждая очередь под
+// своим мьютексом, так что общей точки конкуренции больше нет.
+struct DutyDeque {
+  alignas(CLINIC_CACHE_LINE) pthread_mutex_t lock; // Мьютекс очереди врача
+  std::deque<Patient *> patients; // Пациенты, назначенные врачу
+  std::atomic<int> size;          // Длина очереди (для проверки без мьютекса)
+  int steals;                     // Сколько пациентов врач забрал у коллег
+  int stolen;                     // Сколько пациентов забрали у этого врача
+};
+DutyDeque *dutyDeques = NULL; // Очереди дежурных врачей (duty_count штук)
+std::atomic<unsigned> dutyNext(0); // Счетчик для раздачи пациентов по кругу
+EventCount dutyIdle; // Парковка врачей, которым нечего делать
+
+// Гистограммы задержек этапов для --stats (мкс). Этап - время, проведенное
+// пациентом в одном состоянии PatientState; ожидание специалиста и лечение
+// дополнительно разбиты по типам специалистов.
+LatencyHistogram dutyWaitHist;          // Ожидание в очереди к дежурным
+LatencyHistogram dutyTimeHist;          // Прием у дежурного врача
+LatencyHistogram specialistWaitHist;    // Ожидание специалиста (все типы)
+LatencyHistogram specialistWaitHistBy[3]; // Ожидание специалиста по типам
+LatencyHistogram treatmentHist;         // Лечение (все типы)
+LatencyHistogram treatmentHistBy[3];    // Лечение по типам
+LatencyHistogram endToEndHist;          // От прихода до конца лечения
+LatencyHistogram endToEndHistBy[TRIAGE_LEVELS]; // По уровням срочности
+
+// Политика направления к специалистам (--referral, --eligible). Нагрузку на
+// специалистов она читает из счетчиков specialistDesk, которые обновляются
+// при каждой смене состояния пациента и читаются врачами без мьютексов.
+ReferralPolicy referral_policy = REFERRAL_RANDOM; // Политика направления
+int referral_choices = 0; // Подходящих типов (0 - 1 для random, иначе 3)
+std::atomic<unsigned> referralTurn(0); // Счетчик для round-robin
+
+// Пакетный прием (--batch): дежурный врач берет из очереди до batch_size
+// пациентов за один захват мьютекса, но не больше своей доли очереди, и
+// ставит их направления в очереди к специалистам пачкой - один захват и один
+// сигнал на тип специалиста. Перед каждым ненулевым приемом врач сначала
+// ставит уже направленных, чтобы они не ждали конца всего пакета.
+int batch_size = 1; // Пациентов за один захват очереди дежурных
+
+// Счетчики захватов мьютексов очередей и счетчика направлений и сигналов
+// условных переменных (для отчета --stats, только --queue=mutex)
+std::atomic<long long> lockAcquisitions(0); // Захватов мьютексов
+std::atomic<long long> condSignals(0);      // Вызовов signal/broadcast
+
+// Арена пациентов (--arena, --arena-slots): ячейки под всех пациентов
+// выделяются одним блоком до начала дня и переиспользуются
+ObjectArena<Patient> patientArena; // Арена объектов пациентов
+bool arena_enabled = true; // Брать ли пациентов из арены (иначе new/delete)
+int arena_slots = 0;       // Ячеек в арене (0 - по одной на пациента)
+
+// Сортировка по срочности (--triage, --aging)
+TriageMix triage;          // Доли срочных и несрочных пациентов
+int triage_aging_ms = 1000; // Через сколько мс ожидания уровень повышается
 
 pthread_mutex_t consoleLogLock =
     PTHREAD_MUTEX_INITIALIZER; // Мьютекс для логирования в консоль
 pthread_mutex_t fileLogLock =
     PTHREAD_MUTEX_INITIALIZER; // Мьютекс для логирования в файл
 
-// Новые глобальные переменные для подсчета направленных к специалисту пациентов
-int patientsToSpecialist = 0; // Счетчик направленных к специалисту пациентов
-pthread_mutex_t patientsToSpecialistLock =
-    PTHREAD_MUTEX_INITIALIZER; // Мьютекс для доступа к этому счетчику
+// Пул рабочих потоков для режима --patient-model=pool: ограниченная кольцевая
+// очередь задач, которую разбирают pool_workers потоков
+struct PoolTask {
+  void (*fn)(void *); // Функция задачи
+  void *arg;          // Аргумент задачи
+};
+const int POOL_CAPACITY = 1024; // Вместимость очереди задач пула
+PoolTask poolTasks[POOL_CAPACITY]; // Кольцевой буфер задач
+int poolHead = 0;  // Индекс первой задачи в буфере
+int poolCount = 0; // Число задач в буфере
+bool poolShutdown = false; // Флаг остановки пула
+pthread_t *poolThreads = NULL; // Массив потоков пула
+pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER; // Мьютекс очереди пула
+pthread_cond_t poolNotEmpty =
+    PTHREAD_COND_INITIALIZER; // Условная переменная: в пуле появилась задача
+pthread_cond_t poolNotFull =
+    PTHREAD_COND_INITIALIZER; // Условная переменная: в пуле появилось место
+
+// Счетчик отпущенных домой пациентов (для режима пула)
+int patientsDone = 0; // Число пациентов, ушедших домой
+pthread_mutex_t patientsDoneLock =
+    PTHREAD_MUTEX_INITIALIZER; // Мьютекс для счетчика ушедших пациентов
+pthread_cond_t allPatientsDone =
+    PTHREAD_COND_INITIALIZER; // Условная переменная: все пациенты ушли домой
+
+// Подсчет направленных к специалисту пациентов. Каждый дежурный врач считает
+// своих в отдельной ячейке referredBy, а конец дня отмечает защелка dayLatch:
+// ждущие врачи и специалисты проверяют только ее, без общего мьютекса.
+int patientsToSpecialist = 0; // Счетчик направленных (--engine=virtual)
+ShardedCounter referredBy; // Направленные пациенты по дежурным врачам
+CompletionLatch dayLatch;  // Защелка: все пациенты направлены
+std::atomic<int> patientsExpected(0); // Пациентов в клинике: N минус
+                                      // переданные плюс принятые (--shards)
+std::atomic<bool> admissionsClosed(true); // Новых пациентов больше не будет
+
+// Сеть клиник (--shards): каждая клиника - отдельный процесс
+int shard_count = 1;    // Число клиник
+int shard_overflow = 4; // Длина очереди к дежурным, с которой передаем
+int shard_index = -1;   // Номер этой клиники (с нуля), -1 - не клиника сети
+int patientsNetwork = 0; // Пациентов во всей сети
+std::string shardCpus;   // Ядра этой клиники (для лога)
+std::vector<int> shardPatients; // Номера своих пациентов клиники
+#ifdef CLINIC_HAVE_SHARDS
+ShardNetwork *shardNet = NULL; // Общее состояние сети в разделяемой памяти
+#endif
+
+// Размещение дежурных врачей и специалистов по ядрам и узлам NUMA (--pin).
+// Персонал нумеруется подряд: сначала дежурные врачи, затем специалисты в
+// порядке specialistIds.
+#ifdef CLINIC_HAVE_PIN
+PinSpec pin;          // Политика размещения
+CpuTopology topology; // Ядра и узлы NUMA процесса
+#endif
+bool pin_enabled = false;   // Привязаны ли потоки персонала к ядрам
+std::vector<int> staffCpu;  // Ядро каждого из персонала
+std::vector<int> staffNode; // Узел NUMA каждого из персонала
+int queueNode[3] = {0, 0, 0}; // Узел очереди специалистов (их первого)
+std::atomic<int> crossNodeReferrals(0); // Направлений в очередь чужого узла
+std::atomic<int> crossNodeTreatments(0); // Пациентов из очереди чужого узла
+std::vector<std::pair<void *, size_t>> numaBlocks; // Память на узлах NUMA
 
 // Файл вывода
 FILE *log_file = NULL; // Указатель на файл логов
 auto program_start =
     std::chrono::high_resolution_clock::now(); // Время старта программы (для
                                                // таймеров)
+long long virtual_now = 0; // Виртуальное время (мс) для --engine=virtual
 
-// Генератор случайных чисел
-std::mt19937
-    rng(42); // Стандартный генератор случайных чисел с фиксированным сидом
-std::uniform_int_distribution<int>
-    specialist_dist(0, 2); // Распределение для выбора специалиста
+// Сид направлений к специалистам. Специалист выбирается счетчиковым
+// генератором Philox по ключу (сид, пациент) без общего состояния между
+// потоками, поэтому направления не зависят от числа потоков и их порядка
+unsigned referral_seed = 42;
 
-// Функция для получения времени с момента старта программы
-std::string get_time_since_start() {
+// Функция для получения времени с момента старта программы (мс)
+long long get_elapsed_ms() {
+  if (engine == ENGINE_VIRTUAL) { // В виртуальном режиме
+    return virtual_now;           // берем время по виртуальным часам
+  }
   auto now = std::chrono::high_resolution_clock::now(); // Берем текущее время
-  auto elapsed =
-      std::chrono::duration_cast<std::chrono::milliseconds>(now - program_start)
-          .count(); // Вычисляем прошедшее время в мс
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             now - program_start)
+      .count(); // Вычисляем прошедшее время в мс
+}
+
+// Время с момента старта программы в наносекундах (для трассы)
+uint64_t get_elapsed_ns() {
+  if (engine == ENGINE_VIRTUAL) {        // В виртуальном режиме
+    return virtual_now * 1000000ULL;     // берем виртуальные часы
+  }
+  auto now = std::chrono::high_resolution_clock::now(); // Текущее время
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now -
+                                                              program_start)
+      .count(); // Прошедшее время в нс
+}
+
+// Функция для получения строки времени с момента старта программы
+std::string get_time_since_start() {
+  long long elapsed = get_elapsed_ms(); // Прошедшее время в мс
   int minutes = elapsed / 60000;       // Переводим в минуты
   int seconds = (elapsed / 1000) % 60; // Остаток в секундах
   int milliseconds = elapsed % 1000;   // Миллисекунды
@@ -103,19 +324,31 @@ std::string get_time_since_start() {
 
 // Функция логирования
 void log_event(const char *fmt, ...) {
+  if (log_mode == LOG_OFF) { // Текстовый лог отключен
+    return;
+  }
   va_list args; // Список аргументов
   va_start(args, fmt); // Инициализируем список аргументов
 
+  if (log_mode == LOG_ASYNC) { // Асинхронный режим
+    async_log_vsubmit(get_elapsed_ms(), fmt,
+                      args); // Кладем запись в буфер потока и выходим
+    va_end(args); // Завершаем работу со списком аргументов
+    return;
+  }
+
   va_list args2; // Второй список аргументов для логирования в файл
   va_copy(args2, args); // Копируем аргументы
 
   std::string time_str =
       get_time_since_start(); // Получаем текущее время с начала программы
   // Вывод в консоль
-  pthread_mutex_lock(&consoleLogLock); // Захватываем мьютекс консоли
-  printf("%s ", time_str.c_str()); // Печатаем время
-  vprintf(fmt, args); // Печатаем само сообщение
-  pthread_mutex_unlock(&consoleLogLock); // Освобождаем мьютекс консоли
+  if (log_console) { // Если вывод в консоль включен
+    pthread_mutex_lock(&consoleLogLock); // Захватываем мьютекс консоли
+    printf("%s ", time_str.c_str());     // Печатаем время
+    vprintf(fmt, args);                  // Печатаем само сообщение
+    pthread_mutex_unlock(&consoleLogLock); // Освобождаем мьютекс консоли
+  }
 
   // Вывод в файл
   if (log_file) {                     // Если файл открыт
@@ -128,368 +361,2325 @@ void log_event(const char *fmt, ...) {
   va_end(args); // Завершаем работу с основным списком аргументов
 }
 
-// Поток пациента
-void *patient_thread(void *arg) {
-  int pid = *(int *)arg; // Извлекаем id пациента из аргумента
-  delete (int *)arg; // Освобождаем память под id
-
-  Patient *p = new Patient(); // Создаем новый объект пациента
-  p->id = pid;                // Присваиваем ему id
-  p->specialist_type = NONE; // По умолчанию без специалиста
-
-  pthread_mutex_lock(&commonQueueLock); // Захватываем мьютекс очереди дежурных
-  commonQueue.push(p); // Добавляем пациента в очередь
-  log_event("Patient P%d entered the queue to duty doctors\n",
-            p->id); // Логируем событие
-  pthread_cond_signal(
-      &commonQueueNotEmpty); // Сигнализируем, что очередь теперь не пуста
-  pthread_mutex_unlock(
-      &commonQueueLock); // Освобождаем мьютекс очереди дежурных
+// Запись события в бинарную трассу, если она включена
+void trace_event(TraceKind kind, int actor, int patient, int specialist) {
+  if (traceEnabled) { // Трасса включена
+    trace_emit(get_elapsed_ns(), kind, actor, patient, specialist); // Пишем
+  }
+}
 
-  // Ждем, пока пациент будет вылечен
-  pthread_mutex_lock(&p->patientLock); // Захватываем мьютекс пациента
-  pthread_cond_wait(&p->treated,
-                    &p->patientLock); // Ждем сигнала о том, что пациент вылечен
-  pthread_mutex_unlock(&p->patientLock); // Освобождаем мьютекс пациента
+// Смена состояния пациента. С --stats время, проведенное в прежнем
+// состоянии, записывается в гистограмму соответствующего этапа.
+void set_patient_state(Patient *p, PatientState state) {
+  if (stats_enabled) {
+    uint64_t now = get_elapsed_ns(); // Время перехода
+    uint64_t us = (now - p->state_since) / 1000; // Длительность этапа (мкс)
+    if (state == WAITING_DUTY) { // Пациент пришел
+      p->entered_at = now;
+    } else if (state == TREATED) { // Пациент вылечен
+      endToEndHist.record((now - p->entered_at) / 1000); // Весь путь (мкс)
+      endToEndHistBy[p->priority].record((now - p->entered_at) / 1000);
+    }
+    if (state != WAITING_DUTY) { // У первого состояния нет прежнего этапа
+      switch (p->state) {
+      case WAITING_DUTY:
+        dutyWaitHist.record(us); // Ожидание дежурного врача
+        break;
+      case AT_DUTY_DOCTOR:
+        dutyTimeHist.record(us); // Прием и направление
+        break;
+      case WAITING_SPECIALIST:
+        specialistWaitHist.record(us); // Ожидание специалиста
+        specialistWaitHistBy[p->specialist_type].record(us);
+        break;
+      case IN_TREATMENT:
+        treatmentHist.record(us); // Лечение
+        treatmentHistBy[p->specialist_type].record(us);
+        break;
+      case TREATED:
+        break;
+      }
+    }
+    p->state_since = now; // Начало нового этапа
+  }
+  // Следим за ростом очереди к дежурным (по ней клиники сети передают друг
+  // другу пациентов)
+  if (arrival.kind != ARRIVAL_ALL || shard_index >= 0) {
+    if (state == WAITING_DUTY) {
+      int len = dutyDesk.queued.fetch_add(1) + 1; // Длина после прихода
+      int peak = dutyDesk.queuedPeak.load();
+      while (len > peak &&
+             !dutyDesk.queuedPeak.compare_exchange_weak(peak, len)) {
+      } // Обновляем максимум
+    } else if (state == AT_DUTY_DOCTOR) {
+      dutyDesk.queued.fetch_sub(1); // Пациент ушел из очереди на прием
+    }
+#ifdef CLINIC_HAVE_SHARDS
+    if (shard_index >= 0) { // Публикуем длину очереди другим клиникам
+      shardNet->slots[shard_index].dutyWaiting.store(
+          dutyDesk.queued.load(std::memory_order_relaxed),
+          std::memory_order_relaxed);
+    }
+#endif
+  }
+  if (state == WAITING_SPECIALIST) { // Публикуем нагрузку на специалистов
+    int type = p->specialist_type; // Тип, к которому пациент направлен
+    int len = specialistDesk[type].queued.fetch_add(1) + 1; // Длина очереди
+    int peak = specialistDesk[type].queuedPeak.load();
+    while (len > peak &&
+           !specialistDesk[type].queuedPeak.compare_exchange_weak(peak, len)) {
+    } // Обновляем максимум
+  } else if (state == IN_TREATMENT) {
+    specialistDesk[p->specialist_type].queued.fetch_sub(1); // Ушел из очереди
+    specialistDesk[p->specialist_type].busy.fetch_add(1);   // на лечение
+  } else if (state == TREATED) {
+    specialistDesk[p->specialist_type].busy.fetch_sub(1); // Лечение окончено
+  }
+  p->state = state; // Новое состояние
+}
 
-  log_event("Patient P%d fully treated and went home\n",
-            p->id); // Логируем событие вылеченного пациента
-  delete p;    // Освобождаем память под пациента
-  return NULL; // Завершаем поток пациента
+// Время приема пациента p на этапе stage (мс): t_d / t_s или выборка из
+// распределения -service
+double service_time(const Patient *p, int stage) {
+  return service_sample(serviceDist[stage], stage == SERVICE_DUTY ? t_d : t_s,
+                        p->id, stage);
 }
 
-// Поток дежурного врача
-void *duty_doctor_thread(void *arg) {
-  int did = *(int *)arg; // Извлекаем id дежурного врача
-  delete (int *)arg;     // Освобождаем память под id
+// Выбор специалиста для пациента p по политике --referral среди подходящих
+// ему типов с учетом текущих длин очередей
+SpecialistType refer_patient(const Patient *p) {
+  int primary; // Тип, выбранный случайно (политика random)
+  unsigned mask = referral_eligible(referral_seed, p->id, 3, referral_choices,
+                                    &primary); // Подходящие типы
+  ReferralLoad load[3]; // Нагрузка на специалистов каждого типа
+  for (int i = 0; i < 3; i++) {
+    load[i].queued = specialistDesk[i].queued.load(std::memory_order_relaxed);
+    load[i].busy = specialistDesk[i].busy.load(std::memory_order_relaxed);
+    load[i].staff = specialist_count[i];
+    load[i].mean_ms = service_mean(serviceDist[i], t_s); // Оценка лечения
+  }
+  int type = referral_choose(referral_policy, mask, primary, load, 3,
+                             &referralTurn); // Выбираем по политике
+  specialistDesk[type].referrals.fetch_add(1, std::memory_order_relaxed);
+  return static_cast<SpecialistType>(type);
+}
 
-  while (true) { // Бесконечный цикл (до выхода из него)
-    pthread_mutex_lock(
-        &commonQueueLock); // Захватываем мьютекс очереди дежурных
-
-    while (commonQueue.empty()) { // Пока очередь пуста
-      // Проверяем, не обработаны ли все пациенты
-      pthread_mutex_lock(
-          &patientsToSpecialistLock); // Захватываем мьютекс счетчика
-      bool all_sent =
-          (patientsToSpecialist == N); // Проверяем, обработаны ли все пациенты
-      pthread_mutex_unlock(
-          &patientsToSpecialistLock); // Освобождаем мьютекс счетчика
-
-      if (all_sent) { // Если все пациенты уже были направлены к специалистам
-        pthread_mutex_unlock(&commonQueueLock); // Освобождаем мьютекс очереди
-        goto end_duty; // Переходим к концу функции (завершение врача)
-      }
+// Ожидание момента прихода пациента: at_us - время прихода от начала приема
+// пациентов start_ns
+void wait_for_arrival(uint64_t start_ns, uint64_t at_us) {
+  uint64_t due = start_ns + at_us * 1000; // Момент прихода (нс)
+  uint64_t now = get_elapsed_ns();
+  if (due > now) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(due - now)); // Ждем
+  }
+}
 
-      pthread_cond_wait(
-          &commonQueueNotEmpty,
-          &commonQueueLock); // Ждем появления нового пациента в очереди
+// Поток пула: выполняет задачи, пока пул не остановлен и очередь не пуста
+void *pool_worker_thread(void *arg) {
+  (void)arg; // Аргумент не используется
+  while (true) {
+    pthread_mutex_lock(&poolLock); // Захватываем мьютекс пула
+    while (poolCount == 0 && !poolShutdown) { // Пока задач нет
+      pthread_cond_wait(&poolNotEmpty, &poolLock); // Ждем новую задачу
+    }
+    if (poolCount == 0) { // Задач нет и пул остановлен
+      pthread_mutex_unlock(&poolLock); // Освобождаем мьютекс пула
+      return NULL;                     // Завершаем поток пула
     }
+    PoolTask task = poolTasks[poolHead]; // Берем первую задачу
+    poolHead = (poolHead + 1) % POOL_CAPACITY; // Сдвигаем начало буфера
+    poolCount--;                               // Уменьшаем число задач
+    pthread_cond_signal(&poolNotFull); // Сообщаем, что появилось место
+    pthread_mutex_unlock(&poolLock);   // Освобождаем мьютекс пула
 
-    // Здесь очередь не пуста, берем пациента
-    Patient *p = commonQueue.front(); // Берем пациента из очереди
-    commonQueue.pop();                // Удаляем из очереди
-    pthread_mutex_unlock(
-        &commonQueueLock); // Освобождаем мьютекс очереди дежурных
+    task.fn(task.arg); // Выполняем задачу вне мьютекса
+  }
+}
 
-    // Принимаем пациента
-    log_event("Duty Doctor D%d accepted patient P%d\n", did,
-              p->id); // Логируем событие приема пациента
-    sleep(t_d);       // Имитируем время приема
+// Добавление задачи в пул (блокируется, если очередь задач заполнена)
+void pool_submit(void (*fn)(void *), void *arg) {
+  pthread_mutex_lock(&poolLock); // Захватываем мьютекс пула
+  while (poolCount == POOL_CAPACITY) { // Пока очередь задач заполнена
+    pthread_cond_wait(&poolNotFull, &poolLock); // Ждем свободное место
+  }
+  poolTasks[(poolHead + poolCount) % POOL_CAPACITY] = {fn, arg}; // Кладем
+  poolCount++;                        // Увеличиваем число задач
+  pthread_cond_signal(&poolNotEmpty); // Будим один поток пула
+  pthread_mutex_unlock(&poolLock);    // Освобождаем мьютекс пула
+}
 
-    // Определяем специалиста
-    p->specialist_type = static_cast<SpecialistType>(
-        specialist_dist(rng)); // Выбираем случайного специалиста
-    const char *specName = (p->specialist_type == DENTIST) ? "Dentist"
-                           : (p->specialist_type == SURGEON)
-                               ? "Surgeon"
-                               : "Therapist"; // Определяем имя специалиста
-    log_event("Duty Doctor D%d referred patient P%d to %s\n", did, p->id,
-              specName); // Логируем направление к специалисту
+// Остановка пула: потоки доделывают оставшиеся задачи и завершаются
+void pool_shutdown() {
+  pthread_mutex_lock(&poolLock);         // Захватываем мьютекс пула
+  poolShutdown = true;                   // Выставляем флаг остановки
+  pthread_cond_broadcast(&poolNotEmpty); // Будим все потоки пула
+  pthread_mutex_unlock(&poolLock);       // Освобождаем мьютекс пула
+  for (int i = 0; i < pool_workers; i++) {
+    pthread_join(poolThreads[i], NULL); // Ждем завершения потоков пула
+  }
+}
 
-    // Добавляем пациента в очередь к специалисту
-    pthread_mutex_lock(
-        &specialistLock[p->specialist_type]); // Захватываем мьютекс очереди
-                                              // выбранного специалиста
-    specialistQueue[p->specialist_type].push(
-        p); // Добавляем пациента в очередь специалиста
-    pthread_cond_signal(
-        &specialistNotEmpty[p->specialist_type]); // Сигнализируем, что очередь
-                                                  // у специалиста не пуста
-    pthread_mutex_unlock(
-        &specialistLock[p->specialist_type]); // Освобождаем мьютекс очереди
-                                              // специалиста
-
-    // Увеличиваем счетчик направленных пациентов
-    pthread_mutex_lock(
-        &patientsToSpecialistLock); // Захватываем мьютекс счетчика
-    patientsToSpecialist++; // Инкрементируем счетчик
-    bool now_all_sent =
-        (patientsToSpecialist ==
-         N); // Проверяем, достигли ли мы общего количества пациентов
-    pthread_mutex_unlock(
-        &patientsToSpecialistLock); // Освобождаем мьютекс счетчика
-
-    // Если теперь все пациенты направлены, разбудим все потоки, чтобы они
-    // проверили свои условия
-    if (now_all_sent) { // Если все пациенты уже в очередях к специалистам
-      pthread_mutex_lock(
-          &commonQueueLock); // Захватываем мьютекс очереди дежурных
-      pthread_cond_broadcast(
-          &commonQueueNotEmpty); // Будим всех дежурных врачей
-      pthread_mutex_unlock(
-          &commonQueueLock); // Освобождаем мьютекс очереди дежурных
-      for (int i = 0; i < 3; i++) { // Для всех специалистов
-        pthread_mutex_lock(
-            &specialistLock[i]); // Захватываем мьютекс очереди специалиста
-        pthread_cond_broadcast(&specialistNotEmpty[i]); // Будим специалистов
-        pthread_mutex_unlock(&specialistLock[i]); // Освобождаем мьютекс
-      }
+// Заполнение specialistIds по числу специалистов каждого типа
+void setup_staff() {
+  specialist_total = specialist_count[DENTIST] + specialist_count[SURGEON] +
+                     specialist_count[THERAPIST]; // Всего специалистов
+  specialistIds = new SpecialistId[specialist_total]; // Память под список
+  int w = 0; // Индекс специалиста в общем списке
+  for (int type = 0; type < 3; type++) {
+    for (int k = 0; k < specialist_count[type]; k++) {
+      specialistIds[w++] = {type, k + 1}; // Тип и номер специалиста
     }
   }
-
-end_duty:
-  log_event("Duty Doctor D%d ended his workday\n",
-            did); // Логируем завершение дежурного врача
-  return NULL; // Завершаем поток дежурного врача
 }
 
-// Поток специалиста
-void *specialist_thread(void *arg) {
-  int sid = *(int *)arg; // Извлекаем id специалиста
-  delete (int *)arg;     // Освобождаем память под id
+#ifdef CLINIC_HAVE_PIN
+// Ядра и узлы персонала по политике --pin; очередь специалистов одного типа
+// живет на узле первого из них
+void setup_placement() {
+  topology = topology_read();
+  std::vector<int> order = pin_order(pin, topology); // Ядра по порядку
+  int staff = duty_count + specialist_total; // Всего персонала
+  staffCpu.assign(staff, -1);
+  staffNode.assign(staff, 0);
+  for (int k = 0; k < staff && !order.empty(); k++) {
+    staffCpu[k] = order[k % order.size()];
+    staffNode[k] = topology_node(topology, staffCpu[k]);
+  }
+  for (int w = specialist_total - 1; w >= 0; w--) {
+    queueNode[specialistIds[w].type] = staffNode[duty_count + w];
+  }
+}
 
-  const char *specName = (sid == 0) ? "Dentist"
-                         : (sid == 1)
-                             ? "Surgeon"
-                             : "Therapist"; // Определяем имя специалиста по id
+// Блок памяти на узлах nodes; освобождается в конце дня
+void *placement_alloc(size_t bytes, const std::vector<int> &nodes) {
+  void *mem = numa_alloc(bytes, nodes);
+  if (mem) {
+    numaBlocks.push_back(std::make_pair(mem, bytes));
+  }
+  return mem;
+}
+#endif
 
-  while (true) { // Бесконечный цикл (до выхода)
-    pthread_mutex_lock(
-        &specialistLock[sid]); // Захватываем мьютекс очереди этого специалиста
-    while (specialistQueue[sid].empty()) { // Пока очередь специалиста пуста
-      pthread_mutex_lock(
-          &patientsToSpecialistLock); // Захватываем мьютекс счетчика
-      bool all_sent =
-          (patientsToSpecialist == N); // Проверяем, все ли пациенты направлены
-      pthread_mutex_unlock(
-          &patientsToSpecialistLock); // Освобождаем мьютекс счетчика
-
-      if (all_sent &&
-          specialistQueue[sid]
-              .empty()) { // Если все пациенты направлены и очередь пуста
-        pthread_mutex_unlock(
-            &specialistLock[sid]); // Освобождаем мьютекс очереди специалиста
-        goto end_specialist; // Завершаем работу этого специалиста
-      }
+// Поток k-го из персонала: с --pin привязан к своему ядру
+void create_staff_thread(pthread_t *thread, int k, void *(*fn)(void *),
+                         void *arg) {
+  pthread_attr_t attr; // Атрибуты потока
+  pthread_attr_init(&attr);
+#ifdef CLINIC_HAVE_PIN
+  if (pin_enabled) {
+    pin_attr(&attr, staffCpu[k]); // Поток сразу стартует на своем ядре
+  }
+#endif
+  pthread_create(thread, &attr, fn, arg);
+  pthread_attr_destroy(&attr);
+}
 
-      pthread_cond_wait(
-          &specialistNotEmpty[sid],
-          &specialistLock[sid]); // Ждем появления пациента в очереди
-    }
+// Список ядер для лога: "0,1,2"
+std::string cpu_list(int from, int count) {
+  std::string text;
+  for (int k = from; k < from + count; k++) {
+    text += (text.empty() ? "" : ",") + std::to_string(staffCpu[k]);
+  }
+  return text;
+}
 
-    Patient *p = specialistQueue[sid].front(); // Берем пациента из очереди
-    specialistQueue[sid].pop(); // Удаляем его из очереди
-    pthread_mutex_unlock(
-        &specialistLock[sid]); // Освобождаем мьютекс очереди специалиста
+// Имя специалиста для лога: "Dentist", если стоматолог один, иначе
+// "Dentist#2"
+std::string specialist_name(const SpecialistId &s) {
+  std::string name = (s.type == DENTIST)   ? "Dentist"
+                     : (s.type == SURGEON) ? "Surgeon"
+                                           : "Therapist"; // Название типа
+  if (specialist_count[s.type] > 1) { // Специалистов этого типа несколько
+    name += "#" + std::to_string(s.number); // Добавляем номер
+  }
+  return name;
+}
 
-    // Лечение пациента
-    log_event("%s started treating patient P%d\n", specName,
-              p->id); // Логируем начало лечения
-    sleep(t_s);       // Имитируем время лечения
-    log_event("%s finished treating patient P%d\n", specName,
-              p->id); // Логируем окончание лечения
+// Создание объекта пациента
+Patient *create_patient(int pid, void (*on_treated)(Patient *)) {
+  Patient *p = patientArena.acquire(); // Создаем пациента в ячейке арены
+  p->id = pid;                // Присваиваем ему id
+  p->specialist_type = NONE; // По умолчанию без специалиста
+  p->priority = triage_level(triage, referral_seed, pid); // Срочность
+  p->on_treated = on_treated; // Запоминаем обработчик завершения лечения
+  return p;
+}
 
-    // Уведомляем пациента
-    pthread_mutex_lock(&p->patientLock); // Захватываем мьютекс пациента
-    pthread_cond_signal(&p->treated); // Сигнализируем, что пациент вылечен
-    pthread_mutex_unlock(&p->patientLock); // Освобождаем мьютекс пациента
-  }
+// Уход пациента: ячейка арены освобождается для следующего
+void free_patient(Patient *p) { patientArena.release(p); }
 
-end_specialist:
-  log_event("%s ended his workday\n",
-            specName); // Логируем завершение специалиста
-  return NULL;         // Завершаем поток специалиста
+// Все пациенты клиники направлены и новых не будет. Когда прием закрыт,
+// patientsExpected больше не меняется, а сумма счетчиков не больше истинной,
+// так что равенство значит, что направлены действительно все.
+bool all_referred() {
+  return admissionsClosed.load() && referredBy.sum() == patientsExpected.load();
 }
 
-// Функция отображения справки
-void print_help() {
-  std::cout
-      << "Usage: program [options]\n" // Выводим подсказку по использованию
-      << "Options:\n"
-      << "  -f <file>      Load parameters from configuration file\n"
-      << "  -n <number>    Number of patients\n"
-      << "  -t_d <ms>      Time for duty doctor to process a patient\n"
-      << "  -t_s <ms>      Time for specialist to treat a patient\n"
-      << "  -o <file>      Output log file\n"
-      << "  --help [-h]    Display this help message\n";
+// Проверка, все ли пациенты направлены к специалистам
+bool all_patients_sent() {
+  return dayLatch.is_open(); // Защелку открывают, когда направлены все
 }
 
-// Функция отображения заданных для симуляции параметров
-void log_parameters() {
-  log_event("Simulation Parameters:\n"); // Логируем параметры задачи
-  log_event("Number of patients: %d\n", N); // Логируем количество пациентов
-  log_event("Duty doctor's processing time (ms): %d\n",
-            t_d); // Логируем время приема дежурного врача
-  log_event("Specialist's treatment time (ms): %d\n",
-            t_s); // Логируем время приема специалиста
-  log_event("Log file: %s\n\n",
-            output_filename.c_str()); // Логируем имя файла для логов
+// Постановка пациента в очередь к дежурным врачам
+void admit_patient(Patient *p) {
+  set_patient_state(p, WAITING_DUTY); // Пациент ждет дежурного врача
+  if (duty_queue == DUTY_STEAL) { // Очереди у каждого врача
+    DutyDeque &d = dutyDeques[dutyNext.fetch_add(1) % duty_count]; // По кругу
+    pthread_mutex_lock(&d.lock); // Захватываем мьютекс очереди врача
+    d.patients.push_back(p);     // Добавляем пациента в конец
+    d.size.store((int)d.patients.size()); // Обновляем длину
+    log_event("Patient P%d entered the queue to duty doctors\n",
+              p->id); // Логируем событие
+    trace_event(TRACE_PATIENT_ENTERED, 0, p->id, NONE); // Пишем в трассу
+    pthread_mutex_unlock(&d.lock); // Освобождаем мьютекс очереди врача
+    dutyIdle.notify_one();         // Будим свободного врача, если он спит
+    return;
+  }
+  if (queue_backend == QUEUE_LOCKFREE) { // Lock-free очередь
+    dutyDesk.lockfree.push(p); // Добавляем пациента в очередь
+    log_event("Patient P%d entered the queue to duty doctors\n",
+              p->id); // Логируем событие
+    trace_event(TRACE_PATIENT_ENTERED, 0, p->id, NONE); // Пишем в трассу
+    return;
+  }
+  dutyDesk.acquire(); // Захватываем мьютекс очереди дежурных
+  lockAcquisitions.fetch_add(1, std::memory_order_relaxed); // Считаем захват
+  dutyDesk.queue.push(p, p->priority,
+                      get_elapsed_ns()); // Добавляем пациента в очередь
+  log_event("Patient P%d entered the queue to duty doctors\n",
+            p->id); // Логируем событие
+  trace_event(TRACE_PATIENT_ENTERED, 0, p->id, NONE); // Пишем в трассу
+  dutyDesk.signal(); // Сигнализируем, что очередь теперь не пуста
+  condSignals.fetch_add(1, std::memory_order_relaxed); // Считаем сигнал
+  dutyDesk.release(); // Освобождаем мьютекс очереди дежурных
 }
 
-// Функция парсинга командной строки или файла
-bool parse_args(int argc, char **argv) {
-  for (int i = 1; i < argc; i++) { // Идем по всем аргументам командной строки
-    if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
-      print_help(); // Если запрошена помощь, выводим ее
-      exit(0);      // И выходим
-    } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
-      from_file = true; // Отмечаем что нужно читать из файла
-      config_filename = argv[++i]; // Запоминаем имя файла
-    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
-      N = atoi(argv[++i]); // Читаем количество пациентов
-    } else if (strcmp(argv[i], "-t_d") == 0 && i + 1 < argc) {
-      t_d = atoi(argv[++i]); // Читаем время дежурного врача
-    } else if (strcmp(argv[i], "-t_s") == 0 && i + 1 < argc) {
-      t_s = atoi(argv[++i]); // Читаем время специалиста
-    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
-      output_filename = argv[++i]; // Читаем имя файла для логов
+// Пациент из начала (своя очередь) или конца (чужая) очереди врача
+Patient *duty_deque_take(DutyDeque &d, bool from_front) {
+  Patient *p = NULL;
+  pthread_mutex_lock(&d.lock); // Захватываем мьютекс очереди врача
+  if (!d.patients.empty()) {   // Если очередь не пуста
+    if (from_front) {
+      p = d.patients.front(); // Свой пациент - из начала очереди
+      d.patients.pop_front();
+    } else {
+      p = d.patients.back(); // Чужой пациент - из конца очереди
+      d.patients.pop_back();
+      d.stolen++; // У этого врача забрали пациента
     }
+    d.size.store((int)d.patients.size()); // Обновляем длину
   }
+  pthread_mutex_unlock(&d.lock); // Освобождаем мьютекс очереди врача
+  return p;
+}
 
-  if (from_file) { // Если нужно читать из файла конфигурации
-    std::ifstream fin(config_filename.c_str()); // Открываем файл
-    if (!fin) { // Если не удалось открыть
-      std::cerr << "Failed to open configuration file\n"; // Сообщаем об ошибке
-      return false; // Возвращаем false
+// Извлечение пациента дежурным врачом did в режиме --duty-queue=steal: сначала
+// из своей очереди, затем из очередей коллег. Возвращает NULL, когда все
+// очереди пусты и все пациенты уже направлены к специалистам.
+Patient *pop_duty_steal(int did) {
+  int self = did - 1; // Индекс очереди врача
+  while (true) {
+    Patient *p = duty_deque_take(dutyDeques[self], true); // Своя очередь
+    if (p != NULL) {
+      return p;
     }
-    std::string line;                 // Строка для чтения
-    while (std::getline(fin, line)) { // Читаем построчно
-      if (line.find("n=") == 0) {
-        N = atoi(line.substr(2).c_str()); // Читаем N
-      } else if (line.find("t_d=") == 0) {
-        t_d = atoi(line.substr(4).c_str()); // Читаем t_d
-      } else if (line.find("t_s=") == 0) {
-        t_s = atoi(line.substr(4).c_str()); // Читаем t_s
-      } else if (line.find("o=") == 0) {
-        output_filename = line.substr(2); // Читаем имя файла логов
+    for (int k = 1; k < duty_count; k++) { // Обходим коллег по кругу
+      int victim = (self + k) % duty_count;
+      p = duty_deque_take(dutyDeques[victim], false); // Забираем из конца
+      if (p != NULL) {
+        dutyDeques[self].steals++; // Считаем кражу (счетчик только свой)
+        return p;
       }
     }
-  }
 
-  return true; // Возвращаем true если всё ОК
+    uint32_t key = dutyIdle.prepare_wait(); // Готовимся уснуть
+    bool found = false; // Появился ли пациент в какой-нибудь очереди
+    for (int i = 0; i < duty_count && !found; i++) {
+      found = dutyDeques[i].size.load() > 0; // Повторная проверка
+    }
+    if (found) {
+      dutyIdle.cancel_wait(); // Есть работа - идем за ней
+      continue;
+    }
+    if (all_patients_sent()) { // Пациентов больше не будет
+      dutyIdle.cancel_wait();
+      return NULL;
+    }
+    dutyIdle.wait(key); // Спим до нового пациента или конца дня
+  }
 }
 
-int main(int argc, char **argv) {
-  setlocale(LC_ALL, "ru"); // Устанавливаем локаль (русский язык)
-
-  if (!parse_args(argc, argv)) { // Парсим аргументы
-    std::cerr << "Error reading parameters\n"; // Если ошибка при чтении
-    return 1; // Выходим с кодом ошибки
+// Извлечение пациента из очереди к дежурным. Возвращает NULL, когда очередь
+// пуста и все пациенты уже направлены к специалистам.
+Patient *pop_common(int did) {
+  if (duty_queue == DUTY_STEAL) { // Очереди у каждого врача
+    return pop_duty_steal(did);
+  }
+  Patient *p = NULL; // Извлеченный пациент
+  if (queue_backend == QUEUE_LOCKFREE) { // Lock-free очередь
+    dutyDesk.lockfree.pop(p, all_patients_sent); // Ждем пациента или конца дня
+    return p;
   }
 
-  log_file =
-      fopen(output_filename.c_str(), "w+"); // Открываем файл логов на запись
-  if (!log_file) { // Если не удалось открыть
-    std::cerr << "Failed to open output file\n"; // Сообщаем об ошибке
-    return 1; // Выходим с кодом ошибки
+  dutyDesk.acquire(); // Захватываем мьютекс очереди дежурных
+  lockAcquisitions.fetch_add(1, std::memory_order_relaxed); // Считаем захват
+  while (dutyDesk.queue.empty()) { // Пока очередь пуста
+    // Проверяем, не обработаны ли все пациенты
+    if (all_patients_sent()) { // Если все пациенты уже направлены
+      dutyDesk.release(); // Освобождаем мьютекс очереди
+      return NULL; // Работы больше не будет
+    }
+
+    dutyDesk.wait(); // Ждем появления нового пациента
   }
 
-  log_parameters(); // Логируем параметры задачи
+  // Здесь очередь не пуста, берем пациента
+  p = dutyDesk.queue.pop(); // Берем самого срочного пациента из очереди
+  dutyDesk.release(); // Освобождаем мьютекс очереди дежурных
+  return p;
+}
 
-  // Инициализируем мьютексы для специалистов
-  for (int i = 0; i < 3; i++) {
-    pthread_mutex_init(&specialistLock[i],
-                       NULL); // Инициализируем мьютекс специалиста
-    pthread_cond_init(&specialistNotEmpty[i],
-                      NULL); // Инициализируем условную переменную специалиста
+// Извлечение до max пациентов из очереди к дежурным за один захват мьютекса
+// (--batch), но не больше доли врача - ceil(длина очереди / duty_count), -
+// чтобы остальные дежурные тоже получили пациентов. Ждет хотя бы одного
+// пациента; возвращает 0, когда очередь пуста и все пациенты уже направлены
+// к специалистам.
+int pop_common_batch(int did, Patient **out, int max) {
+  if (max == 1) { // Обычный прием по одному пациенту
+    out[0] = pop_common(did);
+    return out[0] != NULL ? 1 : 0;
+  }
+  dutyDesk.acquire(); // Захватываем мьютекс очереди дежурных
+  lockAcquisitions.fetch_add(1, std::memory_order_relaxed); // Считаем захват
+  while (dutyDesk.queue.empty()) { // Пока очередь пуста
+    if (all_patients_sent()) { // Если все пациенты уже направлены
+      dutyDesk.release(); // Освобождаем мьютекс очереди
+      return 0; // Работы больше не будет
+    }
+    dutyDesk.wait(); // Ждем нового пациента
+  }
+  int share = ((int)dutyDesk.queue.size() + duty_count - 1) /
+              duty_count; // Доля врача в очереди (не меньше одного)
+  if (max > share) {
+    max = share;
   }
+  int taken = 0; // Сколько пациентов взяли
+  while (taken < max && !dutyDesk.queue.empty()) {
+    out[taken++] = dutyDesk.queue.pop(); // Берем пациентов по срочности
+  }
+  dutyDesk.release(); // Освобождаем мьютекс очереди
+  return taken;
+}
 
-  // Создаем потоки дежурных врачей
-  for (int i = 0; i < 2; i++) {
-    int *id = new int(i + 1); // Выделяем память под id врача
-    pthread_create(&duty_docs[i], NULL, duty_doctor_thread,
-                   (void *)id); // Создаем поток дежурного врача
+// Постановка пациента в очередь к специалисту p->specialist_type
+void push_specialist(Patient *p) {
+  int type = p->specialist_type; // Индекс очереди специалиста
+  if (queue_backend == QUEUE_LOCKFREE) { // Lock-free очередь
+    specialistDesk[type].lockfree.push(p); // Добавляем и будим специалиста
+    return;
   }
+  specialistDesk[type].acquire(); // Захватываем мьютекс очереди
+  lockAcquisitions.fetch_add(1, std::memory_order_relaxed); // Считаем захват
+  specialistDesk[type].queue.push(p, p->priority,
+                                  get_elapsed_ns()); // Добавляем в очередь
+  specialistDesk[type].signal(); // Сигнализируем, что очередь не пуста
+  condSignals.fetch_add(1, std::memory_order_relaxed); // Считаем сигнал
+  specialistDesk[type].release(); // Освобождаем мьютекс
+}
 
-  // Создаем потоки специалистов
-  for (int i = 0; i < 3; i++) {
-    int *id = new int(i); // Выделяем память под id специалиста
-    pthread_create(&specialists[i], NULL, specialist_thread,
-                   (void *)id); // Создаем поток специалиста
+// Постановка пачки направленных пациентов в очереди к специалистам: по
+// одному захвату мьютекса и одному сигналу на каждый тип специалиста.
+// Поставленные пациенты обнуляются в batch: их может вылечить и освободить
+// специалист, пока ставятся пациенты следующих типов.
+void push_specialist_batch(Patient **batch, int n) {
+  if (n == 1) { // Один пациент - обычная постановка
+    set_patient_state(batch[0], WAITING_SPECIALIST); // Ждет специалиста
+    push_specialist(batch[0]);                       // Ставим в очередь
+    return;
+  }
+  for (int type = 0; type < 3; type++) { // Для каждого типа специалистов
+    int pushed = 0; // Пациентов, поставленных в эту очередь
+    for (int i = 0; i < n; i++) {
+      Patient *p = batch[i];
+      if (p == NULL || p->specialist_type != type) {
+        continue; // Уже в очереди или направлен к другому специалисту
+      }
+      if (pushed == 0) { // Первый пациент этого типа
+        specialistDesk[type].acquire(); // Захватываем мьютекс
+        lockAcquisitions.fetch_add(1, std::memory_order_relaxed);
+      }
+      set_patient_state(p, WAITING_SPECIALIST); // Пациент ждет специалиста
+      specialistDesk[type].queue.push(p, p->priority, get_elapsed_ns());
+      batch[i] = NULL; // Больше не читаем: пациент уже у специалиста
+      pushed++;
+    }
+    if (pushed == 1) { // Один пациент - будим одного специалиста
+      specialistDesk[type].signal();
+    } else if (pushed > 1) { // Несколько - будим всех специалистов типа
+      specialistDesk[type].broadcast();
+    }
+    if (pushed > 0) {
+      condSignals.fetch_add(1, std::memory_order_relaxed); // Считаем сигнал
+      specialistDesk[type].release(); // Освобождаем мьютекс
+    }
   }
+}
 
-  // Создаем потоки пациентов
-  patients = new pthread_t[N]; // Выделяем память под массив потоков пациентов
-  for (int i = 0; i < N; i++) {
-    int *pid = new int(i + 1); // Выделяем память под id пациента
-    pthread_create(&patients[i], NULL, patient_thread,
-                   (void *)pid); // Создаем поток пациента
+// Извлечение пациента из очереди специалистов типа sid (очередь общая для всех
+// специалистов этого типа). Возвращает NULL, когда все пациенты направлены и
+// очередь пуста.
+Patient *pop_specialist(int sid) {
+  Patient *p = NULL; // Извлеченный пациент
+  if (queue_backend == QUEUE_LOCKFREE) { // Lock-free очередь
+    specialistDesk[sid].lockfree.pop(p, all_patients_sent); // Ждем пациента
+    return p;
   }
 
-  // Ждем завершения всех потоков пациентов
-  for (int i = 0; i < N; i++) {
-    pthread_join(patients[i], NULL); // Ждем завершения потока пациента
+  specialistDesk[sid].acquire(); // Захватываем мьютекс очереди специалиста
+  lockAcquisitions.fetch_add(1, std::memory_order_relaxed); // Считаем захват
+  while (specialistDesk[sid].queue.empty()) { // Пока очередь пуста
+    if (all_patients_sent()) { // Если все пациенты направлены и очередь пуста
+      specialistDesk[sid].release(); // Освобождаем мьютекс
+      return NULL; // Пациентов больше не будет
+    }
+
+    specialistDesk[sid].wait(); // Ждем появления пациента в очереди
   }
 
-  log_event("All patients have been treated\n"); // Логируем, что все пациенты
-                                                 // вылечены
+  p = specialistDesk[sid].queue.pop(); // Берем самого срочного пациента
+  specialistDesk[sid].release(); // Освобождаем мьютекс очереди специалиста
+  return p;
+}
 
-  for (int i = 0; i < 2; i++) {
-    pthread_mutex_lock(
-        &commonQueueLock); // Захватываем мьютекс очереди дежурных
-    pthread_cond_broadcast(&commonQueueNotEmpty); // Будим всех дежурных (может
-                                                  // быть лишним, но оставим)
-    pthread_mutex_unlock(&commonQueueLock); // Освобождаем мьютекс
+// Все пациенты направлены: будим всех ждущих врачей и специалистов, чтобы они
+// проверили свои условия
+void wake_all_actors() {
+  if (duty_queue == DUTY_STEAL) { // Очереди у каждого врача
+    dutyIdle.notify_all();        // Будим всех спящих дежурных
+  }
+  if (queue_backend == QUEUE_LOCKFREE) { // Lock-free очереди
+    dutyDesk.lockfree.wake_all(); // Будим всех дежурных врачей
+    for (int i = 0; i < 3; i++) {
+      specialistDesk[i].lockfree.wake_all(); // Будим специалистов
+    }
+    return;
+  }
+  dutyDesk.acquire(); // Захватываем мьютекс очереди дежурных
+  dutyDesk.broadcast(); // Будим всех дежурных врачей
+  dutyDesk.release(); // Освобождаем мьютекс очереди дежурных
+  for (int i = 0; i < 3; i++) { // Для всех специалистов
+    specialistDesk[i].acquire(); // Захватываем мьютекс очереди специалиста
+    specialistDesk[i].broadcast(); // Будим специалистов
+    specialistDesk[i].release(); // Освобождаем мьютекс
   }
+}
 
-  // Все пациенты уже пришли и ушли. Дежурные закончат, когда направят всех N
-  // пациентов. После чего завершим дежурных.
-  for (int i = 0; i < 2; i++) {
-    pthread_join(duty_docs[i], NULL); // Ждем завершения потоков дежурных врачей
+// Конец направлений: если направлены все пациенты, открываем защелку, и
+// открывший ее будит всех ждущих (один раз за день)
+void check_all_referred() {
+  if (!dayLatch.is_open() && all_referred() && dayLatch.open()) {
+    wake_all_actors();
   }
+}
 
-  // Это должно было уже выполниться при завершении всех потоков пациентов,
-  // но... на всякий случай тут тоже убедимся.
-  pthread_mutex_lock(&commonQueueLock); // Захватываем мьютекс очереди дежурных
-  pthread_cond_broadcast(
-      &commonQueueNotEmpty); // Будим дежурных еще раз (на всякий случай)
-  pthread_mutex_unlock(&commonQueueLock); // Освобождаем мьютекс
+// Обработчик лечения в режиме потоков: будим поток пациента
+void wake_patient_thread(Patient *p) {
+  p->treated.complete(); // Отмечаем, что пациент вылечен, и будим его поток
+}
 
-  // Все дежурные завершились, значит patients_to_specialist == N.
-  // Пробудим всех специалистов, если кто-то ещё спит.
-  for (int i = 0; i < 3; i++) {
-    pthread_mutex_lock(&specialistLock[i]); // Захватываем мьютекс специалиста
-    pthread_cond_broadcast(&specialistNotEmpty[i]); // Будим специалистов
-    pthread_mutex_unlock(&specialistLock[i]); // Освобождаем мьютекс
-  }
+// Задача пула: пациент уходит домой
+void discharge_patient(void *arg) {
+  Patient *p = (Patient *)arg; // Извлекаем пациента из аргумента
+  log_event("Patient P%d fully treated and went home\n",
+            p->id); // Логируем событие вылеченного пациента
+  trace_event(TRACE_PATIENT_HOME, 0, p->id, p->specialist_type);
+  free_patient(p);  // Освобождаем память под пациента
 
-  // Ждем завершения всех специалистов
-  for (int i = 0; i < 3; i++) {
-    pthread_join(specialists[i], NULL); // Ждем завершения потоков специалистов
+  pthread_mutex_lock(&patientsDoneLock); // Захватываем мьютекс счетчика
+  patientsDone++; // Увеличиваем число ушедших пациентов
+  if (patientsDone == N) { // Если ушли все пациенты
+    pthread_cond_signal(&allPatientsDone); // Будим главный поток
   }
+  pthread_mutex_unlock(&patientsDoneLock); // Освобождаем мьютекс счетчика
+}
 
-  log_event(
-      "The hospital workday has ended\n"); // Логируем завершение рабочего дня
+// Обработчик лечения в режиме пула: отдаем уход пациента пулу потоков
+void submit_discharge(Patient *p) {
+  pool_submit(discharge_patient, p); // Ставим задачу в пул
+}
 
-  // Удаляем мьютексы и условные переменные
-  for (int i = 0; i < 3; i++) {
-    pthread_mutex_destroy(&specialistLock[i]); // Уничтожаем мьютекс специалиста
-    pthread_cond_destroy(
-        &specialistNotEmpty[i]); // Уничтожаем условную переменную специалиста
+// Поток пациента
+void *patient_thread(void *arg) {
+  int pid = (int)(intptr_t)arg; // id пациента передан по значению
+
+  Patient *p = create_patient(pid, wake_patient_thread); // Создаем пациента
+  admit_patient(p); // Ставим пациента в очередь к дежурным
+
+  // Ждем, пока пациент будет вылечен (событие могло случиться раньше)
+  p->treated.wait(); // Спим на futex, пока специалист не отметит лечение
+
+  log_event("Patient P%d fully treated and went home\n",
+            p->id); // Логируем событие вылеченного пациента
+  trace_event(TRACE_PATIENT_HOME, 0, p->id, p->specialist_type);
+  free_patient(p); // Освобождаем память под пациента
+  return NULL; // Завершаем поток пациента
+}
+
+// Постановка n направленных пациентов пакета к специалистам и учет их в
+// счетчике направленных врача did; если теперь направлены все, открываем
+// защелку и будим всех врачей и специалистов
+void flush_referrals(int did, Patient **batch, int n) {
+  if (n == 0) {
+    return; // Направлять некого
   }
-  pthread_mutex_destroy(
-      &commonQueueLock); // Уничтожаем мьютекс очереди дежурных
-  pthread_cond_destroy(
-      &commonQueueNotEmpty); // Уничтожаем условную переменную для дежурных
+  push_specialist_batch(batch, n); // Ставим в очереди специалистов
+  referredBy.add(did - 1, n);
+  check_all_referred();
+}
 
-  pthread_mutex_destroy(&consoleLogLock); // Уничтожаем мьютекс консоли
-  pthread_mutex_destroy(&fileLogLock); // Уничтожаем мьютекс файла
-  pthread_mutex_destroy(
-      &patientsToSpecialistLock); // Уничтожаем мьютекс счетчика
+// Поток дежурного врача
+void *duty_doctor_thread(void *arg) {
+  int did = (int)(intptr_t)arg; // id дежурного врача передан по значению
 
-  fclose(log_file);  // Закрываем файл логов
-  delete[] patients; // Освобождаем память под массив потоков пациентов
+  Patient **batch = new Patient *[batch_size]; // Пациенты одного захвата
+  while (true) { // Бесконечный цикл (до выхода из него)
+    int taken = pop_common_batch(did, batch, batch_size); // Берем пациентов
+    if (taken == 0) { // Если все пациенты уже были направлены к специалистам
+      break;          // Завершаем работу врача
+    }
+    int referred = 0; // Начало направленных, но еще не поставленных
+    for (int i = 0; i < taken; i++) { // Принимаем взятых пациентов по очереди
+      Patient *p = batch[i];
+      set_patient_state(p, AT_DUTY_DOCTOR); // Пациент на приеме у дежурного
+
+      // Принимаем пациента
+      log_event("Duty Doctor D%d accepted patient P%d\n", did,
+                p->id); // Логируем событие приема пациента
+      trace_event(TRACE_DUTY_ACCEPTED, did, p->id, NONE); // Пишем в трассу
+      double ms = service_time(p, SERVICE_DUTY); // Время приема
+      if (ms > 0) { // Направленные не ждут, пока мы принимаем следующего
+        flush_referrals(did, batch + referred, i - referred);
+        referred = i;
+      }
+      sleep(ms); // Имитируем время приема
+
+      // Определяем специалиста
+      p->specialist_type = refer_patient(p); // Выбираем специалиста
+      if (pin_enabled &&
+          staffNode[did - 1] != queueNode[p->specialist_type]) {
+        crossNodeReferrals.fetch_add(1, std::memory_order_relaxed);
+      } // Очередь специалиста на другом узле NUMA
+      const char *specName = (p->specialist_type == DENTIST) ? "Dentist"
+                             : (p->specialist_type == SURGEON)
+                                 ? "Surgeon"
+                                 : "Therapist"; // Определяем имя специалиста
+      log_event("Duty Doctor D%d referred patient P%d to %s\n", did, p->id,
+                specName); // Логируем направление к специалисту
+      trace_event(TRACE_DUTY_REFERRED, did, p->id, p->specialist_type);
+    }
+
+    // Добавляем оставшихся пациентов в очереди к специалистам
+    flush_referrals(did, batch + referred, taken - referred);
+  }
+  delete[] batch; // Освобождаем буфер пациентов
+
+  log_event("Duty Doctor D%d ended his workday\n",
+            did); // Логируем завершение дежурного врача
+  trace_event(TRACE_DUTY_ENDED, did, 0, NONE); // Пишем в трассу
+  return NULL; // Завершаем поток дежурного врача
+}
+
+// Поток специалиста
+void *specialist_thread(void *arg) {
+  SpecialistId *me = (SpecialistId *)arg; // Извлекаем тип и номер специалиста
+  int sid = me->type;                     // Тип специалиста (его очередь)
+  bool remote = pin_enabled && staffNode[duty_count + (me - specialistIds)] !=
+                                   queueNode[sid]; // Очередь на чужом узле
+
+  std::string name = specialist_name(*me); // Определяем имя специалиста
+  const char *specName = name.c_str();     // Имя для лога
+
+  while (true) { // Бесконечный цикл (до выхода)
+    Patient *p = pop_specialist(sid); // Берем пациента из очереди
+    if (p == NULL) { // Если все пациенты направлены и очередь пуста
+      break;         // Завершаем работу этого специалиста
+    }
+    if (remote) {
+      crossNodeTreatments.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Лечение пациента
+    set_patient_state(p, IN_TREATMENT); // Пациент на лечении
+    log_event("%s started treating patient P%d\n", specName,
+              p->id); // Логируем начало лечения
+    trace_event(TRACE_TREATMENT_STARTED, me->number, p->id,
+                sid); // Пишем в трассу
+    sleep(service_time(p, sid)); // Имитируем время лечения
+    log_event("%s finished treating patient P%d\n", specName,
+              p->id); // Логируем окончание лечения
+    trace_event(TRACE_TREATMENT_FINISHED, me->number, p->id,
+                sid); // Пишем в трассу
+
+    // Уведомляем пациента
+    set_patient_state(p, TREATED); // Пациент вылечен
+    p->on_treated(p);   // Вызываем обработчик завершения лечения
+  }
+
+  log_event("%s ended his workday\n",
+            specName); // Логируем завершение специалиста
+  trace_event(TRACE_SPECIALIST_ENDED, me->number, 0, sid); // Пишем в трассу
+  return NULL;         // Завершаем поток специалиста
+}
+
+// Дискретно-событийная симуляция (--engine=virtual).
+// Повторяет логику duty_doctor_thread/specialist_thread в одном потоке:
+// вместо sleep() врачи ставят в календарь событие окончания приема, а часы
+// перескакивают сразу к ближайшему событию. Направления выбирает та же
+// функция refer_patient по политике --referral; длины очередей, которые
+// учитывают политики по нагрузке, - это счетчики блоков очередей в
+// виртуальном времени. С политикой random выбор зависит только от (сид,
+// пациент), поэтому порядок и время событий в логе совпадают с реальным
+// запуском (без задержек планировщика), а день занимает миллисекунды.
+enum SimEventKind {
+  SIM_DUTY_DONE = 0,       // Дежурный врач закончил прием пациента
+  SIM_DUTY_WAKE = 1,       // Дежурный врач проснулся и проверяет очередь
+  SIM_SPECIALIST_WAKE = 2, // Специалист проснулся и проверяет очередь
+  SIM_TREATMENT_DONE = 3,  // Специалист закончил лечение пациента
+  SIM_PATIENT_HOME = 4,    // Вылеченный пациент уходит домой
+  SIM_PATIENT_ARRIVE = 5   // Пациент пришел в клинику (-arrival)
+};
+
+struct SimEvent {
+  long long time;    // Время события (мс)
+  long long seq;     // Порядковый номер (для событий в одно и то же время)
+  SimEventKind kind; // Тип события
+  int actor;         // Индекс врача или специалиста
+  Patient *p;        // Пациент, к которому относится событие
+
+  bool operator>(const SimEvent &other) const { // Порядок в календаре
+    return time != other.time ? time > other.time : seq > other.seq;
+  }
+};
+
+std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent>>
+    simCalendar;           // Календарь событий (ближайшее - сверху)
+long long simSeq = 0;      // Счетчик порядковых номеров событий
+bool *simDutyBusy;         // Занят ли дежурный врач
+bool *simDutyGone;         // Ушел ли дежурный врач домой
+bool *simSpecialistBusy;   // Занят ли специалист (по индексу в specialistIds)
+bool *simSpecialistGone;   // Ушел ли специалист домой
+bool *simSpecialistWoken;  // Разбужен ли специалист, но еще не проснулся
+int simPatientsHome = 0;   // Число ушедших домой пациентов
+
+// Добавление события в календарь
+void sim_schedule(long long time, SimEventKind kind, int actor, Patient *p) {
+  simCalendar.push({time, simSeq++, kind, actor, p}); // Кладем в календарь
+}
+
+// Дежурный врач did (индекс с нуля) ищет следующую работу
+void sim_duty_next(int did) {
+  if (!dutyDesk.queue.empty()) {          // Если в очереди есть пациент
+    Patient *p = dutyDesk.queue.pop();    // Берем самого срочного пациента
+    set_patient_state(p, AT_DUTY_DOCTOR); // Пациент на приеме у дежурного
+    simDutyBusy[did] = true;              // Врач занят
+    log_event("Duty Doctor D%d accepted patient P%d\n", did + 1, p->id);
+    trace_event(TRACE_DUTY_ACCEPTED, did + 1, p->id, NONE); // Пишем в трассу
+    sim_schedule(virtual_now + llround(service_time(p, SERVICE_DUTY)),
+                 SIM_DUTY_DONE, did, p); // Конец приема
+  } else if (patientsToSpecialist == N) { // Все пациенты уже направлены
+    simDutyBusy[did] = false;             // Врач свободен
+    simDutyGone[did] = true;              // и уходит домой
+    log_event("Duty Doctor D%d ended his workday\n", did + 1);
+    trace_event(TRACE_DUTY_ENDED, did + 1, 0, NONE); // Пишем в трассу
+  } else {
+    simDutyBusy[did] = false; // Врач ждет новых пациентов
+  }
+}
+
+// Специалист w (индекс в specialistIds) ищет следующего пациента
+void sim_specialist_next(int w) {
+  const SpecialistId &me = specialistIds[w]; // Тип и номер специалиста
+  int sid = me.type;                         // Очередь специалиста
+  std::string specName = specialist_name(me); // Имя специалиста
+  if (!specialistDesk[sid].queue.empty()) {       // Если очередь не пуста
+    Patient *p = specialistDesk[sid].queue.pop(); // Берем самого срочного
+    set_patient_state(p, IN_TREATMENT);           // Пациент на лечении
+    simSpecialistBusy[w] = true;                  // Специалист занят
+    log_event("%s started treating patient P%d\n", specName.c_str(), p->id);
+    trace_event(TRACE_TREATMENT_STARTED, me.number, p->id, sid); // В трассу
+    sim_schedule(virtual_now + llround(service_time(p, sid)),
+                 SIM_TREATMENT_DONE, w, p); // Конец лечения
+  } else if (patientsToSpecialist == N) { // Больше пациентов не будет
+    simSpecialistBusy[w] = false;         // Специалист свободен
+    simSpecialistGone[w] = true;          // и уходит домой
+    log_event("%s ended his workday\n", specName.c_str());
+    trace_event(TRACE_SPECIALIST_ENDED, me.number, 0, sid); // Пишем в трассу
+  } else {
+    simSpecialistBusy[w] = false; // Специалист ждет пациентов
+  }
+}
+
+// Приход пациента pid: он встает в очередь, и его сразу принимает первый
+// свободный дежурный врач
+void sim_admit(int pid) {
+  Patient *p = create_patient(pid, NULL); // Создаем пациента
+  set_patient_state(p, WAITING_DUTY);     // Пациент ждет дежурного врача
+  dutyDesk.queue.push(p, p->priority, get_elapsed_ns()); // Ставим в очередь
+  log_event("Patient P%d entered the queue to duty doctors\n", p->id);
+  trace_event(TRACE_PATIENT_ENTERED, 0, p->id, NONE); // Пишем в трассу
+  for (int d = 0; d < duty_count; d++) {
+    if (!simDutyBusy[d] && !simDutyGone[d]) { // Первый свободный врач
+      sim_duty_next(d);                       // принимает пациента
+      break;
+    }
+  }
+}
+
+// Аналог pthread_cond_broadcast: будим всех ожидающих врачей и специалистов
+void sim_wake_all() {
+  for (int i = 0; i < duty_count; i++) {
+    if (!simDutyBusy[i] && !simDutyGone[i]) { // Врач ждет на условной пер.
+      sim_schedule(virtual_now, SIM_DUTY_WAKE, i, NULL); // Будим его
+    }
+  }
+  for (int i = 0; i < specialist_total; i++) {
+    if (!simSpecialistBusy[i] && !simSpecialistGone[i]) { // Специалист ждет
+      sim_schedule(virtual_now, SIM_SPECIALIST_WAKE, i, NULL); // Будим его
+    }
+  }
+}
+
+// Обработка одного события календаря
+void sim_handle(const SimEvent &ev) {
+  switch (ev.kind) {
+  case SIM_DUTY_DONE: {
+    Patient *p = ev.p; // Пациент, закончивший прием
+    p->specialist_type = refer_patient(p); // Выбираем специалиста
+    const char *specName = (p->specialist_type == DENTIST) ? "Dentist"
+                           : (p->specialist_type == SURGEON)
+                               ? "Surgeon"
+                               : "Therapist"; // Определяем имя специалиста
+    log_event("Duty Doctor D%d referred patient P%d to %s\n", ev.actor + 1,
+              p->id, specName); // Логируем направление к специалисту
+    trace_event(TRACE_DUTY_REFERRED, ev.actor + 1, p->id, p->specialist_type);
+    set_patient_state(p, WAITING_SPECIALIST); // Пациент ждет специалиста
+    specialistDesk[p->specialist_type].queue.push(
+        p, p->priority, get_elapsed_ns()); // В очередь
+    for (int w = 0; w < specialist_total; w++) { // Ищем свободного специалиста
+      if (specialistIds[w].type == p->specialist_type &&
+          !simSpecialistBusy[w] && !simSpecialistGone[w] &&
+          !simSpecialistWoken[w]) { // этого типа, которого еще не будили
+        simSpecialistWoken[w] = true; // Сигнал достается одному ждущему
+        sim_schedule(virtual_now, SIM_SPECIALIST_WAKE, w,
+                     NULL); // Будим одного специалиста (pthread_cond_signal)
+        break;
+      }
+    }
+    patientsToSpecialist++;          // Инкрементируем счетчик
+    if (patientsToSpecialist == N) { // Все пациенты направлены
+      sim_wake_all();                // Будим всех, как broadcast
+    }
+    sim_duty_next(ev.actor); // Врач сразу берет следующего пациента
+    break;
+  }
+  case SIM_DUTY_WAKE:
+    if (!simDutyBusy[ev.actor] && !simDutyGone[ev.actor]) {
+      sim_duty_next(ev.actor); // Проснувшийся врач проверяет очередь
+    }
+    break;
+  case SIM_SPECIALIST_WAKE:
+    simSpecialistWoken[ev.actor] = false; // Специалист проснулся
+    if (!simSpecialistBusy[ev.actor] && !simSpecialistGone[ev.actor]) {
+      sim_specialist_next(ev.actor); // Проснувшийся специалист берет пациента
+    }
+    break;
+  case SIM_TREATMENT_DONE: {
+    const SpecialistId &me = specialistIds[ev.actor]; // Кто лечил пациента
+    log_event("%s finished treating patient P%d\n",
+              specialist_name(me).c_str(), ev.p->id);
+    trace_event(TRACE_TREATMENT_FINISHED, me.number, ev.p->id, me.type);
+    set_patient_state(ev.p, TREATED); // Пациент вылечен
+    sim_schedule(virtual_now, SIM_PATIENT_HOME, ev.actor, ev.p); // Уходит
+    sim_specialist_next(ev.actor); // Специалист берет следующего пациента
+    break;
+  }
+  case SIM_PATIENT_HOME:
+    log_event("Patient P%d fully treated and went home\n", ev.p->id);
+    trace_event(TRACE_PATIENT_HOME, 0, ev.p->id, ev.p->specialist_type);
+    free_patient(ev.p); // Освобождаем память под пациента
+    if (++simPatientsHome == N) { // Ушли все пациенты
+      log_event("All patients have been treated\n");
+      trace_event(TRACE_ALL_TREATED, 0, 0, NONE); // Пишем в трассу
+    }
+    break;
+  case SIM_PATIENT_ARRIVE:
+    sim_admit(ev.actor); // Пациент пришел и встал в очередь
+    break;
+  }
+}
+
+// Весь рабочий день на виртуальных часах
+void run_virtual_day() {
+  simDutyBusy = new bool[duty_count]();             // Все врачи свободны
+  simDutyGone = new bool[duty_count]();             // и на месте
+  simSpecialistBusy = new bool[specialist_total](); // Как и специалисты
+  simSpecialistGone = new bool[specialist_total]();
+  simSpecialistWoken = new bool[specialist_total]();
+
+  // Пациенты, пришедшие в момент 0, сразу попадают к свободным врачам,
+  // остальные приходят по календарю
+  for (int i = 0; i < N; i++) {
+    long long at = (long long)((arrivalTimes[i] + 500) / 1000); // Приход (мс)
+    if (at == 0) {
+      sim_admit(i + 1); // Пациент пришел к открытию
+    } else {
+      sim_schedule(at, SIM_PATIENT_ARRIVE, i + 1, NULL); // Придет позже
+    }
+  }
+  sim_wake_all(); // Свободные врачи и специалисты проверяют свои очереди
+
+  while (!simCalendar.empty()) {       // Пока в календаре есть события
+    SimEvent ev = simCalendar.top();   // Берем ближайшее событие
+    simCalendar.pop();                 // Удаляем его из календаря
+    virtual_now = ev.time;             // Переводим часы
+    sim_handle(ev);                    // Обрабатываем событие
+  }
+
+  delete[] simDutyBusy; // Освобождаем состояние врачей
+  delete[] simDutyGone;
+  delete[] simSpecialistBusy;
+  delete[] simSpecialistGone;
+  delete[] simSpecialistWoken;
+}
+
+#ifdef CLINIC_HAVE_CORO
+// Сопрограммы (--engine=coro). Повторяют patient_thread, duty_doctor_thread и
+// specialist_thread, но вместо блокировки потока приостанавливаются: ожидание
+// очереди - co_await pop(), прием - co_await sleep_for(), ожидание лечения -
+// co_await на событии пациента. Все сопрограммы выполняют coro_workers
+// потоков, а ждущий пациент занимает только кадр сопрограммы.
+CoroScheduler coroSched; // Планировщик сопрограмм
+CoroChannel<Patient *> coroCommonQueue(coroSched); // Очередь к дежурным
+CoroChannel<Patient *> coroSpecialistQueue[3] = {
+    CoroChannel<Patient *>(coroSched), CoroChannel<Patient *>(coroSched),
+    CoroChannel<Patient *>(coroSched)}; // Очереди к специалистам
+std::atomic<int> coroPatientsHome(0); // Число ушедших домой пациентов
+
+// Обработчик лечения в режиме сопрограмм: продолжаем сопрограмму пациента
+void wake_patient_coro(Patient *p) { p->treatedCoro.complete(coroSched); }
+
+// Все пациенты направлены: закрываем очереди, и ждущие врачи и специалисты
+// получают NULL
+void coro_close_queues() {
+  coroCommonQueue.close();
+  for (int i = 0; i < 3; i++) {
+    coroSpecialistQueue[i].close();
+  }
+}
+
+// Сопрограмма пациента
+CoroTask coro_patient(int pid) {
+  Patient *p = create_patient(pid, wake_patient_coro); // Создаем пациента
+  set_patient_state(p, WAITING_DUTY); // Пациент ждет дежурного врача
+  log_event("Patient P%d entered the queue to duty doctors\n",
+            p->id); // Логируем событие
+  trace_event(TRACE_PATIENT_ENTERED, 0, p->id, NONE); // Пишем в трассу
+  coroCommonQueue.push(p, p->priority, get_elapsed_ns()); // Встаем в очередь
+
+  co_await p->treatedCoro; // Ждем лечения, не занимая поток
+
+  log_event("Patient P%d fully treated and went home\n",
+            p->id); // Логируем событие вылеченного пациента
+  trace_event(TRACE_PATIENT_HOME, 0, p->id, p->specialist_type);
+  free_patient(p); // Освобождаем память под пациента
+  if (coroPatientsHome.fetch_add(1) + 1 == N) { // Ушли все пациенты
+    log_event("All patients have been treated\n");
+    trace_event(TRACE_ALL_TREATED, 0, 0, NONE); // Пишем в трассу
+  }
+}
+
+// Сопрограмма дежурного врача
+CoroTask coro_duty_doctor(int did) {
+  while (true) {
+    Patient *p = co_await coroCommonQueue.pop(); // Ждем пациента
+    if (p == NULL) { // Если все пациенты уже были направлены к специалистам
+      break;         // Завершаем работу врача
+    }
+    set_patient_state(p, AT_DUTY_DOCTOR); // Пациент на приеме у дежурного
+    log_event("Duty Doctor D%d accepted patient P%d\n", did,
+              p->id); // Логируем событие приема пациента
+    trace_event(TRACE_DUTY_ACCEPTED, did, p->id, NONE); // Пишем в трассу
+    co_await coroSched.sleep_for(
+        service_time(p, SERVICE_DUTY)); // Прием, не занимая поток
+
+    p->specialist_type = refer_patient(p); // Выбираем специалиста
+    const char *specName = (p->specialist_type == DENTIST) ? "Dentist"
+                           : (p->specialist_type == SURGEON)
+                               ? "Surgeon"
+                               : "Therapist"; // Определяем имя специалиста
+    log_event("Duty Doctor D%d referred patient P%d to %s\n", did, p->id,
+              specName); // Логируем направление к специалисту
+    trace_event(TRACE_DUTY_REFERRED, did, p->id, p->specialist_type);
+    set_patient_state(p, WAITING_SPECIALIST); // Пациент ждет специалиста
+    coroSpecialistQueue[p->specialist_type].push(p, p->priority,
+                                                 get_elapsed_ns());
+
+    referredBy.add(did - 1, 1); // Свой счетчик направленных
+    if (all_referred() && dayLatch.open()) { // Направлены все
+      coro_close_queues(); // Будим всех ждущих врачей и специалистов
+    }
+  }
+
+  log_event("Duty Doctor D%d ended his workday\n",
+            did); // Логируем завершение дежурного врача
+  trace_event(TRACE_DUTY_ENDED, did, 0, NONE); // Пишем в трассу
+}
+
+// Сопрограмма специалиста
+CoroTask coro_specialist(const SpecialistId *me) {
+  int sid = me->type;                      // Тип специалиста (его очередь)
+  std::string name = specialist_name(*me); // Определяем имя специалиста
+  const char *specName = name.c_str();     // Имя для лога
+
+  while (true) {
+    Patient *p = co_await coroSpecialistQueue[sid].pop(); // Ждем пациента
+    if (p == NULL) { // Если все пациенты направлены и очередь пуста
+      break;         // Завершаем работу этого специалиста
+    }
+    set_patient_state(p, IN_TREATMENT); // Пациент на лечении
+    log_event("%s started treating patient P%d\n", specName,
+              p->id); // Логируем начало лечения
+    trace_event(TRACE_TREATMENT_STARTED, me->number, p->id,
+                sid); // Пишем в трассу
+    co_await coroSched.sleep_for(service_time(p, sid)); // Лечение
+    log_event("%s finished treating patient P%d\n", specName,
+              p->id); // Логируем окончание лечения
+    trace_event(TRACE_TREATMENT_FINISHED, me->number, p->id,
+                sid); // Пишем в трассу
+
+    set_patient_state(p, TREATED); // Пациент вылечен
+    p->on_treated(p); // Продолжаем сопрограмму пациента
+  }
+
+  log_event("%s ended his workday\n",
+            specName); // Логируем завершение специалиста
+  trace_event(TRACE_SPECIALIST_ENDED, me->number, 0, sid); // Пишем в трассу
+}
+
+// Сопрограмма регистратуры: впускает пациентов в моменты их прихода
+CoroTask coro_reception() {
+  uint64_t start = CoroScheduler::now_ns(); // Начало приема пациентов
+  for (int i = 0; i < N; i++) {
+    co_await coroSched.sleep_until(start + arrivalTimes[i] * 1000); // Ждем
+    coroSched.spawn(coro_patient(i + 1)); // Пациент пришел
+  }
+}
+
+// Весь рабочий день на сопрограммах
+void run_coro_day() {
+  coroCommonQueue.set_aging(triage_aging_ms * 1000000ULL); // Старение (нс)
+  for (int i = 0; i < 3; i++) {
+    coroSpecialistQueue[i].set_aging(triage_aging_ms * 1000000ULL);
+  }
+  for (int i = 0; i < duty_count; i++) {
+    coroSched.spawn(coro_duty_doctor(i + 1)); // Дежурные врачи
+  }
+  for (int i = 0; i < specialist_total; i++) {
+    coroSched.spawn(coro_specialist(&specialistIds[i])); // Специалисты
+  }
+  coroSched.spawn(coro_reception()); // Регистратура впускает пациентов
+  if (N == 0) {
+    coro_close_queues(); // Пациентов не будет вовсе
+  }
+  coroSched.run(coro_workers); // Выполняем сопрограммы до конца дня
+}
+#endif // CLINIC_HAVE_CORO
+
+// Наибольшее число пациентов, которое может оказаться в клинике: в сети
+// клиник ей могут передать пациентов других клиник
+int clinic_capacity() { return shard_index >= 0 ? patientsNetwork : N; }
+
+// Запуск логгера после открытия файла логов
+bool open_log() {
+  if (log_mode == LOG_ASYNC) { // Асинхронный режим
+    async_log_start(fileno(log_file), log_console); // Запускаем писателя
+  }
+  if (!trace_filename.empty()) { // Нужна бинарная трасса
+    // Не больше 6 событий на пациента и передачи в сети клиник плюс уход
+    // врачей и конец дня
+    if (!trace_open(trace_filename.c_str(),
+                    7ULL * clinic_capacity() + duty_count + specialist_total +
+                        16,
+                    TRACE_PROGRAM_PTHREAD, N, t_d, t_s,
+                    output_filename.c_str(), duty_count,
+                    specialist_count)) {
+      std::cerr << "Failed to open trace file\n"; // Сообщаем об ошибке
+      return false; // Возвращаем false
+    }
+  }
+  return true;
+}
+
+// Остановка логгера и закрытие файла логов
+void close_log() {
+  if (log_mode == LOG_ASYNC) { // Асинхронный режим
+    async_log_stop(); // Дописываем все записи и останавливаем писателя
+  }
+  trace_close();    // Дописываем заголовок трассы
+  fclose(log_file); // Закрываем файл логов
+}
+
+// Итоги дня для --duty-queue=steal: сколько пациентов каждый дежурный врач
+// забрал у коллег и сколько забрали у него
+void log_steal_summary() {
+  for (int i = 0; i < duty_count; i++) {
+    log_event("Duty Doctor D%d stole %d patients, %d were stolen from him\n",
+              i + 1, dutyDeques[i].steals,
+              dutyDeques[i].stolen); // Логируем счетчики врача
+  }
+}
+
+// Итоги дня для --pin: сколько направлений и приемов шло через очередь на
+// чужом узле NUMA (на одном узле - всегда ноль)
+void log_placement_summary() {
+  int nodes = 1; // Узлов NUMA
+#ifdef CLINIC_HAVE_PIN
+  nodes = topology.nodes;
+#endif
+  log_event("Placement: %d NUMA nodes, cross-node referrals %d of %d, "
+            "cross-node treatments %d of %d\n",
+            nodes, crossNodeReferrals.load(), patientsExpected.load(),
+            crossNodeTreatments.load(), patientsExpected.load());
+}
+
+// Отчет --stats: процентили задержек по этапам (мс)
+void log_stats_report() {
+  const char *types[3] = {"dentist", "surgeon", "therapist"}; // Типы
+  char text[128]; // Строка процентилей одной гистограммы
+  log_event("Latency report (ms):\n");
+  dutyWaitHist.format(text, sizeof(text));
+  log_event("  duty queue wait: %s\n", text);
+  dutyTimeHist.format(text, sizeof(text));
+  log_event("  duty doctor time: %s\n", text);
+  specialistWaitHist.format(text, sizeof(text));
+  log_event("  specialist wait: %s\n", text);
+  for (int i = 0; i < 3; i++) {
+    specialistWaitHistBy[i].format(text, sizeof(text));
+    log_event("    %s: %s\n", types[i], text); // По типам специалистов
+  }
+  treatmentHist.format(text, sizeof(text));
+  log_event("  treatment: %s\n", text);
+  for (int i = 0; i < 3; i++) {
+    treatmentHistBy[i].format(text, sizeof(text));
+    log_event("    %s: %s\n", types[i], text);
+  }
+  endToEndHist.format(text, sizeof(text));
+  log_event("  end to end: %s\n", text);
+  if (triage_enabled(triage)) { // По уровням срочности
+    for (int i = 0; i < TRIAGE_LEVELS; i++) {
+      endToEndHistBy[i].format(text, sizeof(text));
+      log_event("    %s: %s\n", TRIAGE_NAMES[i], text);
+    }
+  }
+  log_event("  patient allocations: arena=%llu heap=%llu slots=%zu peak=%d\n",
+            (unsigned long long)patientArena.arena_allocs(),
+            (unsigned long long)patientArena.heap_allocs(),
+            patientArena.capacity(), patientArena.peak_in_use());
+  if (engine == ENGINE_REALTIME && queue_backend == QUEUE_MUTEX && N > 0) {
+    log_event("  queue locks per patient: acquisitions=%.2f signals=%.2f\n",
+              (double)lockAcquisitions.load() / N,
+              (double)condSignals.load() / N); // Цена синхронизации
+  }
+  if (lock_kind == LOCK_HYBRID) { // Статистика каждого гибридного мьютекса
+    char lock_text[256]; // Строка статистики мьютекса
+    spin_park_format(dutyDesk.spinLock.stats(), lock_text, sizeof(lock_text));
+    log_event("  duty queue lock: %s\n", lock_text);
+    for (int i = 0; i < 3; i++) {
+      spin_park_format(specialistDesk[i].spinLock.stats(), lock_text,
+                       sizeof(lock_text));
+      log_event("  %s queue lock: %s\n", types[i], lock_text);
+    }
+  }
+}
+
+// Итоги дня при открытом потоке пациентов: пропускная способность и
+// наибольшая длина очереди к дежурным врачам
+void log_arrival_summary(long long day_ms) {
+  double seconds = day_ms / 1000.0; // Длительность дня (с)
+  log_event("Throughput: %.2f patients/s, peak duty queue length: %d\n",
+            seconds > 0 ? patientsExpected.load() / seconds : 0.0,
+            dutyDesk.queuedPeak.load());
+}
+
+// Итоги направлений при политике, отличной от случайной: сколько пациентов
+// получил каждый тип специалистов и наибольшие длины их очередей
+void log_referral_summary() {
+  log_event("Referrals: dentist=%d, surgeon=%d, therapist=%d; peak specialist "
+            "queues: dentist=%d, surgeon=%d, therapist=%d\n",
+            specialistDesk[DENTIST].referrals.load(),
+            specialistDesk[SURGEON].referrals.load(),
+            specialistDesk[THERAPIST].referrals.load(),
+            specialistDesk[DENTIST].queuedPeak.load(),
+            specialistDesk[SURGEON].queuedPeak.load(),
+            specialistDesk[THERAPIST].queuedPeak.load());
+}
+
+// Функция отображения справки
+void print_help() {
+  std::cout
+      << "Usage: program [options]\n" // Выводим подсказку по использованию
+      << "Options:\n"
+      << "  -f <file>      Load parameters from configuration file\n"
+      << "  -n <number>    Number of patients\n"
+      << "  -t_d <ms>      Time for duty doctor to process a patient\n"
+      << "  -t_s <ms>      Time for specialist to treat a patient\n"
+      << "  -o <file>      Output log file\n"
+      << "  -d <count>     Number of duty doctors (default 2)\n"
+      << "  -s <list>      Specialists per specialty (default 1 each),\n"
+      << "                 e.g. dentist=4,surgeon=2,therapist=8\n"
+      << "  -arrival <spec>\n"
+      << "                 How patients arrive: all (default, everyone at\n"
+      << "                 once), poisson:rate=<per s>[,seed=<n>],\n"
+      << "                 burst:size=<k>,every=<ms> or trace:<file> with\n"
+      << "                 one arrival time (ms) per line\n"
+      << "  -seed <number> Seed of specialist referrals (default 42)\n"
+      << "  -service <stage>=<dist>\n"
+      << "                 Service time distribution of a stage (duty,\n"
+      << "                 dentist, surgeon, therapist or specialist):\n"
+      << "                 const (default), exp[:mean=<ms>],\n"
+      << "                 lognormal[:mean=<ms>,sigma=<s>] or\n"
+      << "                 empirical:<file>; all take ,seed=<n>\n"
+      << "  --referral=<random|round-robin|jsq|lew>\n"
+      << "                 How a duty doctor picks a specialty among those\n"
+      << "                 that suit the patient: at random (default), in\n"
+      << "                 turn, shortest queue or least expected work\n"
+      << "  --eligible=<1..3>\n"
+      << "                 Specialties that suit each patient (default 1\n"
+      << "                 for random and 3 for other policies)\n"
+      << "  --triage=urgent=<pct>,low=<pct>\n"
+      << "                 Share of urgent and low-priority patients; both\n"
+      << "                 queues serve urgent patients first (default off)\n"
+      << "  --aging=<ms>   Waiting time that raises a patient one priority\n"
+      << "                 level (default 1000, 0 - strict priorities)\n"
+      << "  --batch=<k>    Duty doctors take up to k patients per queue lock\n"
+      << "                 and refer them in bulk (default 1)\n"
+      << "  --arena=<on|off>\n"
+      << "                 Take patients from a preallocated cache-aligned\n"
+      << "                 arena (default) or from new/delete\n"
+      << "  --arena-slots=<number>\n"
+      << "                 Arena size (default one slot per patient); when\n"
+      << "                 it is full, patients come from the heap\n"
+      << "  --patient-model=<thread|pool>\n"
+      << "                 Patient model: thread per patient (default) or\n"
+      << "                 lightweight patient objects served by a pool\n"
+      << "  --pool-workers=<number>\n"
+      << "                 Number of pool threads for --patient-model=pool\n"
+      << "  --engine=<realtime|virtual|coro>\n"
+      << "                 Run with real threads and sleeps (default), as a\n"
+      << "                 discrete-event simulation on a virtual clock or as\n"
+      << "                 C++20 coroutines on a small thread pool\n"
+      << "  --coro-workers=<number>\n"
+      << "                 Threads running coroutines for --engine=coro\n"
+      << "                 (default 2)\n"
+      << "  --shards=<k>   Run a network of k clinics, each a process on its\n"
+      << "                 own cores with every k-th patient (default 1)\n"
+      << "  --shard-overflow=<n>\n"
+      << "                 Duty queue length from which arriving patients\n"
+      << "                 move to the clinic with the shortest queue\n"
+      << "                 (default 4)\n"
+      << "  --pin=<off|compact|spread|cpu list>\n"
+      << "                 Pin duty doctors and specialists to cores: in\n"
+      << "                 order node by node, round-robin over NUMA nodes\n"
+      << "                 or from a list like 0,2,4-7 (default off)\n"
+      << "  --duty-queue=<shared|steal>\n"
+      << "                 One queue for all duty doctors (default) or a\n"
+      << "                 queue per doctor with work stealing between them\n"
+      << "  --queue=<mutex|lockfree>\n"
+      << "                 Queue backend: std::queue under a mutex (default)\n"
+      << "                 or a lock-free MPMC ring with futex parking\n"
+      << "  --lock=<pthread|hybrid>\n"
+      << "                 Queue mutexes and condition variables: pthread\n"
+      << "                 (default) or spin with backoff, then futex park\n"
+      << "  --spin-budget=<n>\n"
+      << "                 Pause instructions a hybrid lock spins before\n"
+      << "                 parking (default 1000, 0 parks at once)\n"
+      << "  --log=<sync|async|off>\n"
+      << "                 Write log lines from the calling thread (default),\n"
+      << "                 batch them on a dedicated writer thread or skip\n"
+      << "                 the text log entirely\n"
+      << "  --console=<on|off>\n"
+      << "                 Duplicate the log to the console (default on)\n"
+      << "  --trace=<file> Write a binary event trace (clinic-trace)\n"
+      << "  --stats=<on|off>\n"
+      << "                 Report p50/p90/p99/max latency of every stage at\n"
+      << "                 the end of the day (default off)\n"
+      << "  --help [-h]    Display this help message\n";
+}
+
+// Функция отображения заданных для симуляции параметров
+void log_parameters() {
+  log_event("Simulation Parameters:\n"); // Логируем параметры задачи
+  log_event("Number of patients: %d\n", N); // Логируем количество пациентов
+  log_event("Duty doctor's processing time (ms): %d\n",
+            t_d); // Логируем время приема дежурного врача
+  log_event("Specialist's treatment time (ms): %d\n",
+            t_s); // Логируем время приема специалиста
+  if (duty_count != 2 || specialist_count[DENTIST] != 1 ||
+      specialist_count[SURGEON] != 1 ||
+      specialist_count[THERAPIST] != 1) { // Штат отличается от стандартного
+    log_event("Duty doctors: %d\n", duty_count); // Логируем число дежурных
+    log_event("Specialists: dentist=%d, surgeon=%d, therapist=%d\n",
+              specialist_count[DENTIST], specialist_count[SURGEON],
+              specialist_count[THERAPIST]); // Логируем число специалистов
+  }
+  if (arrival.kind != ARRIVAL_ALL) { // Пациенты приходят в течение дня
+    log_event("Arrivals: %s\n", arrival.text.c_str()); // Логируем поток
+  }
+  if (referral_seed != 42) { // Сид направлений отличается от стандартного
+    log_event("Referral seed: %u\n", referral_seed); // Логируем сид
+  }
+  if (referral_policy != REFERRAL_RANDOM || referral_choices != 1) {
+    log_event("Referral policy: %s, eligible specialties: %d\n",
+              REFERRAL_NAMES[referral_policy], referral_choices); // Политика
+  }
+  if (triage_enabled(triage)) { // Пациенты разной срочности
+    log_event("Triage: %s, aging %d ms\n", triage.text.c_str(),
+              triage_aging_ms); // Логируем доли и шаг старения
+  }
+  if (batch_size > 1) { // Пакетный прием
+    log_event("Batch intake: %d patients\n", batch_size); // Логируем размер
+  }
+  if (lock_kind == LOCK_HYBRID) { // Гибридные мьютексы очередей
+    log_event("Hybrid queue locks: spin budget %d pauses\n", spin_budget);
+  }
+  if (engine == ENGINE_CORO) { // Сопрограммы на пуле потоков
+    log_event("Coroutine engine: %d worker threads\n", coro_workers);
+  }
+  if (shard_index >= 0) { // Клиника сети
+    log_event("Clinic %d of %d, CPUs %s\n", shard_index + 1, shard_count,
+              shardCpus.c_str());
+  } else if (shard_count > 1) { // Процесс сети
+    log_event("Clinic network: %d clinics, transfer from duty queue %d\n",
+              shard_count, shard_overflow);
+  }
+#ifdef CLINIC_HAVE_PIN
+  if (pin_enabled && !staffCpu.empty()) { // Персонал привязан к ядрам
+    log_event("Thread pinning: %s, %d NUMA nodes, duty doctors on CPUs %s, "
+              "specialists on CPUs %s\n",
+              pin.text.c_str(), topology.nodes,
+              cpu_list(0, duty_count).c_str(),
+              cpu_list(duty_count, specialist_total).c_str());
+  }
+#endif
+  std::string service = service_describe(serviceDist); // Распределения
+  if (!service.empty()) { // Время приема не постоянное
+    log_event("Service times: %s\n", service.c_str()); // Логируем их
+  }
+  log_event("Log file: %s\n\n",
+            output_filename.c_str()); // Логируем имя файла для логов
+}
+
+// Номер пациента с порядковым номером i среди пациентов клиники
+int patient_id(int i) { return shard_index >= 0 ? shardPatients[i] : i + 1; }
+
+#ifdef CLINIC_HAVE_SHARDS
+// Сеть клиник (--shards). Родительский процесс создает ShardNetwork и
+// запускает по процессу на клинику; каждая клиника - обычный рабочий день
+// этой программы со своими очередями, мьютексами, логом и ядрами. Клиника
+// принимает каждого shard_count-го пациента. Если к моменту прихода пациента
+// очередь к дежурным не короче --shard-overflow, пациент уходит в клинику с
+// самой короткой очередью через ее входящий канал; там его принимает поток
+// регистратуры shard_desk_thread. День клиники заканчивается, когда все
+// клиники впустили своих пациентов и все переданные ей пациенты приняты.
+pthread_t shardDesk; // Поток регистратуры для переданных пациентов
+std::vector<pthread_t> shardDeskPatients; // Потоки принятых пациентов
+
+// Имя файла клиники k: "output.txt" -> "output.shard2.txt"
+std::string shard_file_name(const std::string &name, int k) {
+  size_t dot = name.find_last_of('.');   // Начало расширения
+  size_t slash = name.find_last_of('/'); // Конец пути к каталогу
+  if (dot == std::string::npos ||
+      (slash != std::string::npos && dot < slash)) { // Расширения нет
+    dot = name.size();
+  }
+  return name.substr(0, dot) + ".shard" + std::to_string(k) + name.substr(dot);
+}
+
+// Передача пришедшего пациента pid в другую клинику, если своя очередь
+// переполнена; false - пациент остается
+bool shard_transfer(int pid) {
+  int to = shard_pick(shardNet, shard_index, shard_overflow); // Куда
+  if (to < 0) {
+    return false; // Очередь не переполнена или все очереди не короче
+  }
+  ShardSlot &slot = shardNet->slots[to];
+  slot.transfersIn.fetch_add(1); // Сначала счетчик: клиника to ждет пациента
+  if (!slot.inbox.try_push(ShardTransfer{pid, shard_index})) {
+    slot.transfersIn.fetch_sub(1); // Канал полон - пациент остается
+    slot.arrivals.notify_one(); // Регистратура могла ждать этого пациента
+    return false;
+  }
+  slot.arrivals.notify_one(); // Будим регистратуру клиники to
+  shardNet->slots[shard_index].transfersOut.fetch_add(1);
+  patientsExpected.fetch_sub(1); // Пациентом меньше
+  log_event("Patient P%d transferred to clinic %d\n", pid, to + 1);
+  trace_event(TRACE_PATIENT_TRANSFERRED_OUT, to + 1, pid, NONE);
+  return true;
+}
+
+// Поток регистратуры: принимает пациентов из входящего канала, пока не
+// кончатся пациенты сети, затем ждет ушедших домой принятых пациентов
+void *shard_desk_thread(void *arg) {
+  (void)arg; // Аргумент не используется
+  ShardSlot &self = shardNet->slots[shard_index]; // Своя клиника
+  int received = 0; // Принято переданных пациентов
+  while (true) {
+    ShardTransfer t;
+    if (!self.inbox.try_pop(t)) { // Канал пуст
+      uint32_t key = self.arrivals.prepare_wait(); // Готовимся уснуть
+      if (self.inbox.try_pop(t)) {                 // Повторная проверка
+        self.arrivals.cancel_wait();
+      } else if (shardNet->admitting.load() == 0 &&
+                 received == self.transfersIn.load()) {
+        // Все клиники впустили своих пациентов, значит transfersIn больше
+        // не растет; все переданные приняты - пациентов больше не будет
+        self.arrivals.cancel_wait();
+        break;
+      } else {
+        self.arrivals.wait(key); // Спим до передачи или конца приема
+        continue;
+      }
+    }
+    received++; // Пришел переданный пациент
+    patientsExpected.fetch_add(1); // Пациентом больше
+    log_event("Patient P%d transferred from clinic %d\n", t.patient,
+              t.from + 1);
+    trace_event(TRACE_PATIENT_TRANSFERRED_IN, t.from + 1, t.patient, NONE);
+    pthread_t th;
+    pthread_create(&th, NULL, patient_thread,
+                   (void *)(intptr_t)t.patient); // Создаем поток пациента
+    shardDeskPatients.push_back(th);
+  }
+
+  admissionsClosed.store(true); // Закрываем прием
+  check_all_referred(); // Возможно, все уже направлены
+
+  for (size_t i = 0; i < shardDeskPatients.size(); i++) {
+    pthread_join(shardDeskPatients[i], NULL); // Ждем принятых пациентов
+  }
+  return NULL;
+}
+
+// Клиника s: привязка к ядрам, свои пациенты, свои файлы лога и трассы
+void shard_setup(int s) {
+  shard_index = s;
+  shardCpus = shard_pin(s, shard_count); // Привязываем процесс к ядрам
+  patientsNetwork = N;
+  std::vector<uint64_t> times; // Моменты прихода своих пациентов
+  for (int i = s; i < N; i += shard_count) {
+    shardPatients.push_back(i + 1);
+    times.push_back(arrivalTimes[i]);
+  }
+  arrivalTimes.swap(times);
+  N = (int)shardPatients.size();
+  patientsExpected.store(N);
+  admissionsClosed.store(false); // Пациенты могут прийти из других клиник
+  output_filename = shard_file_name(output_filename, s + 1);
+  if (!trace_filename.empty()) {
+    trace_filename = shard_file_name(trace_filename, s + 1);
+  }
+}
+
+// Поток регистратуры клиники запускается вместе с приемом пациентов
+void shard_open() {
+  shardNet->slots[shard_index].startNs.store(get_elapsed_ns());
+  pthread_create(&shardDesk, NULL, shard_desk_thread, NULL);
+}
+
+// Свои пациенты впущены: ждем конца приема переданных пациентов
+void shard_close() {
+  shard_admission_closed(shardNet); // Своих пациентов больше не будет
+  pthread_join(shardDesk, NULL);
+}
+
+// Итоги клиники для родительского процесса
+void shard_finish() {
+  ShardSlot &self = shardNet->slots[shard_index];
+  self.treated.store(patientsExpected.load()); // Все пациенты вылечены
+  self.endNs.store(get_elapsed_ns());
+}
+
+// Итоги сети в лог родительского процесса
+void log_network_summary() {
+  long long start = -1; // Начало приема в первой клинике (нс)
+  long long end = 0;    // Конец дня в последней клинике (нс)
+  int transfers = 0;    // Передач между клиниками
+  for (int s = 0; s < shard_count; s++) {
+    ShardSlot &slot = shardNet->slots[s];
+    long long day_ms = (slot.endNs.load() - slot.startNs.load()) / 1000000;
+    log_event("Clinic %d: %d patients treated, %d transferred in, %d "
+              "transferred out, workday %lld ms\n",
+              s + 1, slot.treated.load(), slot.transfersIn.load(),
+              slot.transfersOut.load(), day_ms);
+    if (start < 0 || slot.startNs.load() < start) {
+      start = slot.startNs.load();
+    }
+    if (slot.endNs.load() > end) {
+      end = slot.endNs.load();
+    }
+    transfers += slot.transfersOut.load();
+  }
+  double seconds = (end - start) / 1e9; // Длительность дня сети (с)
+  log_event("Clinic network: %d patients, %d transfers, throughput %.2f "
+            "patients/s\n",
+            N, transfers, seconds > 0 ? N / seconds : 0.0);
+}
+
+// Запуск сети клиник. В процессе клиники возвращает -1, и main проводит ее
+// рабочий день; в родительском процессе ждет все клиники, пишет итоги сети
+// в output_filename и возвращает код завершения программы.
+int run_shards() {
+  shardNet = shard_network_create(shard_count); // Разделяемая память сети
+  if (!shardNet) {
+    std::cerr << "Failed to map the clinic network\n"; // Сообщаем об ошибке
+    return 1;
+  }
+  fflush(stdout); // Не дублируем буфер консоли в процессах клиник
+  std::vector<pid_t> children; // Процессы клиник
+  int started = 0;             // Запущено клиник
+  for (; started < shard_count; started++) {
+    pid_t pid = fork();
+    if (pid == 0) { // Процесс клиники
+      shard_setup(started);
+      return -1;
+    }
+    if (pid < 0) { // Не удалось запустить клинику
+      break;
+    }
+    children.push_back(pid);
+  }
+  for (int s = started; s < shard_count; s++) { // Незапущенные клиники
+    shardNet->slots[s].dutyWaiting.store(INT_MAX); // не принимают пациентов
+    shard_admission_closed(shardNet);              // и не ждут своих
+  }
+
+  bool ok = started == shard_count; // Все клиники отработали день
+  for (size_t i = 0; i < children.size(); i++) {
+    int status = 0;
+    waitpid(children[i], &status, 0); // Ждем конца дня клиники
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      ok = false;
+    }
+  }
+
+  log_file = fopen(output_filename.c_str(), "w+"); // Лог сети
+  if (!log_file) {
+    std::cerr << "Failed to open output file\n"; // Сообщаем об ошибке
+    shard_network_destroy(shardNet);
+    return 1;
+  }
+  if (log_mode == LOG_ASYNC) { // Процесс сети пишет несколько строк сам
+    log_mode = LOG_SYNC;
+  }
+  log_parameters();      // Логируем параметры сети
+  log_network_summary(); // Логируем итоги клиник и сети
+  fclose(log_file);
+  shard_network_destroy(shardNet);
+  if (!ok) {
+    std::cerr << "Some clinics failed to complete their workday\n";
+    return 1;
+  }
+  return 0;
+}
+#endif // CLINIC_HAVE_SHARDS
+
+// Разбор названия модели пациентов
+bool parse_patient_model(const char *name) {
+  if (strcmp(name, "thread") == 0) {
+    patient_model = MODEL_THREAD; // Поток на каждого пациента
+  } else if (strcmp(name, "pool") == 0) {
+    patient_model = MODEL_POOL; // Объекты-состояния и пул потоков
+  } else {
+    std::cerr << "Unknown patient model: " << name << "\n"; // Сообщаем
+    return false; // Неизвестная модель
+  }
+  return true;
+}
+
+// Разбор названия движка симуляции
+bool parse_engine(const char *name) {
+  if (strcmp(name, "realtime") == 0) {
+    engine = ENGINE_REALTIME; // Реальные потоки и задержки
+  } else if (strcmp(name, "virtual") == 0) {
+    engine = ENGINE_VIRTUAL; // Дискретно-событийная симуляция
+  } else if (strcmp(name, "coro") == 0) {
+    engine = ENGINE_CORO; // Сопрограммы на пуле потоков
+  } else {
+    std::cerr << "Unknown engine: " << name << "\n"; // Сообщаем об ошибке
+    return false; // Неизвестный движок
+  }
+  return true;
+}
+
+// Разбор названия реализации очередей
+bool parse_queue_backend(const char *name) {
+  if (strcmp(name, "mutex") == 0) {
+    queue_backend = QUEUE_MUTEX; // Очереди под мьютексами
+  } else if (strcmp(name, "lockfree") == 0) {
+    queue_backend = QUEUE_LOCKFREE; // Lock-free очереди
+  } else {
+    std::cerr << "Unknown queue backend: " << name << "\n"; // Сообщаем
+    return false; // Неизвестная реализация
+  }
+  return true;
+}
+
+// Разбор вида мьютексов очередей
+bool parse_lock_kind(const char *name) {
+  if (strcmp(name, "pthread") == 0) {
+    lock_kind = LOCK_PTHREAD; // Мьютексы pthread
+  } else if (strcmp(name, "hybrid") == 0) {
+    lock_kind = LOCK_HYBRID; // Гибридные мьютексы
+  } else {
+    std::cerr << "Unknown lock kind: " << name << "\n"; // Сообщаем
+    return false; // Неизвестный вид
+  }
+  return true;
+}
+
+// Политика размещения персонала по ядрам (--pin)
+bool parse_pin(const char *text) {
+#ifdef CLINIC_HAVE_PIN
+  if (!pin_parse(text, &pin)) {
+    std::cerr << "Unknown pin policy: " << text << "\n";
+    return false; // Ни политика, ни список ядер
+  }
+  pin_enabled = pin.policy != PIN_OFF;
+#else
+  pin_enabled = strcmp(text, "off") != 0; // Отказ будет при проверке
+#endif
+  return true;
+}
+
+// Разбор режима очереди к дежурным врачам
+bool parse_duty_queue(const char *name) {
+  if (strcmp(name, "shared") == 0) {
+    duty_queue = DUTY_SHARED; // Общая очередь
+  } else if (strcmp(name, "steal") == 0) {
+    duty_queue = DUTY_STEAL; // Свои очереди и кража работы
+  } else {
+    std::cerr << "Unknown duty queue mode: " << name << "\n"; // Сообщаем
+    return false; // Неизвестный режим
+  }
+  return true;
+}
+
+// Разбор режима логирования
+bool parse_log_mode(const char *name) {
+  if (strcmp(name, "sync") == 0) {
+    log_mode = LOG_SYNC; // Синхронная запись
+  } else if (strcmp(name, "async") == 0) {
+    log_mode = LOG_ASYNC; // Поток-писатель
+  } else if (strcmp(name, "off") == 0) {
+    log_mode = LOG_OFF; // Без текстового лога
+  } else {
+    std::cerr << "Unknown log mode: " << name << "\n"; // Сообщаем об ошибке
+    return false; // Неизвестный режим
+  }
+  return true;
+}
+
+// Разбор списка специалистов вида "dentist=4,surgeon=2,therapist=8".
+// Не упомянутые в списке типы сохраняют прежнее число специалистов.
+bool parse_specialists(const char *list) {
+  std::string text = list; // Список для разбора
+  size_t pos = 0;          // Начало очередного элемента
+  while (pos <= text.size()) {
+    size_t end = text.find(',', pos); // Конец элемента
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    std::string item = text.substr(pos, end - pos); // Элемент "тип=число"
+    size_t eq = item.find('=');
+    if (eq == std::string::npos) {
+      std::cerr << "Bad specialist entry: " << item << "\n"; // Сообщаем
+      return false; // Нет числа
+    }
+    std::string name = item.substr(0, eq);              // Тип специалиста
+    int count = atoi(item.substr(eq + 1).c_str());      // Число специалистов
+    if (name == "dentist") {
+      specialist_count[DENTIST] = count; // Стоматологи
+    } else if (name == "surgeon") {
+      specialist_count[SURGEON] = count; // Хирурги
+    } else if (name == "therapist") {
+      specialist_count[THERAPIST] = count; // Терапевты
+    } else {
+      std::cerr << "Unknown specialist: " << name << "\n"; // Сообщаем
+      return false; // Неизвестный тип
+    }
+    pos = end + 1; // Переходим к следующему элементу
+  }
+  return true;
+}
+
+// Разбор флага вывода лога в консоль
+bool parse_console(const char *value) {
+  if (strcmp(value, "on") == 0) {
+    log_console = true; // Выводим в консоль
+  } else if (strcmp(value, "off") == 0) {
+    log_console = false; // Только файл
+  } else {
+    std::cerr << "Unknown console option: " << value << "\n"; // Сообщаем
+    return false; // Неизвестное значение
+  }
+  return true;
+}
+
+// Разбор флага арены пациентов
+bool parse_arena(const char *value) {
+  if (strcmp(value, "on") == 0) {
+    arena_enabled = true; // Пациенты из арены
+  } else if (strcmp(value, "off") == 0) {
+    arena_enabled = false; // Пациенты через new/delete
+  } else {
+    std::cerr << "Unknown arena option: " << value << "\n"; // Сообщаем
+    return false; // Неизвестное значение
+  }
+  return true;
+}
+
+// Разбор флага сбора гистограмм задержек
+bool parse_stats(const char *value) {
+  if (strcmp(value, "on") == 0) {
+    stats_enabled = true; // Собираем гистограммы
+  } else if (strcmp(value, "off") == 0) {
+    stats_enabled = false; // Без гистограмм
+  } else {
+    std::cerr << "Unknown stats option: " << value << "\n"; // Сообщаем
+    return false; // Неизвестное значение
+  }
+  return true;
+}
+
+// Функция парсинга командной строки или файла
+bool parse_args(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) { // Идем по всем аргументам командной строки
+    if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      print_help(); // Если запрошена помощь, выводим ее
+      exit(0);      // И выходим
+    } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      from_file = true; // Отмечаем что нужно читать из файла
+      config_filename = argv[++i]; // Запоминаем имя файла
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      N = atoi(argv[++i]); // Читаем количество пациентов
+    } else if (strcmp(argv[i], "-t_d") == 0 && i + 1 < argc) {
+      t_d = atoi(argv[++i]); // Читаем время дежурного врача
+    } else if (strcmp(argv[i], "-t_s") == 0 && i + 1 < argc) {
+      t_s = atoi(argv[++i]); // Читаем время специалиста
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output_filename = argv[++i]; // Читаем имя файла для логов
+    } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      duty_count = atoi(argv[++i]); // Читаем число дежурных врачей
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      if (!parse_specialists(argv[++i])) { // Читаем число специалистов
+        return false;                      // Ошибка в списке
+      }
+    } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+      referral_seed = (unsigned)atol(argv[++i]); // Читаем сид направлений
+    } else if (strcmp(argv[i], "-service") == 0 && i + 1 < argc) {
+      if (!service_parse_assignment(argv[++i], serviceDist)) { // Читаем
+        return false; // Ошибка в описании распределения
+      }
+    } else if (strcmp(argv[i], "-arrival") == 0 && i + 1 < argc) {
+      if (!arrival_parse(argv[++i], &arrival)) { // Читаем поток пациентов
+        return false;                            // Ошибка в описании
+      }
+    } else if (strncmp(argv[i], "--referral=", 11) == 0) {
+      if (!referral_policy_parse(argv[i] + 11, &referral_policy)) { // Читаем
+        return false; // Неизвестная политика
+      }
+    } else if (strncmp(argv[i], "--eligible=", 11) == 0) {
+      referral_choices = atoi(argv[i] + 11); // Читаем число подходящих типов
+    } else if (strncmp(argv[i], "--triage=", 9) == 0) {
+      if (!triage_parse(argv[i] + 9, &triage)) { // Читаем доли срочности
+        return false;                            // Ошибка в описании
+      }
+    } else if (strncmp(argv[i], "--aging=", 8) == 0) {
+      triage_aging_ms = atoi(argv[i] + 8); // Читаем шаг старения
+    } else if (strncmp(argv[i], "--batch=", 8) == 0) {
+      batch_size = atoi(argv[i] + 8); // Читаем размер пакета
+    } else if (strncmp(argv[i], "--arena=", 8) == 0) {
+      if (!parse_arena(argv[i] + 8)) { // Читаем флаг арены
+        return false;                  // Неизвестное значение
+      }
+    } else if (strncmp(argv[i], "--arena-slots=", 14) == 0) {
+      arena_slots = atoi(argv[i] + 14); // Читаем размер арены
+    } else if (strncmp(argv[i], "--patient-model=", 16) == 0) {
+      if (!parse_patient_model(argv[i] + 16)) { // Читаем модель пациентов
+        return false; // Неизвестная модель
+      }
+    } else if (strncmp(argv[i], "--pool-workers=", 15) == 0) {
+      pool_workers = atoi(argv[i] + 15); // Читаем число потоков пула
+    } else if (strncmp(argv[i], "--coro-workers=", 15) == 0) {
+      coro_workers = atoi(argv[i] + 15); // Читаем число потоков сопрограмм
+    } else if (strncmp(argv[i], "--shards=", 9) == 0) {
+      shard_count = atoi(argv[i] + 9); // Читаем число клиник сети
+    } else if (strncmp(argv[i], "--shard-overflow=", 17) == 0) {
+      shard_overflow = atoi(argv[i] + 17); // Читаем порог передачи
+    } else if (strncmp(argv[i], "--pin=", 6) == 0) {
+      if (!parse_pin(argv[i] + 6)) { // Читаем политику размещения
+        return false;                // Неизвестная политика
+      }
+    } else if (strncmp(argv[i], "--engine=", 9) == 0) {
+      if (!parse_engine(argv[i] + 9)) { // Читаем движок симуляции
+        return false;                   // Неизвестный движок
+      }
+    } else if (strncmp(argv[i], "--duty-queue=", 13) == 0) {
+      if (!parse_duty_queue(argv[i] + 13)) { // Читаем режим очереди дежурных
+        return false;                        // Неизвестный режим
+      }
+    } else if (strncmp(argv[i], "--queue=", 8) == 0) {
+      if (!parse_queue_backend(argv[i] + 8)) { // Читаем реализацию очередей
+        return false; // Неизвестная реализация
+      }
+    } else if (strncmp(argv[i], "--lock=", 7) == 0) {
+      if (!parse_lock_kind(argv[i] + 7)) { // Читаем вид мьютексов
+        return false;                      // Неизвестный вид
+      }
+    } else if (strncmp(argv[i], "--spin-budget=", 14) == 0) {
+      spin_budget = atoi(argv[i] + 14); // Читаем бюджет ожидания в цикле
+    } else if (strncmp(argv[i], "--log=", 6) == 0) {
+      if (!parse_log_mode(argv[i] + 6)) { // Читаем режим логирования
+        return false;                     // Неизвестный режим
+      }
+    } else if (strncmp(argv[i], "--console=", 10) == 0) {
+      if (!parse_console(argv[i] + 10)) { // Читаем вывод в консоль
+        return false;                     // Неизвестное значение
+      }
+    } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+      trace_filename = argv[i] + 8; // Читаем имя файла трассы
+    } else if (strncmp(argv[i], "--stats=", 8) == 0) {
+      if (!parse_stats(argv[i] + 8)) { // Читаем флаг гистограмм
+        return false;                  // Неизвестное значение
+      }
+    }
+  }
+
+  if (from_file) { // Если нужно читать из файла конфигурации
+    std::ifstream fin(config_filename.c_str()); // Открываем файл
+    if (!fin) { // Если не удалось открыть
+      std::cerr << "Failed to open configuration file\n"; // Сообщаем об ошибке
+      return false; // Возвращаем false
+    }
+    std::string line;                 // Строка для чтения
+    while (std::getline(fin, line)) { // Читаем построчно
+      if (line.find("n=") == 0) {
+        N = atoi(line.substr(2).c_str()); // Читаем N
+      } else if (line.find("t_d=") == 0) {
+        t_d = atoi(line.substr(4).c_str()); // Читаем t_d
+      } else if (line.find("t_s=") == 0) {
+        t_s = atoi(line.substr(4).c_str()); // Читаем t_s
+      } else if (line.find("o=") == 0) {
+        output_filename = line.substr(2); // Читаем имя файла логов
+      } else if (line.find("d=") == 0) {
+        duty_count = atoi(line.substr(2).c_str()); // Читаем число дежурных
+      } else if (line.find("s=") == 0) {
+        if (!parse_specialists(line.substr(2).c_str())) { // Читаем специалистов
+          return false; // Ошибка в списке
+        }
+      } else if (line.find("seed=") == 0) {
+        referral_seed = (unsigned)atol(line.substr(5).c_str()); // Сид
+      } else if (line.find("service=") == 0) {
+        if (!service_parse_assignment(line.substr(8).c_str(), serviceDist)) {
+          return false; // Ошибка в описании распределения
+        }
+      } else if (line.find("arrival=") == 0) {
+        if (!arrival_parse(line.substr(8).c_str(), &arrival)) { // Читаем поток
+          return false; // Ошибка в описании
+        }
+      } else if (line.find("referral=") == 0) {
+        if (!referral_policy_parse(line.substr(9).c_str(), &referral_policy)) {
+          return false; // Неизвестная политика
+        }
+      } else if (line.find("eligible=") == 0) {
+        referral_choices = atoi(line.substr(9).c_str()); // Подходящих типов
+      } else if (line.find("triage=") == 0) {
+        if (!triage_parse(line.substr(7).c_str(), &triage)) { // Срочность
+          return false; // Ошибка в описании
+        }
+      } else if (line.find("aging=") == 0) {
+        triage_aging_ms = atoi(line.substr(6).c_str()); // Шаг старения
+      } else if (line.find("batch=") == 0) {
+        batch_size = atoi(line.substr(6).c_str()); // Размер пакета
+      } else if (line.find("arena=") == 0) {
+        if (!parse_arena(line.substr(6).c_str())) { // Читаем флаг арены
+          return false; // Неизвестное значение
+        }
+      } else if (line.find("arena_slots=") == 0) {
+        arena_slots = atoi(line.substr(12).c_str()); // Размер арены
+      } else if (line.find("patient_model=") == 0) {
+        if (!parse_patient_model(line.substr(14).c_str())) { // Читаем модель
+          return false; // Неизвестная модель
+        }
+      } else if (line.find("pool_workers=") == 0) {
+        pool_workers = atoi(line.substr(13).c_str()); // Читаем размер пула
+      } else if (line.find("coro_workers=") == 0) {
+        coro_workers = atoi(line.substr(13).c_str()); // Потоков сопрограмм
+      } else if (line.find("shards=") == 0) {
+        shard_count = atoi(line.substr(7).c_str()); // Число клиник сети
+      } else if (line.find("shard_overflow=") == 0) {
+        shard_overflow = atoi(line.substr(15).c_str()); // Порог передачи
+      } else if (line.find("pin=") == 0) {
+        if (!parse_pin(line.substr(4).c_str())) { // Читаем размещение
+          return false;                           // Неизвестная политика
+        }
+      } else if (line.find("engine=") == 0) {
+        if (!parse_engine(line.substr(7).c_str())) { // Читаем движок
+          return false;                              // Неизвестный движок
+        }
+      } else if (line.find("duty_queue=") == 0) {
+        if (!parse_duty_queue(line.substr(11).c_str())) { // Читаем режим
+          return false; // Неизвестный режим
+        }
+      } else if (line.find("queue=") == 0) {
+        if (!parse_queue_backend(line.substr(6).c_str())) { // Читаем очереди
+          return false; // Неизвестная реализация
+        }
+      } else if (line.find("lock=") == 0) {
+        if (!parse_lock_kind(line.substr(5).c_str())) { // Вид мьютексов
+          return false; // Неизвестный вид
+        }
+      } else if (line.find("spin_budget=") == 0) {
+        spin_budget = atoi(line.substr(12).c_str()); // Бюджет в цикле
+      } else if (line.find("log=") == 0) {
+        if (!parse_log_mode(line.substr(4).c_str())) { // Читаем режим лога
+          return false; // Неизвестный режим
+        }
+      } else if (line.find("console=") == 0) {
+        if (!parse_console(line.substr(8).c_str())) { // Читаем вывод в консоль
+          return false; // Неизвестное значение
+        }
+      } else if (line.find("trace=") == 0) {
+        trace_filename = line.substr(6); // Читаем имя файла трассы
+      } else if (line.find("stats=") == 0) {
+        if (!parse_stats(line.substr(6).c_str())) { // Читаем флаг гистограмм
+          return false; // Неизвестное значение
+        }
+      }
+    }
+  }
+
+  if (duty_count < 1) { // Нужен хотя бы один дежурный врач
+    std::cerr << "Clinic must have at least one duty doctor\n"; // Сообщаем
+    return false; // Возвращаем false
+  }
+  for (int i = 0; i < 3; i++) {
+    if (specialist_count[i] < 1) { // И хотя бы один специалист каждого типа
+      std::cerr << "Clinic must have at least one specialist of each type\n";
+      return false; // Возвращаем false
+    }
+  }
+
+  if (referral_choices == 0) { // Число подходящих типов не задано
+    referral_choices = referral_policy == REFERRAL_RANDOM ? 1 : 3;
+  }
+  if (referral_choices < 1 || referral_choices > 3) { // От 1 до 3 типов
+    std::cerr << "Eligible specialties must be from 1 to 3\n"; // Сообщаем
+    return false; // Возвращаем false
+  }
+
+  if (triage_aging_ms < 0) { // Шаг старения не может быть отрицательным
+    std::cerr << "Aging must be non-negative\n"; // Сообщаем об ошибке
+    return false; // Возвращаем false
+  }
+  if (triage_enabled(triage) &&
+      (queue_backend != QUEUE_MUTEX || duty_queue != DUTY_SHARED)) {
+    std::cerr << "Triage requires --queue=mutex and --duty-queue=shared\n";
+    return false; // Очереди по срочности есть только у этих режимов
+  }
+
+  if (batch_size < 1) { // Пакет не может быть пустым
+    std::cerr << "Batch size must be at least 1\n"; // Сообщаем об ошибке
+    return false; // Возвращаем false
+  }
+  if (batch_size > 1 &&
+      (queue_backend != QUEUE_MUTEX || duty_queue != DUTY_SHARED ||
+       engine != ENGINE_REALTIME)) {
+    std::cerr << "Batch intake requires --queue=mutex, --duty-queue=shared "
+                 "and --engine=realtime\n";
+    return false; // Пакеты есть только у общей очереди под мьютексом
+  }
+
+  if (arena_slots < 0) { // Размер арены не может быть отрицательным
+    std::cerr << "Arena slots must be non-negative\n"; // Сообщаем об ошибке
+    return false; // Возвращаем false
+  }
+
+  if (pool_workers < 1) { // Пулу нужен хотя бы один поток
+    std::cerr << "Pool must have at least one worker\n"; // Сообщаем об ошибке
+    return false; // Возвращаем false
+  }
+
+  if (engine == ENGINE_CORO) { // Сопрограммы
+#ifndef CLINIC_HAVE_CORO
+    std::cerr << "Coroutine engine requires a C++20 build (-std=c++20)\n";
+    return false; // Сопрограммы не собраны
+#endif
+    if (queue_backend != QUEUE_MUTEX || duty_queue != DUTY_SHARED) {
+      std::cerr << "Coroutine engine requires --queue=mutex and "
+                   "--duty-queue=shared\n";
+      return false; // У сопрограмм свои очереди с ожиданием
+    }
+  }
+  if (engine == ENGINE_VIRTUAL &&
+      (queue_backend != QUEUE_MUTEX || duty_queue != DUTY_SHARED)) {
+    std::cerr << "Virtual engine requires --queue=mutex and "
+                 "--duty-queue=shared\n";
+    return false; // Календарь событий ведет только общие очереди
+  }
+  if (spin_budget < 0) { // Бюджет ожидания в цикле
+    std::cerr << "Spin budget cannot be negative\n";
+    return false; // Возвращаем false
+  }
+  if (lock_kind == LOCK_HYBRID &&
+      (engine != ENGINE_REALTIME || queue_backend != QUEUE_MUTEX)) {
+    std::cerr << "Hybrid locks require --engine=realtime and --queue=mutex\n";
+    return false; // Только там есть мьютексы очередей
+  }
+  if (coro_workers < 1) { // Сопрограммам нужен хотя бы один поток
+    std::cerr << "Coroutine engine must have at least one worker\n";
+    return false; // Возвращаем false
+  }
+
+  if (shard_count < 1 || shard_overflow < 1) { // Хотя бы одна клиника
+    std::cerr << "Shards and shard overflow must be at least 1\n";
+    return false; // Возвращаем false
+  }
+  if (shard_count > 1) { // Сеть клиник
+#ifndef CLINIC_HAVE_SHARDS
+    std::cerr << "Clinic network requires fork() and mmap()\n";
+    return false; // Процессов клиник не будет
+#endif
+    if (engine != ENGINE_REALTIME || patient_model != MODEL_THREAD) {
+      std::cerr << "Clinic network requires --engine=realtime and "
+                   "--patient-model=thread\n";
+      return false; // Переданного пациента принимает поток пациента
+    }
+  }
+  if (pin_enabled) { // Привязка персонала к ядрам
+#ifndef CLINIC_HAVE_PIN
+    std::cerr << "Thread pinning requires Linux\n";
+    return false; // Нет sched_setaffinity и mbind
+#else
+    if (engine != ENGINE_REALTIME) {
+      std::cerr << "Thread pinning requires --engine=realtime\n";
+      return false; // Только у этого движка есть потоки персонала
+    }
+    if (pin.policy == PIN_LIST && shard_count > 1) {
+      std::cerr << "CPU list for --pin cannot be used with --shards, "
+                   "use compact or spread\n";
+      return false; // Клиники сети и так делят ядра между собой
+    }
+    cpu_set_t allowed; // Ядра, доступные процессу
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    for (size_t k = 0; k < pin.cpus.size(); k++) {
+      if (!CPU_ISSET(pin.cpus[k], &allowed)) {
+        std::cerr << "CPU " << pin.cpus[k] << " is not available\n";
+        return false; // Поток не сможет стартовать на этом ядре
+      }
+    }
+#endif
+  }
+
+  return true; // Возвращаем true если всё ОК
+}
+
+int main(int argc, char **argv) {
+  setlocale(LC_ALL, "ru"); // Устанавливаем локаль (русский язык)
+
+  if (!parse_args(argc, argv)) { // Парсим аргументы
+    std::cerr << "Error reading parameters\n"; // Если ошибка при чтении
+    return 1; // Выходим с кодом ошибки
+  }
+  if (!arrival_schedule(arrival, &N, &arrivalTimes)) { // Расписание прихода
+    std::cerr << "Error reading parameters\n"; // Ошибка в трассе прихода
+    return 1;                                  // Выходим с кодом ошибки
+  }
+  setup_staff(); // Составляем список специалистов
+  patientsExpected.store(N); // Все пациенты придут в эту клинику
+  referredBy.init(duty_count); // Счетчик направленных у каждого дежурного
+#ifdef CLINIC_HAVE_SHARDS
+  if (shard_count > 1) {   // Сеть клиник
+    int rc = run_shards(); // Здесь продолжают только процессы клиник
+    if (rc >= 0) {         // Процесс сети: все клиники закончили день
+      delete[] specialistIds; // Освобождаем список специалистов
+      return rc;
+    }
+  }
+#endif
+#ifdef CLINIC_HAVE_PIN
+  if (pin_enabled) {  // Клиника сети уже привязана к своим ядрам
+    setup_placement(); // Раздаем ядра персоналу
+  }
+#endif
+
+  log_file =
+      fopen(output_filename.c_str(), "w+"); // Открываем файл логов на запись
+  if (!log_file) { // Если не удалось открыть
+    std::cerr << "Failed to open output file\n"; // Сообщаем об ошибке
+    return 1; // Выходим с кодом ошибки
+  }
+  if (!open_log()) { // Запускаем логгер и трассу
+    return 1;         // Выходим с кодом ошибки
+  }
+
+  log_parameters(); // Логируем параметры задачи
+  if (arena_enabled) { // Ячейки под пациентов одним блоком
+    size_t slots = arena_slots > 0 ? arena_slots : N; // Ячеек в арене
+    void *mem = NULL; // Блок на узлах специалистов
+#ifdef CLINIC_HAVE_PIN
+    if (pin_enabled && slots > 0) { // Пациентов читают все узлы по очереди
+      mem = placement_alloc(ObjectArena<Patient>::block_bytes(slots),
+                            staffNode);
+    }
+#endif
+    if (mem) {
+      patientArena.init(slots, mem);
+    } else {
+      patientArena.init(slots);
+    }
+  }
+  dutyDesk.queue.set_aging(triage_aging_ms * 1000000ULL); // Старение (нс)
+  for (int i = 0; i < 3; i++) {
+    specialistDesk[i].queue.set_aging(triage_aging_ms * 1000000ULL);
+  }
+
+  if (engine == ENGINE_VIRTUAL) { // Симуляция на виртуальных часах
+    run_virtual_day();            // Проигрываем весь день без потоков
+    log_event("The hospital workday has ended\n"); // Логируем завершение
+    trace_event(TRACE_DAY_ENDED, 0, 0, NONE); // Пишем в трассу
+    if (arrival.kind != ARRIVAL_ALL) {
+      log_arrival_summary(virtual_now); // Логируем пропускную способность
+    }
+    if (referral_policy != REFERRAL_RANDOM || referral_choices != 1) {
+      log_referral_summary(); // Логируем распределение направлений
+    }
+    if (stats_enabled) {
+      log_stats_report(); // Логируем процентили задержек
+    }
+    close_log(); // Останавливаем логгер и закрываем файл логов
+    delete[] specialistIds; // Освобождаем список специалистов
+    return 0;    // Успешное завершение
+  }
+#ifdef CLINIC_HAVE_CORO
+  if (engine == ENGINE_CORO) { // Сопрограммы на пуле потоков
+    uint64_t day_start = get_elapsed_ns(); // Начало приема пациентов
+    run_coro_day(); // Выполняем весь день на сопрограммах
+    log_event("The hospital workday has ended\n"); // Логируем завершение
+    trace_event(TRACE_DAY_ENDED, 0, 0, NONE); // Пишем в трассу
+    if (arrival.kind != ARRIVAL_ALL) {
+      log_arrival_summary((get_elapsed_ns() - day_start) /
+                          1000000); // Логируем пропускную способность
+    }
+    if (referral_policy != REFERRAL_RANDOM || referral_choices != 1) {
+      log_referral_summary(); // Логируем распределение направлений
+    }
+    if (stats_enabled) {
+      log_stats_report(); // Логируем процентили задержек
+    }
+    close_log(); // Останавливаем логгер и закрываем файл логов
+    delete[] specialistIds; // Освобождаем список специалистов
+    return 0;    // Успешное завершение
+  }
+#endif
+
+  if (queue_backend == QUEUE_LOCKFREE) { // Lock-free очереди
+    size_t capacity = clinic_capacity(); // Вмещают всех пациентов
+    void *mem[4] = {NULL, NULL, NULL, NULL}; // Буферы на узлах потребителей
+#ifdef CLINIC_HAVE_PIN
+    if (pin_enabled) { // Буфер очереди - на узле тех, кто из нее берет
+      size_t bytes = ParkingMpmcQueue<Patient *>::buffer_bytes(capacity);
+      mem[0] = placement_alloc(bytes, std::vector<int>(1, staffNode[0]));
+      for (int i = 0; i < 3; i++) {
+        mem[i + 1] = placement_alloc(bytes, std::vector<int>(1, queueNode[i]));
+      }
+    }
+#endif
+    if (mem[0]) {
+      dutyDesk.lockfree.init(capacity, mem[0]);
+    } else {
+      dutyDesk.lockfree.init(capacity);
+    }
+    for (int i = 0; i < 3; i++) {
+      if (mem[i + 1]) {
+        specialistDesk[i].lockfree.init(capacity, mem[i + 1]);
+      } else {
+        specialistDesk[i].lockfree.init(capacity);
+      }
+    }
+  }
+
+  if (lock_kind == LOCK_HYBRID) { // Гибридные мьютексы очередей
+    QueueDesk<Patient *> *desks[4] = {&dutyDesk, &specialistDesk[0],
+                                      &specialistDesk[1], &specialistDesk[2]};
+    for (int i = 0; i < 4; i++) {
+      desks[i]->hybrid = true;
+      desks[i]->spinLock.set_spin_budget(spin_budget);
+      desks[i]->spinLock.set_timed(stats_enabled); // Время удержания
+    }
+  }
+
+  if (duty_queue == DUTY_STEAL) { // Своя очередь у каждого врача
+    dutyDeques = new DutyDeque[duty_count]; // Память под очереди врачей
+    for (int i = 0; i < duty_count; i++) {
+      pthread_mutex_init(&dutyDeques[i].lock, NULL); // Мьютекс очереди
+      dutyDeques[i].size.store(0);                   // Очередь пуста
+      dutyDeques[i].steals = 0;                      // Краж еще не было
+      dutyDeques[i].stolen = 0;
+    }
+  }
+  check_all_referred(); // Если пациентов нет, день закончен сразу
+
+  // Создаем потоки дежурных врачей
+  duty_docs = new pthread_t[duty_count]; // Память под потоки дежурных
+  for (int i = 0; i < duty_count; i++) {
+    create_staff_thread(&duty_docs[i], i, duty_doctor_thread,
+                        (void *)(intptr_t)(i + 1)); // Поток дежурного врача
+  }
+
+  // Создаем потоки специалистов (несколько специалистов одного типа делят
+  // одну очередь)
+  specialists = new pthread_t[specialist_total]; // Память под потоки
+  for (int i = 0; i < specialist_total; i++) {
+    create_staff_thread(&specialists[i], duty_count + i, specialist_thread,
+                        (void *)&specialistIds[i]); // Поток специалиста
+  }
+
+  uint64_t day_start = get_elapsed_ns(); // Начало приема пациентов
+  if (patient_model == MODEL_POOL) {
+    // Запускаем пул потоков, который отпускает пациентов домой
+    poolThreads = new pthread_t[pool_workers]; // Память под потоки пула
+    for (int i = 0; i < pool_workers; i++) {
+      pthread_create(&poolThreads[i], NULL, pool_worker_thread,
+                     NULL); // Создаем поток пула
+    }
+
+    // Пациенты - объекты-состояния, их продвигают врачи и пул
+    for (int i = 0; i < N; i++) {
+      wait_for_arrival(day_start, arrivalTimes[i]); // Ждем прихода пациента
+      admit_patient(create_patient(
+          i + 1, submit_discharge)); // Ставим пациента в очередь к дежурным
+    }
+
+    // Ждем, пока все пациенты уйдут домой
+    pthread_mutex_lock(&patientsDoneLock); // Захватываем мьютекс счетчика
+    while (patientsDone < N) {             // Пока ушли не все
+      pthread_cond_wait(&allPatientsDone, &patientsDoneLock); // Ждем
+    }
+    pthread_mutex_unlock(&patientsDoneLock); // Освобождаем мьютекс счетчика
+  } else {
+    // Создаем потоки пациентов
+    patients =
+        new pthread_t[N]; // Выделяем память под массив потоков пациентов
+#ifdef CLINIC_HAVE_SHARDS
+    if (shard_index >= 0) { // Клиника сети принимает и переданных пациентов
+      shard_open();
+    }
+#endif
+    int started = 0; // Пациентов, оставшихся в клинике
+    for (int i = 0; i < N; i++) {
+      wait_for_arrival(day_start, arrivalTimes[i]); // Ждем прихода пациента
+      int pid = patient_id(i); // Номер пациента
+#ifdef CLINIC_HAVE_SHARDS
+      if (shard_index >= 0 && shard_transfer(pid)) {
+        continue; // Пациент ушел в другую клинику
+      }
+#endif
+      pthread_create(&patients[started++], NULL, patient_thread,
+                     (void *)(intptr_t)pid); // Создаем поток пациента
+    }
+#ifdef CLINIC_HAVE_SHARDS
+    if (shard_index >= 0) {
+      shard_close(); // Ждем пациентов, переданных из других клиник
+    }
+#endif
+
+    // Ждем завершения всех потоков пациентов
+    for (int i = 0; i < started; i++) {
+      pthread_join(patients[i], NULL); // Ждем завершения потока пациента
+    }
+  }
+
+  log_event("All patients have been treated\n"); // Логируем, что все пациенты
+                                                 // вылечены
+  trace_event(TRACE_ALL_TREATED, 0, 0, NONE); // Пишем в трассу
+
+  // Все пациенты уже пришли и ушли, значит защелка открыта, и открывший ее
+  // врач уже разбудил всех дежурных и специалистов. Ждем, пока они закончат.
+  for (int i = 0; i < duty_count; i++) {
+    pthread_join(duty_docs[i], NULL); // Ждем завершения потоков дежурных врачей
+  }
+
+  // Ждем завершения всех специалистов
+  for (int i = 0; i < specialist_total; i++) {
+    pthread_join(specialists[i], NULL); // Ждем завершения потоков специалистов
+  }
+
+  if (patient_model == MODEL_POOL) {
+    pool_shutdown();      // Останавливаем пул потоков
+    delete[] poolThreads; // Освобождаем память под потоки пула
+  }
+
+  log_event(
+      "The hospital workday has ended\n"); // Логируем завершение рабочего дня
+  trace_event(TRACE_DAY_ENDED, 0, 0, NONE); // Пишем в трассу
+#ifdef CLINIC_HAVE_SHARDS
+  if (shard_index >= 0) { // Клиника сети
+    shard_finish();       // Отдаем итоги процессу сети
+  }
+#endif
+  if (duty_queue == DUTY_STEAL) { // Итоги работы очередей дежурных
+    log_steal_summary();          // Логируем счетчики краж
+    for (int i = 0; i < duty_count; i++) {
+      pthread_mutex_destroy(&dutyDeques[i].lock); // Уничтожаем мьютексы
+    }
+    delete[] dutyDeques; // Освобождаем очереди врачей
+  }
+  if (arrival.kind != ARRIVAL_ALL) {
+    log_arrival_summary((get_elapsed_ns() - day_start) /
+                        1000000); // Логируем пропускную способность
+  }
+  if (referral_policy != REFERRAL_RANDOM || referral_choices != 1) {
+    log_referral_summary(); // Логируем распределение направлений
+  }
+  if (stats_enabled) {
+    log_stats_report(); // Логируем процентили задержек
+  }
+  if (pin_enabled) {
+    log_placement_summary(); // Логируем переходы между узлами NUMA
+  }
+
+  // Удаляем мьютексы и условные переменные (мьютексы очередей уничтожают
+  // их блоки QueueDesk)
+  pthread_mutex_destroy(&consoleLogLock); // Уничтожаем мьютекс консоли
+  pthread_mutex_destroy(&fileLogLock); // Уничтожаем мьютекс файла
+  pthread_mutex_destroy(&poolLock);        // Уничтожаем мьютекс пула
+  pthread_cond_destroy(&poolNotEmpty);     // Уничтожаем условные переменные
+  pthread_cond_destroy(&poolNotFull);      // пула
+  pthread_mutex_destroy(&patientsDoneLock); // Уничтожаем мьютекс счетчика
+  pthread_cond_destroy(&allPatientsDone); // ушедших пациентов
+
+  close_log();       // Останавливаем логгер и закрываем файл логов
+  delete[] patients; // Освобождаем память под массив потоков пациентов
+#ifdef CLINIC_HAVE_PIN
+  for (size_t i = 0; i < numaBlocks.size(); i++) {
+    numa_free(numaBlocks[i].first, numaBlocks[i].second); // Блоки на узлах
+  }
+#endif
+  delete[] duty_docs;     // Освобождаем память под потоки дежурных
+  delete[] specialists;   // и специалистов
+  delete[] specialistIds; // Освобождаем список специалистов
 
   return 0; // Возвращаем 0 - успешное завершение программы
 }
@@ -6,7 +6,6 @@
 #include <iostream> //   - C++ (cin, cout)
 #include <pthread.h> //     POSIX (pthread_*)
 #include <queue>     //    (std::queue)
-#include <random> //     (std::mt19937)
 #include <stdarg.h> //    variadic  (va_list)
 #include <string> //   std::string
 
@@ -19,16 +18,49 @@
   usleep(1000L * (x)) //  sleep_ms  usleep ()
 #endif
 
+#include "ClinicArena.h" //  
+#include "ClinicAsyncLog.h" //    --log=async
+#include "ClinicHistogram.h" //    --stats
+#include "ClinicLatch.h" //      
+#include "ClinicMpmcQueue.h" // Lock-free   --queue=lockfree
+#include "ClinicSpinPark.h" //    --lock=hybrid
+#include "ClinicTrace.h" //     --trace
+#include "ClinicWorkload.h" //    (-service)
+
 //   
 enum SpecialistType { NONE = -1, DENTIST = 0, SURGEON = 1, THERAPIST = 2 };
 
+//  
+enum LogMode {
+  LOG_SYNC = 0,  //    log_event ( )
+  LOG_ASYNC = 1, //   - 
+  LOG_OFF = 2    //   
+};
+
+//        
+enum QueueBackend {
+  QUEUE_MUTEX = 0,   // std::queue   
+  QUEUE_LOCKFREE = 1 // Lock-free MPMC-    futex
+};
+
+//    
+enum LockKind {
+  LOCK_ADAPTIVE = 0, //     spinlock' 
+  LOCK_HYBRID = 1    //  ,   (ClinicSpinPark.h)
+};
+
+// :  (   )    
+struct SpecialistId {
+  int type;   //  
+  int number; //      ( )
+};
+
 //  
 struct Patient {
   int id; //  
   SpecialistType specialist_type; //  ,   
-  pthread_cond_t treated =
-      PTHREAD_COND_INITIALIZER; //     
-  pthread_mutex_t patientLock; //     
+  uint64_t stage_since = 0; //    (,  --stats)
+  OneShotEvent treated; //  " " (futex, 4 )
 };
 
 //  
@@ -38,11 +70,23 @@ int t_s = 2000; // 
 std::string output_filename = "clinic_log.txt"; //     
 bool from_file = false; //     
 std::string config_filename; //   
+QueueBackend queue_backend = QUEUE_MUTEX; //  
+LockKind lock_kind = LOCK_ADAPTIVE; //    
+int spin_budget = SPIN_PARK_DEFAULT_BUDGET; //    
+LogMode log_mode = LOG_SYNC; //  
+bool log_console = true;     //     
+std::string trace_filename; //    ( -  )
+ServiceDist serviceDist[SERVICE_STAGES]; //   
+bool stats_enabled = false; //      
+int duty_count = 2; //   
+int specialist_count[3] = {1, 1, 1}; //    
+int specialist_total = 3;            //    
+SpecialistId *specialistIds = NULL; //     
 
 // 
 pthread_t *patients; //   
-pthread_t duty_docs[2]; //     (2 )
-pthread_t specialists[3]; //    (3 )
+pthread_t *duty_docs; //     (duty_count )
+pthread_t *specialists; //    (specialist_total)
 
 //   
 std::queue<Patient *> commonQueue; //     
@@ -52,39 +96,123 @@ pthread_cond_t commonQueueNotEmpty =
                               // 
 
 //   : (0), (1), (2)
-std::queue<Patient *> specialistQueue[3]; //     
+std::queue<Patient *> specialistQueue[3]; //     
 pthread_mutex_t specialistLock[3]; //     
 pthread_cond_t
     specialistNotEmpty[3]; //     
 
-// Spinlocks    
+//     --queue=lockfree
+ParkingMpmcQueue<Patient *> commonQueueLF; // Lock-free   
+ParkingMpmcQueue<Patient *>
+    specialistQueueLF[3]; // Lock-free   
+
+//        --lock=hybrid
+SpinParkMutex commonQueueSpin;          //   
+SpinParkCond commonQueueSpinNotEmpty;   //  
+SpinParkMutex specialistSpin[3];        //   
+SpinParkCond specialistSpinNotEmpty[3]; //  
+SpinParkMutex consoleLogSpin;           //    
+SpinParkMutex fileLogSpin;              //    
+
+//  :      ,  
+// -,  new/delete   
+ObjectArena<Patient> patientArena;
+
+//     --stats ()
+LatencyHistogram dutyWaitHist;            //     
+LatencyHistogram dutyTimeHist;            //    
+LatencyHistogram specialistWaitHist;      //   ( )
+LatencyHistogram specialistWaitHistBy[3]; //    
+LatencyHistogram treatmentHist;           //  ( )
+LatencyHistogram treatmentHistBy[3];      //   
+
+// Spinlocks  
 pthread_spinlock_t consoleLogLock; // Spinlock    
 pthread_spinlock_t fileLogLock; // Spinlock    
-pthread_spinlock_t patientsToSpecialistLock; // Spinlock    
 
-//   
-int patientsToSpecialist = 0;
+//  :        ,
+//  ,   
+ShardedCounter referredBy;
+CompletionLatch dayLatch;
 
 //  
 FILE *log_file = NULL; //    
 auto program_start =
     std::chrono::high_resolution_clock::now(); //   
 
-//   
-std::mt19937
-    rng(42); //       
-std::uniform_int_distribution<int>
-    specialist_dist(0, 2); //    
+//     (Philox   (, ),  
+//   )
+unsigned referral_seed = 42;
 
 //     
 pthread_mutexattr_t adaptive_attr;
 
+//     : spinlock   (--lock)
+void log_lock(pthread_spinlock_t *lock, SpinParkMutex *spin) {
+  if (lock_kind == LOCK_HYBRID) {
+    spin->lock();
+  } else {
+    pthread_spin_lock(lock);
+  }
+}
+void log_unlock(pthread_spinlock_t *lock, SpinParkMutex *spin) {
+  if (lock_kind == LOCK_HYBRID) {
+    spin->unlock();
+  } else {
+    pthread_spin_unlock(lock);
+  }
+}
+
+//     ,     :
+//   pthread   (--lock)
+void queue_lock(pthread_mutex_t *lock, SpinParkMutex *spin) {
+  if (lock_kind == LOCK_HYBRID) {
+    spin->lock();
+  } else {
+    pthread_mutex_lock(lock);
+  }
+}
+void queue_unlock(pthread_mutex_t *lock, SpinParkMutex *spin) {
+  if (lock_kind == LOCK_HYBRID) {
+    spin->unlock();
+  } else {
+    pthread_mutex_unlock(lock);
+  }
+}
+void queue_wait(pthread_cond_t *cond, pthread_mutex_t *lock,
+                SpinParkCond *spinCond, SpinParkMutex *spin) {
+  if (lock_kind == LOCK_HYBRID) {
+    spinCond->wait(*spin);
+  } else {
+    pthread_cond_wait(cond, lock);
+  }
+}
+void queue_signal(pthread_cond_t *cond, SpinParkCond *spinCond) {
+  if (lock_kind == LOCK_HYBRID) {
+    spinCond->signal();
+  } else {
+    pthread_cond_signal(cond);
+  }
+}
+void queue_broadcast(pthread_cond_t *cond, SpinParkCond *spinCond) {
+  if (lock_kind == LOCK_HYBRID) {
+    spinCond->broadcast();
+  } else {
+    pthread_cond_broadcast(cond);
+  }
+}
+
 //        
-std::string get_time_since_start() {
+long long get_elapsed_ms() {
   auto now = std::chrono::high_resolution_clock::now(); //  
-  auto elapsed =
-      std::chrono::duration_cast<std::chrono::milliseconds>(now - program_start)
-          .count();                    //    
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             now - program_start)
+      .count(); //    
+}
+
+//         
+std::string get_time_since_start() {
+  long long elapsed = get_elapsed_ms(); //    
   int minutes = elapsed / 60000;       //   
   int seconds = (elapsed / 1000) % 60; //   
   int milliseconds = elapsed % 1000;   // 
@@ -96,177 +224,364 @@ std::string get_time_since_start() {
 
 //  
 void log_event(const char *fmt, ...) {
+  if (log_mode == LOG_OFF) {
+    return; //   
+  }
+
   va_list args;
   va_start(args, fmt);
 
+  //  :     ,   
+  if (log_mode == LOG_ASYNC) {
+    async_log_vsubmit(get_elapsed_ms(), fmt, args);
+    va_end(args);
+    return;
+  }
+
   va_list args2;
   va_copy(args2, args);
 
   std::string time_str = get_time_since_start();
 
   //      spinlock
-  pthread_spin_lock(&consoleLogLock);
-  printf("%s ", time_str.c_str());
-  vprintf(fmt, args);
-  pthread_spin_unlock(&consoleLogLock);
+  if (log_console) {
+    log_lock(&consoleLogLock, &consoleLogSpin);
+    printf("%s ", time_str.c_str());
+    vprintf(fmt, args);
+    log_unlock(&consoleLogLock, &consoleLogSpin);
+  }
 
   //      spinlock
   if (log_file) {
-    pthread_spin_lock(&fileLogLock);
+    log_lock(&fileLogLock, &fileLogSpin);
     fprintf(log_file, "%s ", time_str.c_str());
     vfprintf(log_file, fmt, args2);
-    pthread_spin_unlock(&fileLogLock);
+    log_unlock(&fileLogLock, &fileLogSpin);
     va_end(args2);
   }
   va_end(args);
 }
 
+//        ( )
+uint64_t get_elapsed_ns() {
+  auto now = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(now -
+                                                              program_start)
+      .count();
+}
+
+//     --stats:     
+//     stage ,  ,   
+//  by_type.   (stage == NULL)   .
+void stats_mark(Patient *p, LatencyHistogram *stage,
+                LatencyHistogram *by_type) {
+  if (!stats_enabled) {
+    return;
+  }
+  uint64_t now = get_elapsed_ns();
+  if (stage) {
+    uint64_t us = (now - p->stage_since) / 1000; //   ()
+    stage->record(us);
+    if (by_type) {
+      by_type->record(us);
+    }
+  }
+  p->stage_since = now;
+}
+
+//    p   stage (): t_d / t_s   
+//  -service
+double service_time(const Patient *p, int stage) {
+  return service_sample(serviceDist[stage], stage == SERVICE_DUTY ? t_d : t_s,
+                        p->id, stage);
+}
+
+//     ,   
+void trace_event(TraceKind kind, int actor, int patient, int specialist) {
+  if (traceEnabled) {
+    trace_emit(get_elapsed_ns(), kind, actor, patient, specialist);
+  }
+}
+
+// ,       ( )
+bool all_patients_sent() { return dayLatch.is_open(); }
+
+//       (NULL -    )
+Patient *pop_common() {
+  Patient *p = NULL;
+  if (queue_backend == QUEUE_LOCKFREE) {
+    commonQueueLF.pop(p, all_patients_sent); //     
+    return p;
+  }
+
+  queue_lock(&commonQueueLock, &commonQueueSpin);
+  while (commonQueue.empty()) {
+    // ,     
+    if (all_patients_sent()) {
+      queue_unlock(&commonQueueLock, &commonQueueSpin);
+      return NULL; //    
+    }
+
+    queue_wait(&commonQueueNotEmpty, &commonQueueLock,
+               &commonQueueSpinNotEmpty, &commonQueueSpin);
+  }
+
+  //    
+  p = commonQueue.front();
+  commonQueue.pop();
+  queue_unlock(&commonQueueLock, &commonQueueSpin);
+  return p;
+}
+
+//       p->specialist_type
+void push_specialist(Patient *p) {
+  int type = p->specialist_type;
+  if (queue_backend == QUEUE_LOCKFREE) {
+    specialistQueueLF[type].push(p); //    
+    return;
+  }
+  queue_lock(&specialistLock[type], &specialistSpin[type]);
+  specialistQueue[type].push(p);
+  queue_signal(&specialistNotEmpty[type], &specialistSpinNotEmpty[type]);
+  queue_unlock(&specialistLock[type], &specialistSpin[type]);
+}
+
+//      (NULL -   )
+Patient *pop_specialist(int sid) {
+  Patient *p = NULL;
+  if (queue_backend == QUEUE_LOCKFREE) {
+    specialistQueueLF[sid].pop(p, all_patients_sent); //  
+    return p;
+  }
+
+  queue_lock(&specialistLock[sid], &specialistSpin[sid]);
+  while (specialistQueue[sid].empty()) {
+    // ,    
+    if (all_patients_sent()) {
+      queue_unlock(&specialistLock[sid], &specialistSpin[sid]);
+      return NULL; //    
+    }
+
+    queue_wait(&specialistNotEmpty[sid], &specialistLock[sid],
+               &specialistSpinNotEmpty[sid], &specialistSpin[sid]);
+  }
+
+  //    
+  p = specialistQueue[sid].front();
+  specialistQueue[sid].pop();
+  queue_unlock(&specialistLock[sid], &specialistSpin[sid]);
+  return p;
+}
+
+//   :     
+void wake_all_actors() {
+  if (queue_backend == QUEUE_LOCKFREE) {
+    commonQueueLF.wake_all();
+    for (int i = 0; i < 3; i++) {
+      specialistQueueLF[i].wake_all();
+    }
+    return;
+  }
+  queue_lock(&commonQueueLock, &commonQueueSpin);
+  queue_broadcast(&commonQueueNotEmpty, &commonQueueSpinNotEmpty);
+  queue_unlock(&commonQueueLock, &commonQueueSpin);
+
+  for (int i = 0; i < 3; i++) {
+    queue_lock(&specialistLock[i], &specialistSpin[i]);
+    queue_broadcast(&specialistNotEmpty[i], &specialistSpinNotEmpty[i]);
+    queue_unlock(&specialistLock[i], &specialistSpin[i]);
+  }
+}
+
+//    ,  ;    
+//  (   )
+void check_all_referred() {
+  if (!dayLatch.is_open() && referredBy.sum() == N && dayLatch.open()) {
+    wake_all_actors();
+  }
+}
+
 //  
 void *patient_thread(void *arg) {
-  int pid = *(int *)arg; //  id   
-  delete (int *)arg; //    id
+  int pid = (int)(intptr_t)arg; // id    
 
-  Patient *p = new Patient(); //    
+  Patient *p = patientArena.acquire(); //     
   p->id = pid;
   p->specialist_type = NONE;
 
-  //    
-  pthread_mutex_init(&p->patientLock, &adaptive_attr);
-
   //      
-  pthread_mutex_lock(&commonQueueLock);
-  commonQueue.push(p);
-  log_event("Patient P%d entered the queue to duty doctors\n", p->id);
-  pthread_cond_signal(&commonQueueNotEmpty);
-  pthread_mutex_unlock(&commonQueueLock);
+  stats_mark(p, NULL, NULL); //    
+  if (queue_backend == QUEUE_LOCKFREE) {
+    commonQueueLF.push(p);
+    log_event("Patient P%d entered the queue to duty doctors\n", p->id);
+    trace_event(TRACE_PATIENT_ENTERED, 0, p->id, NONE);
+  } else {
+    queue_lock(&commonQueueLock, &commonQueueSpin);
+    commonQueue.push(p);
+    log_event("Patient P%d entered the queue to duty doctors\n", p->id);
+    trace_event(TRACE_PATIENT_ENTERED, 0, p->id, NONE);
+    queue_signal(&commonQueueNotEmpty, &commonQueueSpinNotEmpty);
+    queue_unlock(&commonQueueLock, &commonQueueSpin);
+  }
 
-  // ,    
-  pthread_mutex_lock(&p->patientLock);
-  pthread_cond_wait(&p->treated, &p->patientLock);
-  pthread_mutex_unlock(&p->patientLock);
+  // ,     (   )
+  p->treated.wait();
 
   log_event("Patient P%d fully treated and went home\n", p->id);
-  delete p; //    
+  trace_event(TRACE_PATIENT_HOME, 0, p->id, NONE);
+  patientArena.release(p); //     
   return NULL;
 }
 
 //   
 void *duty_doctor_thread(void *arg) {
-  int did = *(int *)arg; //  id  
-  delete (int *)arg;     //    id
+  int did = (int)(intptr_t)arg; // id     
 
   while (true) {
-    pthread_mutex_lock(&commonQueueLock);
-
-    while (commonQueue.empty()) {
-      // ,     
-      pthread_spin_lock(&patientsToSpecialistLock);
-      bool all_sent = (patientsToSpecialist == N);
-      pthread_spin_unlock(&patientsToSpecialistLock);
-
-      if (all_sent) {
-        pthread_mutex_unlock(&commonQueueLock);
-        goto end_duty; //   
-      }
-
-      pthread_cond_wait(&commonQueueNotEmpty, &commonQueueLock);
-    }
-
     //    
-    Patient *p = commonQueue.front();
-    commonQueue.pop();
-    pthread_mutex_unlock(&commonQueueLock);
+    Patient *p = pop_common();
+    if (p == NULL) {
+      break; //   
+    }
+    stats_mark(p, &dutyWaitHist, NULL); //    
 
     //  
     log_event("Duty Doctor D%d accepted patient P%d\n", did, p->id);
-    sleep_ms(t_d); //   
+    trace_event(TRACE_DUTY_ACCEPTED, did, p->id, NONE);
+    sleep_ms(service_time(p, SERVICE_DUTY)); //   
 
     //  
-    p->specialist_type = static_cast<SpecialistType>(specialist_dist(rng));
+    p->specialist_type =
+        static_cast<SpecialistType>(workload_referral(referral_seed, p->id, 3));
     const char *specName = (p->specialist_type == DENTIST)   ? "Dentist"
                            : (p->specialist_type == SURGEON) ? "Surgeon"
                                                              : "Therapist";
     log_event("Duty Doctor D%d referred patient P%d to %s\n", did, p->id,
               specName);
+    trace_event(TRACE_DUTY_REFERRED, did, p->id, p->specialist_type);
 
     //      
-    pthread_mutex_lock(&specialistLock[p->specialist_type]);
-    specialistQueue[p->specialist_type].push(p);
-    pthread_cond_signal(&specialistNotEmpty[p->specialist_type]);
-    pthread_mutex_unlock(&specialistLock[p->specialist_type]);
+    stats_mark(p, &dutyTimeHist, NULL); //     
+    push_specialist(p);
 
-    //    
-    pthread_spin_lock(&patientsToSpecialistLock);
-    patientsToSpecialist++;
-    bool now_all_sent = (patientsToSpecialist == N);
-    pthread_spin_unlock(&patientsToSpecialistLock);
+    //     
+    referredBy.add(did - 1, 1);
 
     //    ,     
-    if (now_all_sent) {
-      pthread_mutex_lock(&commonQueueLock);
-      pthread_cond_broadcast(&commonQueueNotEmpty);
-      pthread_mutex_unlock(&commonQueueLock);
-
-      for (int i = 0; i < 3; i++) {
-        pthread_mutex_lock(&specialistLock[i]);
-        pthread_cond_broadcast(&specialistNotEmpty[i]);
-        pthread_mutex_unlock(&specialistLock[i]);
-      }
-    }
+    check_all_referred();
   }
 
-end_duty:
   log_event("Duty Doctor D%d ended his workday\n", did);
+  trace_event(TRACE_DUTY_ENDED, did, 0, NONE);
   return NULL;
 }
 
+//    : "Dentist",   , 
+// "Dentist#2"
+std::string specialist_name(const SpecialistId &s) {
+  std::string name = (s.type == DENTIST)   ? "Dentist"
+                     : (s.type == SURGEON) ? "Surgeon"
+                                           : "Therapist";
+  if (specialist_count[s.type] > 1) {
+    name += "#" + std::to_string(s.number);
+  }
+  return name;
+}
+
 //  
 void *specialist_thread(void *arg) {
-  int sid = *(int *)arg; //  id 
-  delete (int *)arg;     //    id
+  SpecialistId *me = (SpecialistId *)arg; //    
+  int sid = me->type;                     //  
 
-  const char *specName = (sid == DENTIST)   ? "Dentist"
-                         : (sid == SURGEON) ? "Surgeon"
-                                            : "Therapist";
+  std::string name = specialist_name(*me);
+  const char *specName = name.c_str();
 
   while (true) {
-    pthread_mutex_lock(&specialistLock[sid]);
-
-    while (specialistQueue[sid].empty()) {
-      // ,    
-      pthread_spin_lock(&patientsToSpecialistLock);
-      bool all_sent = (patientsToSpecialist == N);
-      pthread_spin_unlock(&patientsToSpecialistLock);
-
-      if (all_sent && specialistQueue[sid].empty()) {
-        pthread_mutex_unlock(&specialistLock[sid]);
-        goto end_specialist; //   
-      }
-
-      pthread_cond_wait(&specialistNotEmpty[sid], &specialistLock[sid]);
-    }
-
     //    
-    Patient *p = specialistQueue[sid].front();
-    specialistQueue[sid].pop();
-    pthread_mutex_unlock(&specialistLock[sid]);
+    Patient *p = pop_specialist(sid);
+    if (p == NULL) {
+      break; //   
+    }
+    stats_mark(p, &specialistWaitHist, &specialistWaitHistBy[sid]);
 
     //  
     log_event("%s started treating patient P%d\n", specName, p->id);
-    sleep_ms(t_s); //   
+    trace_event(TRACE_TREATMENT_STARTED, me->number, p->id, sid);
+    sleep_ms(service_time(p, sid)); //   
+    stats_mark(p, &treatmentHist, &treatmentHistBy[sid]);
     log_event("%s finished treating patient P%d\n", specName, p->id);
+    trace_event(TRACE_TREATMENT_FINISHED, me->number, p->id, sid);
 
     //  
-    pthread_mutex_lock(&p->patientLock);
-    pthread_cond_signal(&p->treated);
-    pthread_mutex_unlock(&p->patientLock);
+    p->treated.complete();
   }
 
-end_specialist:
   log_event("%s ended his workday\n", specName);
+  trace_event(TRACE_SPECIALIST_ENDED, me->number, 0, sid);
   return NULL;
 }
 
+//  specialistIds     
+void setup_staff() {
+  specialist_total = specialist_count[DENTIST] + specialist_count[SURGEON] +
+                     specialist_count[THERAPIST];
+  specialistIds = new SpecialistId[specialist_total];
+  int w = 0;
+  for (int type = 0; type < 3; type++) {
+    for (int k = 0; k < specialist_count[type]; k++) {
+      specialistIds[w++] = {type, k + 1};
+    }
+  }
+}
+
+//  --stats:     ()
+void log_stats_report() {
+  const char *types[3] = {"dentist", "surgeon", "therapist"};
+  char text[128];
+  log_event("Latency report (ms):\n");
+  dutyWaitHist.format(text, sizeof(text));
+  log_event("  duty queue wait: %s\n", text);
+  dutyTimeHist.format(text, sizeof(text));
+  log_event("  duty doctor time: %s\n", text);
+  specialistWaitHist.format(text, sizeof(text));
+  log_event("  specialist wait: %s\n", text);
+  for (int i = 0; i < 3; i++) {
+    specialistWaitHistBy[i].format(text, sizeof(text));
+    log_event("    %s: %s\n", types[i], text);
+  }
+  treatmentHist.format(text, sizeof(text));
+  log_event("  treatment: %s\n", text);
+  for (int i = 0; i < 3; i++) {
+    treatmentHistBy[i].format(text, sizeof(text));
+    log_event("    %s: %s\n", types[i], text);
+  }
+  log_event("  patient allocations: arena=%llu heap=%llu slots=%zu peak=%d\n",
+            (unsigned long long)patientArena.arena_allocs(),
+            (unsigned long long)patientArena.heap_allocs(),
+            patientArena.capacity(), patientArena.peak_in_use());
+  if (lock_kind == LOCK_HYBRID) { //    
+    char lock_text[256];
+    log_event("Hybrid lock report:\n");
+    if (queue_backend == QUEUE_MUTEX) {
+      spin_park_format(commonQueueSpin.stats(), lock_text, sizeof(lock_text));
+      log_event("  duty queue: %s\n", lock_text);
+      for (int i = 0; i < 3; i++) {
+        spin_park_format(specialistSpin[i].stats(), lock_text,
+                         sizeof(lock_text));
+        log_event("  %s queue: %s\n", types[i], lock_text);
+      }
+    }
+    if (log_mode == LOG_SYNC) { //     log_event
+      if (log_console) {
+        spin_park_format(consoleLogSpin.stats(), lock_text, sizeof(lock_text));
+        log_event("  console log: %s\n", lock_text);
+      }
+      spin_park_format(fileLogSpin.stats(), lock_text, sizeof(lock_text));
+      log_event("  file log: %s\n", lock_text);
+    }
+  }
+}
+
 //   
 void print_help() {
   std::cout << "Usage: program [options]\n"
@@ -276,6 +591,38 @@ void print_help() {
             << "  -t_d <ms>      Time for duty doctor to process a patient\n"
             << "  -t_s <ms>      Time for specialist to treat a patient\n"
             << "  -o <file>      Output log file\n"
+            << "  -d <count>     Number of duty doctors (default 2)\n"
+            << "  -s <list>      Specialists per specialty (default 1 each),\n"
+            << "                 e.g. dentist=4,surgeon=2,therapist=8\n"
+            << "  -seed <number> Seed of specialist referrals (default 42)\n"
+            << "  -service <stage>=<dist>\n"
+            << "                 Service time distribution of a stage (duty,\n"
+            << "                 dentist, surgeon, therapist or specialist):\n"
+            << "                 const (default), exp[:mean=<ms>],\n"
+            << "                 lognormal[:mean=<ms>,sigma=<s>] or\n"
+            << "                 empirical:<file>; all take ,seed=<n>\n"
+            << "  --queue=<mutex|lockfree>\n"
+            << "                 Queue backend: std::queue under an adaptive\n"
+            << "                 mutex (default) or a lock-free MPMC ring\n"
+            << "  --lock=<adaptive|hybrid>\n"
+            << "                 Queue and log locks: adaptive mutexes and\n"
+            << "                 spinlocks (default) or spin with backoff,\n"
+            << "                 then futex park\n"
+            << "  --spin-budget=<n>\n"
+            << "                 Pause instructions a hybrid lock spins\n"
+            << "                 before parking (default 1000, 0 parks at\n"
+            << "                 once)\n"
+            << "  --log=<sync|async|off>\n"
+            << "                 Write log lines from the calling thread\n"
+            << "                 (default), batch them on a writer thread or\n"
+            << "                 skip the text log entirely\n"
+            << "  --console=<on|off>\n"
+            << "                 Duplicate the log to the console (default\n"
+            << "                 on)\n"
+            << "  --trace=<file> Write a binary event trace (clinic-trace)\n"
+            << "  --stats=<on|off>\n"
+            << "                 Report p50/p90/p99/max latency of every\n"
+            << "                 stage at the end of the day (default off)\n"
             << "  --help [-h]    Display this help message\n";
 }
 
@@ -285,9 +632,125 @@ void log_parameters() {
   log_event("Number of patients: %d\n", N);
   log_event("Duty doctor's processing time (ms): %d\n", t_d);
   log_event("Specialist's treatment time (ms): %d\n", t_s);
+  if (duty_count != 2 || specialist_count[DENTIST] != 1 ||
+      specialist_count[SURGEON] != 1 || specialist_count[THERAPIST] != 1) {
+    log_event("Duty doctors: %d\n", duty_count);
+    log_event("Specialists: dentist=%d, surgeon=%d, therapist=%d\n",
+              specialist_count[DENTIST], specialist_count[SURGEON],
+              specialist_count[THERAPIST]);
+  }
+  if (referral_seed != 42) {
+    log_event("Referral seed: %u\n", referral_seed);
+  }
+  std::string service = service_describe(serviceDist);
+  if (!service.empty()) {
+    log_event("Service times: %s\n", service.c_str());
+  }
+  if (lock_kind == LOCK_HYBRID) {
+    log_event("Hybrid locks: spin budget %d pauses\n", spin_budget);
+  }
   log_event("Log file: %s\n\n", output_filename.c_str());
 }
 
+//    
+bool parse_queue_backend(const char *name) {
+  if (strcmp(name, "mutex") == 0) {
+    queue_backend = QUEUE_MUTEX;
+  } else if (strcmp(name, "lockfree") == 0) {
+    queue_backend = QUEUE_LOCKFREE;
+  } else {
+    std::cerr << "Unknown queue backend: " << name << "\n";
+    return false;
+  }
+  return true;
+}
+
+//   
+bool parse_lock_kind(const char *name) {
+  if (strcmp(name, "adaptive") == 0) {
+    lock_kind = LOCK_ADAPTIVE;
+  } else if (strcmp(name, "hybrid") == 0) {
+    lock_kind = LOCK_HYBRID;
+  } else {
+    std::cerr << "Unknown lock kind: " << name << "\n";
+    return false;
+  }
+  return true;
+}
+
+//   
+bool parse_log_mode(const char *name) {
+  if (strcmp(name, "sync") == 0) {
+    log_mode = LOG_SYNC;
+  } else if (strcmp(name, "async") == 0) {
+    log_mode = LOG_ASYNC;
+  } else if (strcmp(name, "off") == 0) {
+    log_mode = LOG_OFF;
+  } else {
+    std::cerr << "Unknown log mode: " << name << "\n";
+    return false;
+  }
+  return true;
+}
+
+//     "dentist=4,surgeon=2,therapist=8"
+bool parse_specialists(const char *list) {
+  std::string text = list;
+  size_t pos = 0;
+  while (pos <= text.size()) {
+    size_t end = text.find(',', pos);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    std::string item = text.substr(pos, end - pos); //  "="
+    size_t eq = item.find('=');
+    if (eq == std::string::npos) {
+      std::cerr << "Bad specialist entry: " << item << "\n";
+      return false;
+    }
+    std::string name = item.substr(0, eq);
+    int count = atoi(item.substr(eq + 1).c_str());
+    if (name == "dentist") {
+      specialist_count[DENTIST] = count;
+    } else if (name == "surgeon") {
+      specialist_count[SURGEON] = count;
+    } else if (name == "therapist") {
+      specialist_count[THERAPIST] = count;
+    } else {
+      std::cerr << "Unknown specialist: " << name << "\n";
+      return false;
+    }
+    pos = end + 1;
+  }
+  return true;
+}
+
+//      
+bool parse_console(const char *value) {
+  if (strcmp(value, "on") == 0) {
+    log_console = true;
+  } else if (strcmp(value, "off") == 0) {
+    log_console = false;
+  } else {
+    std::cerr << "Unknown console option: " << value << "\n";
+    return false;
+  }
+  return true;
+}
+
+//     
+bool parse_stats(const char *value) {
+  if (strcmp(value, "on") == 0) {
+    stats_enabled = true;
+  } else if (strcmp(value, "off") == 0) {
+    stats_enabled = false;
+  } else {
+    std::cerr << "Unknown stats option: " << value << "\n";
+    return false;
+  }
+  return true;
+}
+
 //      
 bool parse_args(int argc, char **argv) {
   for (int i = 1; i < argc; i++) { //      
@@ -305,6 +768,42 @@ bool parse_args(int argc, char **argv) {
       t_s = atoi(argv[++i]);
     } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
       output_filename = argv[++i];
+    } else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      duty_count = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      if (!parse_specialists(argv[++i])) {
+        return false;
+      }
+    } else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+      referral_seed = (unsigned)atol(argv[++i]);
+    } else if (strcmp(argv[i], "-service") == 0 && i + 1 < argc) {
+      if (!service_parse_assignment(argv[++i], serviceDist)) {
+        return false;
+      }
+    } else if (strncmp(argv[i], "--queue=", 8) == 0) {
+      if (!parse_queue_backend(argv[i] + 8)) {
+        return false;
+      }
+    } else if (strncmp(argv[i], "--lock=", 7) == 0) {
+      if (!parse_lock_kind(argv[i] + 7)) {
+        return false;
+      }
+    } else if (strncmp(argv[i], "--spin-budget=", 14) == 0) {
+      spin_budget = atoi(argv[i] + 14);
+    } else if (strncmp(argv[i], "--log=", 6) == 0) {
+      if (!parse_log_mode(argv[i] + 6)) {
+        return false;
+      }
+    } else if (strncmp(argv[i], "--console=", 10) == 0) {
+      if (!parse_console(argv[i] + 10)) {
+        return false;
+      }
+    } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+      trace_filename = argv[i] + 8;
+    } else if (strncmp(argv[i], "--stats=", 8) == 0) {
+      if (!parse_stats(argv[i] + 8)) {
+        return false;
+      }
     }
   }
 
@@ -324,10 +823,61 @@ bool parse_args(int argc, char **argv) {
         t_s = atoi(line.substr(4).c_str()); //  t_s
       } else if (line.find("o=") == 0) {
         output_filename = line.substr(2); //    
+      } else if (line.find("d=") == 0) {
+        duty_count = atoi(line.substr(2).c_str());
+      } else if (line.find("s=") == 0) {
+        if (!parse_specialists(line.substr(2).c_str())) {
+          return false;
+        }
+      } else if (line.find("seed=") == 0) {
+        referral_seed = (unsigned)atol(line.substr(5).c_str());
+      } else if (line.find("service=") == 0) {
+        if (!service_parse_assignment(line.substr(8).c_str(), serviceDist)) {
+          return false;
+        }
+      } else if (line.find("queue=") == 0) {
+        if (!parse_queue_backend(line.substr(6).c_str())) { //  
+          return false;
+        }
+      } else if (line.find("lock=") == 0) {
+        if (!parse_lock_kind(line.substr(5).c_str())) {
+          return false;
+        }
+      } else if (line.find("spin_budget=") == 0) {
+        spin_budget = atoi(line.substr(12).c_str());
+      } else if (line.find("log=") == 0) {
+        if (!parse_log_mode(line.substr(4).c_str())) {
+          return false;
+        }
+      } else if (line.find("console=") == 0) {
+        if (!parse_console(line.substr(8).c_str())) {
+          return false;
+        }
+      } else if (line.find("trace=") == 0) {
+        trace_filename = line.substr(6);
+      } else if (line.find("stats=") == 0) {
+        if (!parse_stats(line.substr(6).c_str())) {
+          return false;
+        }
       }
     }
   }
 
+  if (duty_count < 1) {
+    std::cerr << "Clinic must have at least one duty doctor\n";
+    return false;
+  }
+  for (int i = 0; i < 3; i++) {
+    if (specialist_count[i] < 1) {
+      std::cerr << "Clinic must have at least one specialist of each type\n";
+      return false;
+    }
+  }
+  if (spin_budget < 0) {
+    std::cerr << "Spin budget cannot be negative\n";
+    return false;
+  }
+
   return true; //  true   
 }
 
@@ -353,14 +903,23 @@ int main(int argc, char **argv) {
   //  spinlock'
   pthread_spin_init(&consoleLogLock, 0); //  spinlock 
   pthread_spin_init(&fileLogLock, 0); //  spinlock 
-  pthread_spin_init(&patientsToSpecialistLock,
-                    0); //  spinlock 
 
   //       
   if (!parse_args(argc, argv)) {
     std::cerr << "Error reading parameters\n"; // 
     return 1;
   }
+  setup_staff(); //   
+
+  //      ;   
+  //    --stats
+  SpinParkMutex *spins[6] = {&commonQueueSpin,   &specialistSpin[0],
+                             &specialistSpin[1], &specialistSpin[2],
+                             &consoleLogSpin,    &fileLogSpin};
+  for (int i = 0; i < 6; i++) {
+    spins[i]->set_spin_budget(spin_budget);
+    spins[i]->set_timed(stats_enabled);
+  }
 
   //     
   log_file = fopen(output_filename.c_str(), "w+");
@@ -369,28 +928,54 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  //  -  
+  if (log_mode == LOG_ASYNC) {
+    async_log_start(fileno(log_file), log_console);
+  }
+
+  //   :   6     
+  //    
+  if (!trace_filename.empty() &&
+      !trace_open(trace_filename.c_str(),
+                  6ULL * N + duty_count + specialist_total + 16,
+                  TRACE_PROGRAM_OTHER, N, t_d, t_s, output_filename.c_str(),
+                  duty_count, specialist_count)) {
+    std::cerr << "Failed to open trace file\n";
+    return 1;
+  }
+
   log_parameters(); //   
 
+  // Lock-free    
+  if (queue_backend == QUEUE_LOCKFREE) {
+    commonQueueLF.init(N);
+    for (int i = 0; i < 3; i++) {
+      specialistQueueLF[i].init(N);
+    }
+  }
+  patientArena.init(N); //     
+  referredBy.init(duty_count); //     
+  check_all_referred(); //   ,   
+
   //    
-  for (int i = 0; i < 2; i++) {
-    int *id = new int(i + 1); //    id 
+  duty_docs = new pthread_t[duty_count];
+  for (int i = 0; i < duty_count; i++) {
     pthread_create(&duty_docs[i], NULL, duty_doctor_thread,
-                   (void *)id); //    
+                   (void *)(intptr_t)(i + 1)); // id   
   }
 
-  //   
-  for (int i = 0; i < 3; i++) {
-    int *id = new int(i); //    id 
+  //    (    )
+  specialists = new pthread_t[specialist_total];
+  for (int i = 0; i < specialist_total; i++) {
     pthread_create(&specialists[i], NULL, specialist_thread,
-                   (void *)id); //   
+                   (void *)&specialistIds[i]); //   
   }
 
   //   
   patients = new pthread_t[N]; //      
   for (int i = 0; i < N; i++) {
-    int *pid = new int(i + 1); //    id 
     pthread_create(&patients[i], NULL, patient_thread,
-                   (void *)pid); //   
+                   (void *)(intptr_t)(i + 1)); // id   
   }
 
   //     
@@ -400,34 +985,25 @@ int main(int argc, char **argv) {
 
   log_event("All patients have been treated\n"); //   
                                                  //  
+  trace_event(TRACE_ALL_TREATED, 0, 0, NONE);
 
-  //   ,     
-  for (int i = 0; i < 2; i++) {
-    pthread_mutex_lock(&commonQueueLock);
-    pthread_cond_broadcast(&commonQueueNotEmpty); //    
-    pthread_mutex_unlock(&commonQueueLock);
-  }
-
-  //      
-  for (int i = 0; i < 2; i++) {
+  //   ,     ,  , 
+  //    .     
+  for (int i = 0; i < duty_count; i++) {
     pthread_join(duty_docs[i], NULL);
   }
 
-  //  ,     ,   
-  // 
-  for (int i = 0; i < 3; i++) {
-    pthread_mutex_lock(&specialistLock[i]);
-    pthread_cond_broadcast(&specialistNotEmpty[i]); //  
-    pthread_mutex_unlock(&specialistLock[i]);
-  }
-
   //     
-  for (int i = 0; i < 3; i++) {
+  for (int i = 0; i < specialist_total; i++) {
     pthread_join(specialists[i], NULL);
   }
 
   log_event(
       "The hospital workday has ended\n"); //    
+  trace_event(TRACE_DAY_ENDED, 0, 0, NONE);
+  if (stats_enabled) {
+    log_stats_report(); //   
+  }
 
   //     
   for (int i = 0; i < 3; i++) {
@@ -442,14 +1018,21 @@ int main(int argc, char **argv) {
 
   pthread_spin_destroy(&consoleLogLock); //   
   pthread_spin_destroy(&fileLogLock); //   
-  pthread_spin_destroy(
-      &patientsToSpecialistLock); //   
 
   //   
   pthread_mutexattr_destroy(&adaptive_attr);
 
+  //     ,  
+  if (log_mode == LOG_ASYNC) {
+    async_log_stop();
+  }
+  trace_close();
+
   fclose(log_file);  //   
   delete[] patients; //      
+  delete[] duty_docs;     //     
+  delete[] specialists;   //  
+  delete[] specialistIds; //   
 
   return 0; //   
 }
@@ -0,0 +1,213 @@
+#ifndef CLINIC_PLACEMENT_H
+#define CLINIC_PLACEMENT_H
+
+// Размещение потоков и памяти (--pin). Каждый дежурный врач и специалист
+// привязывается к своему ядру по политике:
+//   compact - ядра по порядку, узел NUMA за узлом: врачи и специалисты
+//             делят кэши одного сокета, пока на нем хватает ядер
+//   spread  - узлы NUMA по кругу: соседние по номеру потоки на разных узлах
+//   список  - явный список ядер "0,2,4-7", потоки берут их по кругу
+// Топология читается из /sys/devices/system/node, доступные ядра - из
+// sched_getaffinity (учитывает taskset и cgroup). Память под очереди
+// выделяется mmap и привязывается к узлу mbind до первой записи, так что
+// страницы оказываются на узле потребителя. Без libnuma: mbind вызывается
+// через syscall, как futex в ClinicMpmcQueue.h.
+
+#if defined(__linux__)
+#define CLINIC_HAVE_PIN 1
+
+#include <cstdio>            // Подключаем fopen для файлов /sys
+#include <cstdlib>           // Подключаем strtol
+#include <linux/mempolicy.h> // Подключаем MPOL_PREFERRED, MPOL_INTERLEAVE
+#include <pthread.h>         // Подключаем pthread_attr_setaffinity_np
+#include <sched.h>           // Подключаем cpu_set_t, sched_getaffinity
+#include <string>            // Подключаем std::string
+#include <sys/mman.h>        // Подключаем mmap
+#include <sys/syscall.h>     // Подключаем SYS_mbind
+#include <unistd.h>          // Подключаем syscall
+#include <vector>            // Подключаем std::vector
+
+enum PinPolicy {
+  PIN_OFF = 0,     // Потоки размещает планировщик (по умолчанию)
+  PIN_COMPACT = 1, // Ядра по порядку, узел за узлом
+  PIN_SPREAD = 2,  // Узлы NUMA по кругу
+  PIN_LIST = 3     // Явный список ядер
+};
+
+struct PinSpec {
+  PinPolicy policy = PIN_OFF; // Политика размещения
+  std::vector<int> cpus;      // Ядра для PIN_LIST
+  std::string text;           // Текст политики для лога
+};
+
+// Доступные ядра и узлы NUMA
+struct CpuTopology {
+  std::vector<int> cpus;   // Доступные процессу ядра по возрастанию
+  std::vector<int> nodeOf; // Узел каждого ядра (по номеру ядра)
+  int nodes = 1;           // Число узлов NUMA
+};
+
+// Список ядер "0,2,4-7" (формат cpulist ядра Linux); false - ошибка
+inline bool pin_parse_list(const char *text, std::vector<int> *cpus) {
+  cpus->clear();
+  const char *s = text;
+  while (*s != '\0' && *s != '\n') {
+    char *end;
+    long first = strtol(s, &end, 10);
+    if (end == s || first < 0 || first >= CPU_SETSIZE) {
+      return false;
+    }
+    long last = first;
+    s = end;
+    if (*s == '-') { // Диапазон ядер
+      last = strtol(s + 1, &end, 10);
+      if (end == s + 1 || last < first || last >= CPU_SETSIZE) {
+        return false;
+      }
+      s = end;
+    }
+    for (long c = first; c <= last; c++) {
+      cpus->push_back((int)c);
+    }
+    if (*s == ',') {
+      s++;
+    } else if (*s != '\0' && *s != '\n') {
+      return false;
+    }
+  }
+  return !cpus->empty();
+}
+
+// Разбор --pin: compact, spread или список ядер
+inline bool pin_parse(const char *text, PinSpec *spec) {
+  spec->text = text;
+  spec->cpus.clear();
+  if (spec->text == "off") {
+    spec->policy = PIN_OFF;
+  } else if (spec->text == "compact") {
+    spec->policy = PIN_COMPACT;
+  } else if (spec->text == "spread") {
+    spec->policy = PIN_SPREAD;
+  } else if (pin_parse_list(text, &spec->cpus)) {
+    spec->policy = PIN_LIST;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Ядра процесса и их узлы NUMA. Без /sys/devices/system/node все ядра
+// считаются одним узлом.
+inline CpuTopology topology_read() {
+  CpuTopology topo;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+    CPU_SET(0, &set); // Не удалось узнать - считаем, что есть ядро 0
+  }
+  int max_cpu = 0; // Наибольший номер доступного ядра
+  for (int c = 0; c < CPU_SETSIZE; c++) {
+    if (CPU_ISSET(c, &set)) {
+      topo.cpus.push_back(c);
+      max_cpu = c;
+    }
+  }
+  topo.nodeOf.assign(max_cpu + 1, 0);
+  for (int node = 0;; node++) { // Узлы нумеруются подряд
+    std::string path = "/sys/devices/system/node/node" +
+                       std::to_string(node) + "/cpulist";
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f) {
+      break;
+    }
+    char line[4096];
+    std::vector<int> cpus; // Ядра узла
+    if (fgets(line, sizeof(line), f) && pin_parse_list(line, &cpus)) {
+      for (size_t i = 0; i < cpus.size(); i++) {
+        if (cpus[i] <= max_cpu) {
+          topo.nodeOf[cpus[i]] = node;
+        }
+      }
+    }
+    fclose(f);
+    topo.nodes = node + 1;
+  }
+  return topo;
+}
+
+// Ядра в порядке, в котором их получают потоки (k-й поток - ядро
+// order[k % size]); пусто при PIN_OFF
+inline std::vector<int> pin_order(const PinSpec &spec,
+                                  const CpuTopology &topo) {
+  std::vector<int> order;
+  if (spec.policy == PIN_LIST) {
+    return spec.cpus;
+  }
+  if (spec.policy == PIN_OFF) {
+    return order;
+  }
+  std::vector<std::vector<int>> byNode(topo.nodes); // Ядра каждого узла
+  for (size_t i = 0; i < topo.cpus.size(); i++) {
+    byNode[topo.nodeOf[topo.cpus[i]]].push_back(topo.cpus[i]);
+  }
+  if (spec.policy == PIN_COMPACT) { // Узел за узлом
+    for (int n = 0; n < topo.nodes; n++) {
+      order.insert(order.end(), byNode[n].begin(), byNode[n].end());
+    }
+    return order;
+  }
+  for (size_t k = 0; order.size() < topo.cpus.size(); k++) { // По кругу
+    for (int n = 0; n < topo.nodes; n++) {
+      if (k < byNode[n].size()) {
+        order.push_back(byNode[n][k]);
+      }
+    }
+  }
+  return order;
+}
+
+// Узел NUMA ядра cpu (0, если ядро вне топологии)
+inline int topology_node(const CpuTopology &topo, int cpu) {
+  return cpu >= 0 && cpu < (int)topo.nodeOf.size() ? topo.nodeOf[cpu] : 0;
+}
+
+// Атрибуты потока, привязанного к ядру cpu
+inline void pin_attr(pthread_attr_t *attr, int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+}
+
+// Блок памяти на узлах nodes: на одном узле - MPOL_PREFERRED, на нескольких -
+// страницы по очереди (MPOL_INTERLEAVE). Политика задается до первой записи,
+// поэтому страницы сразу выделяются на нужных узлах. Если mbind недоступен,
+// блок остается обычной памятью. NULL - ошибка mmap.
+inline void *numa_alloc(size_t bytes, const std::vector<int> &nodes) {
+  void *mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return NULL;
+  }
+  unsigned long mask = 0; // Маска узлов (до 64 узлов)
+  for (size_t i = 0; i < nodes.size(); i++) {
+    if (nodes[i] < 64) {
+      mask |= 1UL << nodes[i];
+    }
+  }
+  if (mask != 0) {
+    int mode = (mask & (mask - 1)) == 0 ? MPOL_PREFERRED : MPOL_INTERLEAVE;
+    syscall(SYS_mbind, mem, bytes, mode, &mask, sizeof(mask) * 8 + 1, 0U);
+  }
+  return mem;
+}
+
+inline void numa_free(void *mem, size_t bytes) {
+  if (mem) {
+    munmap(mem, bytes);
+  }
+}
+
+#endif // __linux__
+
+#endif // CLINIC_PLACEMENT_H
@@ -0,0 +1,114 @@
+#ifndef CLINIC_REFERRAL_H
+#define CLINIC_REFERRAL_H
+
+// Политики направления к специалистам (--referral). Каждому пациенту
+// подходит несколько типов специалистов (--eligible=<k>, по умолчанию 1):
+// первый - случайный выбор workload_referral, остальные добавляются тоже по
+// ключу (сид, пациент). Из подходящих типов дежурный врач выбирает:
+//   random      - первый подходящий тип (прежнее поведение)
+//   round-robin - по очереди, общим счетчиком направлений
+//   jsq         - тип с самой короткой очередью (join-shortest-queue)
+//   lew         - тип, у которого пациент раньше всего закончит лечение:
+//                 (в очереди + на лечении) * среднее время / число врачей +
+//                 среднее время (least expected work)
+// Длины очередей и число пациентов на лечении программа публикует в
+// атомарных счетчиках при каждой смене состояния пациента, поэтому врач
+// читает их без захвата мьютексов очередей.
+
+#include <atomic>  // Подключаем атомарные операции (std::atomic)
+#include <cstdio>  // Подключаем fprintf
+#include <cstring> // Подключаем strcmp
+
+#include "ClinicWorkload.h" // Подключаем workload_referral, workload_random
+
+enum ReferralPolicy {
+  REFERRAL_RANDOM = 0,      // Случайный тип (по умолчанию)
+  REFERRAL_ROUND_ROBIN = 1, // По очереди
+  REFERRAL_JSQ = 2,         // Самая короткая очередь
+  REFERRAL_LEW = 3          // Наименьшая ожидаемая работа
+};
+
+const char *const REFERRAL_NAMES[4] = {"random", "round-robin", "jsq",
+                                       "lew"}; // Названия для лога
+
+// Разбор названия политики
+inline bool referral_policy_parse(const char *text, ReferralPolicy *policy) {
+  for (int i = 0; i < 4; i++) {
+    if (strcmp(text, REFERRAL_NAMES[i]) == 0) {
+      *policy = (ReferralPolicy)i;
+      return true;
+    }
+  }
+  fprintf(stderr, "Unknown referral policy: %s\n", text);
+  return false;
+}
+
+// Нагрузка на специалистов одного типа в момент направления
+struct ReferralLoad {
+  int queued;     // Пациентов в очереди
+  int busy;       // Пациентов на лечении
+  int staff;      // Специалистов этого типа
+  double mean_ms; // Среднее время лечения (мс)
+};
+
+// Подходящие пациенту типы специалистов (битовая маска из kinds типов):
+// первый - workload_referral, еще choices - 1 выбираются среди остальных
+inline unsigned referral_eligible(unsigned seed, int pid, int kinds,
+                                  int choices, int *primary) {
+  *primary = workload_referral(seed, pid, kinds); // Основной тип
+  unsigned mask = 1u << *primary;
+  for (int k = 1; k < choices && k < kinds; k++) {
+    int left = kinds - k; // Сколько типов еще не выбрано
+    int skip = (int)(((workload_random(seed, pid, WORKLOAD_STREAM_REFERRAL,
+                                       k) >> 32) * (uint64_t)left) >> 32);
+    for (int t = 0; t < kinds; t++) { // Берем skip-й невыбранный тип
+      if (!(mask & (1u << t)) && skip-- == 0) {
+        mask |= 1u << t;
+        break;
+      }
+    }
+  }
+  return mask;
+}
+
+// Выбор типа специалиста из маски подходящих; rr - общий счетчик для
+// round-robin. При равенстве побеждает основной тип, затем меньший номер.
+inline int referral_choose(ReferralPolicy policy, unsigned mask, int primary,
+                           const ReferralLoad *load, int kinds,
+                           std::atomic<unsigned> *rr) {
+  if (policy == REFERRAL_RANDOM || (mask & (mask - 1)) == 0) {
+    return primary; // Выбирать не из чего
+  }
+  if (policy == REFERRAL_ROUND_ROBIN) {
+    unsigned start = rr->fetch_add(1, std::memory_order_relaxed) % kinds;
+    for (int k = 0; k < kinds; k++) { // Первый подходящий начиная со start
+      int t = (int)((start + k) % kinds);
+      if (mask & (1u << t)) {
+        return t;
+      }
+    }
+    return primary;
+  }
+  int best = primary;    // Лучший тип
+  double best_cost = 0;  // Его стоимость
+  for (int k = 0; k < kinds; k++) {
+    int t = (primary + k) % kinds; // Основной тип проверяем первым
+    if (!(mask & (1u << t))) {
+      continue;
+    }
+    const ReferralLoad &l = load[t];
+    double cost = l.queued; // jsq: длина очереди
+    if (policy == REFERRAL_LEW) {
+      cost = (l.queued + l.busy) * l.mean_ms / (l.staff > 0 ? l.staff : 1) +
+             l.mean_ms; // Когда пациент закончит лечение (мс)
+    }
+    if (k == 0 || cost < best_cost ||
+        (cost == best_cost && best != primary && t < best)) {
+      best = t;
+      best_cost = cost;
+    }
+  }
+  return best;
+}
+
+#endif // CLINIC_REFERRAL_H
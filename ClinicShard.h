@@ -0,0 +1,164 @@
+#ifndef CLINIC_SHARD_H
+#define CLINIC_SHARD_H
+
+// Сеть клиник (--shards). Каждая клиника - отдельный процесс со своими
+// очередями, мьютексами, логом и ядрами процессора; между клиниками нет ни
+// одного общего мьютекса. Общая у них только ShardNetwork в разделяемой
+// памяти (mmap до fork()):
+//   - длина очереди к дежурным каждой клиники, которую клиника публикует
+//     при каждом приходе и приеме пациента;
+//   - входящий канал каждой клиники - ограниченная lock-free очередь
+//     Вьюкова (MpmcQueue) с буфером в той же памяти. Если канал полон,
+//     пациент остается в своей клинике. Регистратура клиники спит на
+//     eventcount канала (futex между процессами), пока ее не разбудит
+//     передача пациента или конец приема в другой клинике;
+//   - счетчики передач, по которым клиники узнают, что пациентов больше не
+//     будет.
+// Атомарные операции над lock-free типами не зависят от адреса отображения,
+// поэтому работают между процессами так же, как между потоками.
+
+#if !defined(_WIN32)
+#define CLINIC_HAVE_SHARDS 1
+
+#include <atomic>      // Подключаем атомарные операции (std::atomic)
+#include <climits>     // Подключаем INT_MAX
+#include <cstddef>     // Подключаем size_t
+#include <new>         // Подключаем размещающий new
+#include <sched.h>     // Подключаем sched_setaffinity
+#include <string>      // Подключаем std::string
+#include <sys/mman.h>  // Подключаем mmap
+#include <sys/wait.h>  // Подключаем waitpid
+#include <unistd.h>    // Подключаем sysconf, fork
+
+#include "ClinicMpmcQueue.h" // Подключаем MpmcQueue и CLINIC_CACHE_LINE
+
+const size_t SHARD_CHANNEL_CAPACITY = 256; // Пациентов в канале клиники
+
+// Пациент, переданный из одной клиники в другую
+struct ShardTransfer {
+  int patient; // Номер пациента
+  int from;    // Клиника, из которой он пришел (с нуля)
+};
+
+// Общее состояние одной клиники; каждая клиника на своих кэш-линиях
+struct alignas(CLINIC_CACHE_LINE) ShardSlot {
+  ShardSlot() : arrivals(true) {}
+
+  std::atomic<int> dutyWaiting;   // Длина очереди к дежурным врачам
+  std::atomic<int> transfersIn;   // Пациентов, переданных в клинику
+  std::atomic<int> transfersOut;  // Пациентов, переданных из клиники
+  std::atomic<int> treated;       // Пациентов, вылеченных клиникой
+  std::atomic<long long> startNs; // Начало приема пациентов (нс)
+  std::atomic<long long> endNs;   // Конец рабочего дня (нс)
+  MpmcQueue<ShardTransfer> inbox; // Входящий канал
+  EventCount arrivals; // Парковка регистратуры до передачи или конца приема
+};
+
+struct ShardNetwork {
+  std::atomic<int> admitting; // Клиник, которые еще принимают своих
+  int count;                  // Число клиник
+  size_t bytes;               // Размер отображения
+  ShardSlot *slots;           // Клиники
+};
+
+// Сеть из count клиник в разделяемой памяти (NULL - ошибка mmap)
+inline ShardNetwork *shard_network_create(int count) {
+  size_t channel = MpmcQueue<ShardTransfer>::buffer_bytes(
+      SHARD_CHANNEL_CAPACITY); // Буфер одного канала
+  size_t head = (sizeof(ShardNetwork) + CLINIC_CACHE_LINE - 1) /
+                CLINIC_CACHE_LINE * CLINIC_CACHE_LINE;
+  size_t bytes = head + count * (sizeof(ShardSlot) + channel);
+  void *mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return NULL;
+  }
+  ShardNetwork *net = new (mem) ShardNetwork();
+  net->admitting.store(count);
+  net->count = count;
+  net->bytes = bytes;
+  net->slots = (ShardSlot *)((char *)mem + head);
+  char *buffers = (char *)(net->slots + count); // Буферы каналов
+  for (int i = 0; i < count; i++) {
+    ShardSlot *slot = new (&net->slots[i]) ShardSlot();
+    slot->dutyWaiting.store(0);
+    slot->transfersIn.store(0);
+    slot->transfersOut.store(0);
+    slot->treated.store(0);
+    slot->startNs.store(0);
+    slot->endNs.store(0);
+    slot->inbox.init(SHARD_CHANNEL_CAPACITY, buffers + i * channel);
+  }
+  return net;
+}
+
+inline void shard_network_destroy(ShardNetwork *net) {
+  munmap(net, net->bytes);
+}
+
+// Клиника впустила своих пациентов (или не запустилась): будим регистратуры
+// всех клиник, чтобы они проверили, не кончились ли пациенты сети
+inline void shard_admission_closed(ShardNetwork *net) {
+  net->admitting.fetch_sub(1);
+  for (int i = 0; i < net->count; i++) {
+    net->slots[i].arrivals.notify_all();
+  }
+}
+
+// Очередь к дежурным клиники вместе с пациентами, которые уже идут к ней
+// по каналу
+inline int shard_load(const ShardSlot &slot) {
+  return slot.dutyWaiting.load(std::memory_order_relaxed) +
+         (int)slot.inbox.size_approx();
+}
+
+// Клиника, в которую передать пришедшего пациента клиники self: если своя
+// очередь к дежурным не короче overflow, то клиника с самой короткой
+// очередью, если она короче своей; иначе -1 (пациент остается)
+inline int shard_pick(const ShardNetwork *net, int self, int overflow) {
+  int own = shard_load(net->slots[self]);
+  if (own < overflow) {
+    return -1;
+  }
+  int best = -1;      // Клиника с самой короткой очередью
+  int best_len = own; // Ее очередь должна быть короче своей
+  for (int i = 0; i < net->count; i++) {
+    int len = shard_load(net->slots[i]);
+    if (i != self && len < best_len) {
+      best = i;
+      best_len = len;
+    }
+  }
+  return best;
+}
+
+// Привязка процесса клиники shard из count к своей группе ядер; возвращает
+// описание ядер для лога ("2-3"). Если ядер меньше, чем клиник, клиники
+// делят ядра по кругу.
+inline std::string shard_pin(int shard, int count) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN); // Доступно ядер
+  if (cpus < 1) {
+    cpus = 1;
+  }
+  int per = cpus >= count ? (int)(cpus / count) : 1; // Ядер на клинику
+  int first = (int)((shard * per) % cpus);           // Первое ядро клиники
+  std::string text = std::to_string(first);
+  if (per > 1) {
+    text += "-" + std::to_string(first + per - 1);
+  }
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int c = first; c < first + per; c++) {
+    CPU_SET(c, &set);
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    text += " (not pinned)"; // Нет прав или ядра недоступны
+  }
+#endif
+  return text;
+}
+
+#endif // !_WIN32
+
+#endif // CLINIC_SHARD_H
@@ -0,0 +1,212 @@
+#ifndef CLINIC_SPIN_PARK_H
+#define CLINIC_SPIN_PARK_H
+
+// Гибридный мьютекс и условная переменная (--lock=hybrid). Между
+// pthread_spinlock_t (крутится, пока не захватит, и жжет процессор) и обычным
+// мьютексом (сразу засыпает в ядре) есть середина: поток, не захвативший
+// мьютекс сразу, сначала крутится с экспоненциальной задержкой - 1, 2, 4, ...
+// до SPIN_PARK_MAX_DELAY инструкций pause между попытками, - а когда
+// исчерпан бюджет (--spin-budget, инструкций pause), паркуется на futex.
+// Условная переменная так же сначала крутится, ожидая сигнала, и только
+// потом засыпает. Бюджет 0 - сразу парковка, как у обычного мьютекса.
+//
+// Мьютекс - слово futex по схеме Дреппера ("Futexes Are Tricky"): 0 -
+// свободен, 1 - захвачен, 2 - захвачен и, возможно, есть спящие; освобождение
+// делает системный вызов, только если кто-то мог уснуть. Каждый мьютекс
+// ведет статистику для настройки бюджета: захваты, захваты с ожиданием,
+// инструкции pause, парковки и время удержания (если включено set_timed,
+// время меряется при каждом захвате).
+
+#include <atomic>  // Подключаем атомарные операции (std::atomic)
+#include <climits> // Подключаем INT_MAX
+#include <cstdint> // Подключаем целые фиксированного размера
+#include <cstdio>  // Подключаем snprintf
+#include <ctime>   // Подключаем clock_gettime
+
+#include "ClinicMpmcQueue.h" // Подключаем CLINIC_CPU_RELAX и futex
+
+const int SPIN_PARK_DEFAULT_BUDGET = 1000; // Бюджет по умолчанию (pause)
+const int SPIN_PARK_MAX_DELAY = 64;        // Наибольшая пауза между попытками
+
+// Статистика одного мьютекса и его условной переменной
+struct SpinParkStats {
+  std::atomic<uint64_t> acquisitions; // Захватов
+  std::atomic<uint64_t> contended;    // Захватов, не удавшихся сразу
+  std::atomic<uint64_t> spins;        // Инструкций pause в ожидании
+  std::atomic<uint64_t> parks;        // Засыпаний на futex мьютекса
+  std::atomic<uint64_t> holdNs;       // Суммарное время удержания (нс)
+  std::atomic<uint64_t> maxHoldNs;    // Наибольшее время удержания (нс)
+  std::atomic<uint64_t> waits;        // Ожиданий условной переменной
+  std::atomic<uint64_t> waitSpins;    // Ожиданий, дождавшихся сигнала в цикле
+  std::atomic<uint64_t> waitParks;    // Ожиданий, уснувших на futex
+
+  SpinParkStats()
+      : acquisitions(0), contended(0), spins(0), parks(0), holdNs(0),
+        maxHoldNs(0), waits(0), waitSpins(0), waitParks(0) {}
+};
+
+// Монотонное время (нс) для времени удержания
+inline uint64_t spin_park_now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+class SpinParkMutex {
+public:
+  SpinParkMutex()
+      : state_(0), spinBudget_(SPIN_PARK_DEFAULT_BUDGET), timed_(false),
+        lockedAt_(0) {}
+  SpinParkMutex(const SpinParkMutex &) = delete;
+  SpinParkMutex &operator=(const SpinParkMutex &) = delete;
+
+  // Сколько инструкций pause крутиться перед парковкой
+  void set_spin_budget(int budget) { spinBudget_ = budget; }
+  int spin_budget() const { return spinBudget_; }
+
+  // Мерить ли время удержания (два вызова clock_gettime на захват)
+  void set_timed(bool timed) { timed_ = timed; }
+
+  bool try_lock() {
+    uint32_t expected = 0;
+    return state_.compare_exchange_strong(expected, 1,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+  }
+
+  void lock() {
+    stats_.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (!try_lock()) {
+      lock_contended();
+    }
+    if (timed_) {
+      lockedAt_ = spin_park_now_ns(); // Пишет только владелец
+    }
+  }
+
+  void unlock() {
+    if (timed_) {
+      uint64_t held = spin_park_now_ns() - lockedAt_;
+      stats_.holdNs.fetch_add(held, std::memory_order_relaxed);
+      if (held > stats_.maxHoldNs.load(std::memory_order_relaxed)) {
+        stats_.maxHoldNs.store(held, std::memory_order_relaxed); // Владелец
+      }
+    }
+    if (state_.exchange(0, std::memory_order_release) == 2) { // Есть спящие
+      clinic_futex_wake(&state_, 1);
+    }
+  }
+
+  SpinParkStats &stats() { return stats_; }
+  const SpinParkStats &stats() const { return stats_; }
+
+private:
+  // Мьютекс занят: крутимся в пределах бюджета, затем паркуемся
+  void lock_contended() {
+    stats_.contended.fetch_add(1, std::memory_order_relaxed);
+    int spun = 0;  // Инструкций pause
+    int delay = 1; // Пауза до следующей попытки
+    while (spun < spinBudget_) {
+      for (int i = 0; i < delay; i++) {
+        CLINIC_CPU_RELAX();
+      }
+      spun += delay;
+      if (state_.load(std::memory_order_relaxed) == 0 && try_lock()) {
+        stats_.spins.fetch_add(spun, std::memory_order_relaxed);
+        return; // Захватили, не засыпая
+      }
+      if (delay < SPIN_PARK_MAX_DELAY) {
+        delay *= 2;
+      }
+    }
+    stats_.spins.fetch_add(spun, std::memory_order_relaxed);
+    while (state_.exchange(2, std::memory_order_acquire) != 0) {
+      stats_.parks.fetch_add(1, std::memory_order_relaxed);
+      clinic_futex_wait(&state_, 2); // Спим, пока мьютекс занят
+    }
+  }
+
+  std::atomic<uint32_t> state_; // 0 - свободен, 1 - занят, 2 - есть спящие
+  int spinBudget_;              // Бюджет ожидания в цикле (pause)
+  bool timed_;                  // Мерить ли время удержания
+  uint64_t lockedAt_;           // Момент захвата (нс)
+  SpinParkStats stats_;         // Статистика
+};
+
+// Условная переменная для SpinParkMutex: номер сигнала - слово futex.
+// Ожидающий запоминает номер под мьютексом, отпускает мьютекс и ждет, пока
+// номер не изменится: сначала в цикле с бюджетом мьютекса, затем на futex.
+// Сигнал делает системный вызов, только если кто-то мог уснуть. Как и
+// pthread_cond_wait, wait может вернуться без сигнала, поэтому условие
+// проверяют в цикле.
+class SpinParkCond {
+public:
+  SpinParkCond() : seq_(0), sleepers_(0) {}
+  SpinParkCond(const SpinParkCond &) = delete;
+  SpinParkCond &operator=(const SpinParkCond &) = delete;
+
+  void wait(SpinParkMutex &m) {
+    SpinParkStats &stats = m.stats();
+    stats.waits.fetch_add(1, std::memory_order_relaxed);
+    uint32_t seq = seq_.load(std::memory_order_relaxed); // Под мьютексом
+    m.unlock();
+    int spun = 0;  // Инструкций pause
+    int delay = 1; // Пауза до следующей проверки
+    while (spun < m.spin_budget() &&
+           seq_.load(std::memory_order_acquire) == seq) {
+      for (int i = 0; i < delay; i++) {
+        CLINIC_CPU_RELAX();
+      }
+      spun += delay;
+      if (delay < SPIN_PARK_MAX_DELAY) {
+        delay *= 2;
+      }
+    }
+    stats.spins.fetch_add(spun, std::memory_order_relaxed);
+    if (seq_.load(std::memory_order_acquire) != seq) {
+      stats.waitSpins.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      stats.waitParks.fetch_add(1, std::memory_order_relaxed);
+      sleepers_.fetch_add(1); // Сигнал увидит нас или мы - новый номер
+      clinic_futex_wait(&seq_, seq);
+      sleepers_.fetch_sub(1);
+    }
+    m.lock();
+  }
+
+  void signal() { notify(1); }
+  void broadcast() { notify(INT_MAX); }
+
+private:
+  void notify(int count) {
+    seq_.fetch_add(1); // Будит и крутящихся, и засыпающих
+    if (sleepers_.load() > 0) {
+      clinic_futex_wake(&seq_, count);
+    }
+  }
+
+  std::atomic<uint32_t> seq_; // Номер последнего сигнала
+  std::atomic<int> sleepers_; // Ожидающих, которые могли уснуть на futex
+};
+
+// Строка статистики мьютекса для лога
+inline void spin_park_format(const SpinParkStats &s, char *text,
+                             size_t size) {
+  uint64_t acq = s.acquisitions.load();
+  uint64_t contended = s.contended.load();
+  uint64_t waits = s.waits.load();
+  snprintf(text, size,
+           "%llu locks, %.1f%% contended, %llu pauses, %llu parks; "
+           "%llu waits, %llu woken spinning, %llu parked; hold mean %.2f us, "
+           "max %.2f us",
+           (unsigned long long)acq,
+           acq > 0 ? 100.0 * contended / acq : 0.0,
+           (unsigned long long)s.spins.load(),
+           (unsigned long long)s.parks.load(), (unsigned long long)waits,
+           (unsigned long long)s.waitSpins.load(),
+           (unsigned long long)s.waitParks.load(),
+           acq > 0 ? s.holdNs.load() / 1000.0 / acq : 0.0,
+           s.maxHoldNs.load() / 1000.0);
+}
+
+#endif // CLINIC_SPIN_PARK_H
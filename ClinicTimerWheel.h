@@ -0,0 +1,140 @@
+#ifndef CLINIC_TIMER_WHEEL_H
+#define CLINIC_TIMER_WHEEL_H
+
+// Иерархическое колесо таймеров (Варгезе и Лаук) для окончаний приема в
+// --engine=coro. Время делится на тики по tick_ns; колесо - четыре уровня по
+// 64 ячейки. Уровень k хранит таймеры, до которых осталось меньше 64^(k+1)
+// тиков, в ячейке по k-й группе из 6 бит момента срабатывания. Постановка
+// таймера - добавление в ячейку, O(1) при любом числе ожидающих; каждые 64
+// тика ячейка следующего уровня "осыпается" на нижние уровни, пока таймер не
+// окажется на нулевом уровне в ячейке своего тика. Таймеры дальше 64^4 тиков
+// ждут на верхнем уровне и переставляются при каждом осыпании. Таймер
+// срабатывает не раньше заданного момента и не позже конца его тика.
+
+#include <cstddef> // Подключаем size_t
+#include <cstdint> // Подключаем целые фиксированного размера
+#include <vector>  // Подключаем std::vector
+
+template <typename T> class TimerWheel {
+public:
+  // tick_ns - длина тика (нс), start_ns - текущее время (нс)
+  TimerWheel(uint64_t tick_ns, uint64_t start_ns)
+      : tickNs_(tick_ns), now_(start_ns / tick_ns), size_(0) {}
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  // Таймер на момент due_ns (нс): сработает в тике, содержащем due_ns
+  void add(uint64_t due_ns, const T &value) {
+    uint64_t due = (due_ns + tickNs_ - 1) / tickNs_; // Тик срабатывания
+    size_++;
+    if (due <= now_) { // Тик уже пройден - сработает при ближайшем advance
+      expired_.push_back(value);
+      return;
+    }
+    place(Entry{due, value});
+  }
+
+  // Когда (нс) в следующий раз вызвать advance: ближайший занятый тик
+  // нулевого уровня до ближайшего осыпания или само осыпание (после него
+  // верхние уровни могут принести более ранние таймеры); UINT64_MAX -
+  // таймеров нет
+  uint64_t next_due_ns() const {
+    if (size_ == 0) {
+      return UINT64_MAX;
+    }
+    if (!expired_.empty()) {
+      return now_ * tickNs_;
+    }
+    uint64_t cascade = ((now_ >> BITS) + 1) << BITS; // Следующее осыпание
+    for (uint64_t t = now_ + 1; t < cascade; t++) {
+      if (!slots_[0][t & MASK].empty()) {
+        return t * tickNs_;
+      }
+    }
+    return cascade * tickNs_;
+  }
+
+  // Продвижение часов до now_ns (нс): fire(value) для каждого наступившего
+  // таймера, в порядке моментов срабатывания
+  template <typename F> void advance(uint64_t now_ns, F fire) {
+    if (!expired_.empty()) {
+      fire_list(expired_, fire);
+    }
+    uint64_t target = now_ns / tickNs_; // До какого тика идем
+    while (now_ < target) {
+      if (size_ == 0) { // Пустое колесо: сразу переводим часы
+        now_ = target;
+        break;
+      }
+      now_++;
+      for (int level = 1; level < LEVELS; level++) { // Осыпание уровней
+        if (((now_ >> (BITS * (level - 1))) & MASK) != 0) {
+          break; // Нижний уровень не прошел полный круг
+        }
+        cascade(level, (now_ >> (BITS * level)) & MASK);
+      }
+      std::vector<Entry> &slot = slots_[0][now_ & MASK]; // Таймеры тика
+      if (!slot.empty()) {
+        scratch_.swap(slot); // Ячейка освобождается до вызовов fire
+        for (size_t i = 0; i < scratch_.size(); i++) {
+          fire(scratch_[i].value);
+        }
+        size_ -= scratch_.size();
+        scratch_.clear(); // Память остается для следующих ячеек
+      }
+    }
+  }
+
+private:
+  static const int LEVELS = 4;             // Уровней колеса
+  static const int BITS = 6;               // Бит номера ячейки
+  static const uint64_t SLOTS = 1 << BITS; // Ячеек на уровне
+  static const uint64_t MASK = SLOTS - 1;  // Маска номера ячейки
+
+  struct Entry {
+    uint64_t due; // Тик срабатывания
+    T value;      // Значение таймера
+  };
+
+  // Таймер в ячейку уровня, соответствующего оставшемуся времени
+  void place(const Entry &e) {
+    uint64_t delta = e.due - now_; // Тиков до срабатывания (due >= now_)
+    for (int level = 0; level < LEVELS; level++) {
+      if (delta < (1ULL << (BITS * (level + 1)))) {
+        slots_[level][(e.due >> (BITS * level)) & MASK].push_back(e);
+        return;
+      }
+    }
+    uint64_t last = now_ + (1ULL << (BITS * LEVELS)) - 1; // Дальше колеса
+    slots_[LEVELS - 1][(last >> (BITS * (LEVELS - 1))) & MASK].push_back(e);
+  }
+
+  // Перестановка таймеров ячейки index уровня level на нижние уровни
+  void cascade(int level, uint64_t index) {
+    std::vector<Entry> moved; // Таймеры осыпающейся ячейки
+    moved.swap(slots_[level][index]);
+    for (size_t i = 0; i < moved.size(); i++) {
+      place(moved[i]);
+    }
+  }
+
+  // Срабатывание таймеров из списка уже наступивших
+  template <typename F> void fire_list(std::vector<T> &list, F fire) {
+    std::vector<T> due; // Список освобождается до вызовов fire
+    due.swap(list);
+    for (size_t i = 0; i < due.size(); i++) {
+      fire(due[i]);
+    }
+    size_ -= due.size();
+  }
+
+  uint64_t tickNs_;                         // Длина тика (нс)
+  uint64_t now_;                            // Последний пройденный тик
+  size_t size_;                             // Таймеров в колесе
+  std::vector<Entry> slots_[LEVELS][SLOTS]; // Ячейки уровней
+  std::vector<Entry> scratch_;              // Буфер срабатывающей ячейки
+  std::vector<T> expired_;                  // Таймеры на пройденные тики
+};
+
+#endif // CLINIC_TIMER_WHEEL_H
@@ -0,0 +1,124 @@
+// Утилита clinic-trace: печатает бинарную трассу (--trace=<file>) в текстовом
+// формате лога клиники или в CSV.
+// Сборка: g++ -O2 -o clinic-trace ClinicTrace.cpp
+
+#include <cstdio>    // Подключаем printf, fwrite
+#include <cstring>   // Подключаем strcmp, memcmp
+#include <fcntl.h>   // Подключаем open()
+#include <sys/mman.h> // Подключаем mmap()
+#include <sys/stat.h> // Подключаем fstat()
+#include <unistd.h>  // Подключаем close()
+
+#include "ClinicTrace.h" // Формат трассы
+
+// Функция отображения справки
+void print_help() {
+  printf("Usage: clinic-trace [options] <trace-file>\n"
+         "Options:\n"
+         "  --csv          Print events as CSV instead of the log format\n"
+         "  --help [-h]    Display this help message\n");
+}
+
+// Печать метки времени "[mm:ss:mmm]" по времени события в нс
+void print_stamp(uint64_t ts_ns) {
+  uint64_t elapsed = ts_ns / 1000000; // Время в мс
+  printf("[%02d:%02d:%03d] ", (int)(elapsed / 60000),
+         (int)((elapsed / 1000) % 60), (int)(elapsed % 1000));
+}
+
+int main(int argc, char **argv) {
+  bool csv = false;         // Печатать ли CSV
+  const char *path = NULL;  // Имя файла трассы
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      print_help();
+      return 0;
+    } else if (strcmp(argv[i], "--csv") == 0) {
+      csv = true;
+    } else {
+      path = argv[i];
+    }
+  }
+  if (path == NULL) {
+    print_help();
+    return 1;
+  }
+
+  int fd = open(path, O_RDONLY); // Открываем трассу
+  if (fd < 0) {
+    perror("Failed to open trace file");
+    return 1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceHeader)) {
+    fprintf(stderr, "Trace file is too short\n");
+    return 1;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    perror("Failed to map trace file");
+    return 1;
+  }
+
+  const TraceHeader *h = (const TraceHeader *)map; // Заголовок трассы
+  if (memcmp(h->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+      h->record_size != sizeof(TraceRecord)) {
+    fprintf(stderr, "Not a clinic trace file\n");
+    return 1;
+  }
+  uint64_t count = h->count; // Число событий в файле
+  uint64_t fit = (st.st_size - sizeof(TraceHeader)) / sizeof(TraceRecord);
+  if (count > fit) {
+    count = fit; // Файл обрезан - читаем только целые записи
+  }
+  const TraceRecord *records =
+      (const TraceRecord *)((const char *)map + sizeof(TraceHeader));
+
+  static char out[1 << 16]; // Буфер stdout
+  setvbuf(stdout, out, _IOFBF, sizeof(out));
+
+  if (csv) {
+    printf("ts_ns,kind,actor,patient,specialist\n");
+    for (uint64_t i = 0; i < count; i++) {
+      const TraceRecord &r = records[i];
+      printf("%llu,%s,%u,%u,%d\n", (unsigned long long)r.ts_ns,
+             trace_kind_name(r.kind), r.actor, r.patient, r.specialist);
+    }
+  } else {
+    uint64_t start = count > 0 ? records[0].ts_ns : 0; // Время параметров
+    print_stamp(start);
+    printf("Simulation Parameters:\n");
+    print_stamp(start);
+    printf("Number of patients: %d\n", h->n);
+    print_stamp(start);
+    printf("Duty doctor's processing time (ms): %d\n", h->t_d);
+    print_stamp(start);
+    printf("Specialist's treatment time (ms): %d\n", h->t_s);
+    if (h->duty_docs != 2 || h->specialists[0] != 1 || h->specialists[1] != 1 ||
+        h->specialists[2] != 1) { // Штат отличается от стандартного
+      print_stamp(start);
+      printf("Duty doctors: %d\n", h->duty_docs);
+      print_stamp(start);
+      printf("Specialists: dentist=%d, surgeon=%d, therapist=%d\n",
+             h->specialists[0], h->specialists[1], h->specialists[2]);
+    }
+    print_stamp(start);
+    printf("Log file: %s\n\n", h->log_file);
+
+    char text[256]; // Текст одного события
+    for (uint64_t i = 0; i < count; i++) {
+      trace_format_text(*h, records[i], text, sizeof(text));
+      print_stamp(records[i].ts_ns);
+      printf("%s\n", text);
+    }
+  }
+  fflush(stdout);
+
+  if (h->dropped > 0) {
+    fprintf(stderr, "Warning: %llu events did not fit into the trace\n",
+            (unsigned long long)h->dropped);
+  }
+  munmap(map, st.st_size);
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,220 @@
+#ifndef CLINIC_TRACE_H
+#define CLINIC_TRACE_H
+
+// Бинарная трасса событий клиники (--trace=<file>). Каждое событие - запись
+// фиксированного размера в 16 байт (время в нс, тип события, врач, пациент,
+// специалист) вместо отформатированной строки. Файл заранее растягивается под
+// ожидаемое число событий и отображается в память, так что запись события -
+// это один fetch_add по счетчику и копирование 16 байт. Утилита clinic-trace
+// (ClinicTrace.cpp) читает файл через mmap и печатает его в прежнем текстовом
+// формате лога или в CSV.
+
+#include <atomic>   // Подключаем атомарные операции (std::atomic)
+#include <cstdint>  // Подключаем целые фиксированного размера
+#include <cstdio>   // Подключаем snprintf
+#include <cstring>  // Подключаем memset, strncpy
+#include <fcntl.h>  // Подключаем open()
+#include <sys/mman.h> // Подключаем mmap()
+#include <unistd.h> // Подключаем ftruncate(), close()
+
+// Типы событий трассы (по одному на каждое сообщение лога)
+enum TraceKind {
+  TRACE_PATIENT_ENTERED = 0,          // Пациент встал в очередь к дежурным
+  TRACE_DUTY_ACCEPTED = 1,            // Дежурный врач принял пациента
+  TRACE_DUTY_REFERRED = 2,            // Дежурный врач направил к специалисту
+  TRACE_TREATMENT_STARTED = 3,        // Специалист начал лечение
+  TRACE_TREATMENT_FINISHED = 4,       // Специалист закончил лечение
+  TRACE_PATIENT_HOME = 5,             // Пациент ушел домой
+  TRACE_DUTY_ENDED = 6,               // Дежурный врач ушел домой
+  TRACE_SPECIALIST_ENDED = 7,         // Специалист ушел домой
+  TRACE_ALL_TREATED = 8,              // Все пациенты вылечены
+  TRACE_DAY_ENDED = 9,                // Рабочий день окончен
+  TRACE_PATIENT_TRANSFERRED_OUT = 10, // Пациент передан в клинику actor
+  TRACE_PATIENT_TRANSFERRED_IN = 11,  // Пациент принят из клиники actor
+  TRACE_KIND_COUNT = 12               // Число типов событий
+};
+
+// Программа, записавшая трассу (тексты сообщений у них чуть различаются)
+enum TraceProgram {
+  TRACE_PROGRAM_PTHREAD = 0, // ClinicMultithreadPthread
+  TRACE_PROGRAM_OTHER = 1,   // ClinicMultithreadPthreadOther
+  TRACE_PROGRAM_OPENMP = 2   // ClinicMultithreadOpenMP
+};
+
+// Запись события: 16 байт
+struct TraceRecord {
+  uint64_t ts_ns;     // Время события (нс с начала программы)
+  uint8_t kind;       // Тип события (TraceKind)
+  int8_t specialist;  // Тип специалиста (-1 - нет)
+  uint16_t actor;     // Номер врача, специалиста своего типа или клиники
+  uint32_t patient;   // Номер пациента (0 - нет)
+};
+static_assert(sizeof(TraceRecord) == 16, "trace record must be 16 bytes");
+
+const char TRACE_MAGIC[8] = {'C', 'L', 'N', 'T', 'R', 'C', '1', 0};
+
+// Заголовок файла трассы: параметры запуска и число записей
+struct TraceHeader {
+  char magic[8];          // Сигнатура файла
+  uint32_t record_size;   // Размер записи (для проверки при чтении)
+  uint32_t program;       // TraceProgram
+  int32_t n;              // Число пациентов
+  int32_t t_d;            // Время приема дежурного врача (мс)
+  int32_t t_s;            // Время приема специалиста (мс)
+  uint32_t reserved;      // Выравнивание
+  uint64_t count;         // Число записанных событий
+  uint64_t dropped;       // Число событий, не поместившихся в файл
+  char log_file[96];      // Имя текстового лога (для строки параметров)
+  int32_t duty_docs;      // Число дежурных врачей
+  int32_t specialists[3]; // Число специалистов каждого типа
+};
+
+// Состояние писателя трассы
+bool traceEnabled = false;         // Включена ли трасса
+int traceFd = -1;                  // Дескриптор файла трассы
+char *traceMap = NULL;             // Отображение файла в память
+uint64_t traceCapacity = 0;        // Вместимость файла (записей)
+std::atomic<uint64_t> traceNext(0); // Номер следующей свободной записи
+
+// Создание файла трассы под capacity событий
+inline bool trace_open(const char *path, uint64_t capacity,
+                       TraceProgram program, int n, int t_d, int t_s,
+                       const char *log_file, int duty_docs,
+                       const int *specialists) {
+  traceFd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644); // Создаем файл
+  if (traceFd < 0) {
+    return false;
+  }
+  size_t size = sizeof(TraceHeader) + capacity * sizeof(TraceRecord);
+  if (ftruncate(traceFd, size) != 0) { // Растягиваем файл под все записи
+    close(traceFd);
+    return false;
+  }
+  void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, traceFd, 0);
+  if (map == MAP_FAILED) {
+    close(traceFd);
+    return false;
+  }
+  traceMap = (char *)map;
+  traceCapacity = capacity;
+  TraceHeader *h = (TraceHeader *)traceMap; // Заполняем заголовок
+  memset(h, 0, sizeof(TraceHeader));
+  memcpy(h->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  h->record_size = sizeof(TraceRecord);
+  h->program = program;
+  h->n = n;
+  h->t_d = t_d;
+  h->t_s = t_s;
+  strncpy(h->log_file, log_file, sizeof(h->log_file) - 1);
+  h->duty_docs = duty_docs;
+  for (int i = 0; i < 3; i++) {
+    h->specialists[i] = specialists[i];
+  }
+  traceEnabled = true;
+  return true;
+}
+
+// Запись события (безопасна при вызове из любого числа потоков)
+inline void trace_emit(uint64_t ts_ns, TraceKind kind, int actor, int patient,
+                       int specialist) {
+  uint64_t idx = traceNext.fetch_add(1, std::memory_order_relaxed); // Слот
+  if (idx >= traceCapacity) {
+    return; // Файл заполнен - событие учтется в dropped
+  }
+  TraceRecord *r =
+      (TraceRecord *)(traceMap + sizeof(TraceHeader)) + idx; // Наша запись
+  r->ts_ns = ts_ns;
+  r->kind = (uint8_t)kind;
+  r->specialist = (int8_t)specialist;
+  r->actor = (uint16_t)actor;
+  r->patient = (uint32_t)patient;
+}
+
+// Закрытие трассы: записываем число событий и обрезаем файл
+inline void trace_close() {
+  if (!traceEnabled) {
+    return;
+  }
+  uint64_t total = traceNext.load(std::memory_order_acquire);
+  uint64_t count = total < traceCapacity ? total : traceCapacity;
+  TraceHeader *h = (TraceHeader *)traceMap;
+  h->count = count;
+  h->dropped = total - count;
+  size_t mapped = sizeof(TraceHeader) + traceCapacity * sizeof(TraceRecord);
+  munmap(traceMap, mapped); // Изменения попадут в файл (MAP_SHARED)
+  if (ftruncate(traceFd, sizeof(TraceHeader) + count * sizeof(TraceRecord)) !=
+      0) {
+    perror("trace ftruncate"); // Файл останется длиннее, но count верный
+  }
+  close(traceFd);
+  traceEnabled = false;
+}
+
+// Имя специалиста по типу
+inline const char *trace_specialist_name(int specialist) {
+  return (specialist == 0)   ? "Dentist"
+         : (specialist == 1) ? "Surgeon"
+                             : "Therapist";
+}
+
+// Текст события в формате лога (без метки времени и перевода строки)
+inline int trace_format_text(const TraceHeader &h, const TraceRecord &r,
+                             char *buf, size_t size) {
+  const char *spec = trace_specialist_name(r.specialist);
+  char worker[32]; // Имя конкретного специалиста: "Dentist" или "Dentist#2"
+  if (r.specialist >= 0 && r.specialist < 3 &&
+      h.specialists[r.specialist] > 1) {
+    snprintf(worker, sizeof(worker), "%s#%u", spec, r.actor);
+  } else {
+    snprintf(worker, sizeof(worker), "%s", spec);
+  }
+  switch (r.kind) {
+  case TRACE_PATIENT_ENTERED:
+    return snprintf(buf, size,
+                    "Patient P%u entered the queue to %sduty doctors",
+                    r.patient, h.program == TRACE_PROGRAM_OPENMP ? "the " : "");
+  case TRACE_DUTY_ACCEPTED:
+    return snprintf(buf, size, "Duty Doctor D%u accepted patient P%u", r.actor,
+                    r.patient);
+  case TRACE_DUTY_REFERRED:
+    return snprintf(buf, size, "Duty Doctor D%u referred patient P%u to %s",
+                    r.actor, r.patient, spec);
+  case TRACE_TREATMENT_STARTED:
+    return snprintf(buf, size, "%s started treating patient P%u", worker,
+                    r.patient);
+  case TRACE_TREATMENT_FINISHED:
+    return snprintf(buf, size, "%s finished treating patient P%u", worker,
+                    r.patient);
+  case TRACE_PATIENT_HOME:
+    return snprintf(buf, size, "Patient P%u fully treated and went home",
+                    r.patient);
+  case TRACE_DUTY_ENDED:
+    return snprintf(buf, size, "Duty Doctor D%u ended his workday", r.actor);
+  case TRACE_SPECIALIST_ENDED:
+    return snprintf(buf, size, "%s ended his workday", worker);
+  case TRACE_ALL_TREATED:
+    return snprintf(buf, size, "All patients have been treated");
+  case TRACE_DAY_ENDED:
+    return snprintf(buf, size, "The hospital workday has ended");
+  case TRACE_PATIENT_TRANSFERRED_OUT:
+    return snprintf(buf, size, "Patient P%u transferred to clinic %u",
+                    r.patient, r.actor);
+  case TRACE_PATIENT_TRANSFERRED_IN:
+    return snprintf(buf, size, "Patient P%u transferred from clinic %u",
+                    r.patient, r.actor);
+  default:
+    return snprintf(buf, size, "Unknown event %u", r.kind);
+  }
+}
+
+// Имя типа события для CSV
+inline const char *trace_kind_name(int kind) {
+  static const char *names[TRACE_KIND_COUNT] = {
+      "patient_entered",   "duty_accepted",      "duty_referred",
+      "treatment_started", "treatment_finished", "patient_home",
+      "duty_ended",        "specialist_ended",   "all_treated",
+      "day_ended",         "transferred_out",    "transferred_in"};
+  return (kind >= 0 && kind < TRACE_KIND_COUNT) ? names[kind] : "unknown";
+}
+
+#endif // CLINIC_TRACE_H
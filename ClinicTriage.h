@@ -0,0 +1,140 @@
+#ifndef CLINIC_TRIAGE_H
+#define CLINIC_TRIAGE_H
+
+// Сортировка пациентов по срочности (--triage). Каждый пациент получает
+// уровень срочности: urgent, normal или low. Доли срочных и несрочных
+// задаются в процентах (--triage=urgent=10,low=30), остальные - обычные;
+// уровень, как и направление к специалисту, зависит только от сида и номера
+// пациента.
+//
+// TriageQueue - многоуровневая очередь: по FIFO-очереди на уровень. Из
+// очереди первым выходит пациент с наименьшим "виртуальным временем прихода"
+// since + level * aging: каждый уровень ниже urgent как будто приходит на
+// aging позже. Поэтому срочные пациенты обгоняют остальных, но пациент,
+// прождавший дольше aging, обгоняет пришедшего позже более срочного, и
+// несрочные не голодают (aging). С aging = 0 уровни строгие. Без --triage все
+// пациенты обычные, и очередь ведет себя как прежняя FIFO std::queue.
+// Очередь не потокобезопасна сама по себе: ее защищает тот же мьютекс, что и
+// прежнюю std::queue. Выбор - просмотр голов трех очередей, O(1).
+
+#include <cstdint> // Подключаем целые фиксированного размера
+#include <cstdio>  // Подключаем fprintf
+#include <deque>   // Подключаем std::deque
+#include <string>  // Подключаем std::string
+
+#include "ClinicWorkload.h" // Подключаем разбор параметров и Philox
+
+enum TriageLevel {
+  TRIAGE_URGENT = 0, // Срочный пациент
+  TRIAGE_NORMAL = 1, // Обычный пациент (по умолчанию)
+  TRIAGE_LOW = 2     // Несрочный пациент
+};
+
+const int TRIAGE_LEVELS = 3; // Число уровней срочности
+const char *const TRIAGE_NAMES[TRIAGE_LEVELS] = {"urgent", "normal",
+                                                 "low"}; // Названия уровней
+
+// Номер потока случайных чисел пациента для уровня срочности
+const int WORKLOAD_STREAM_TRIAGE = 17;
+
+// Доли уровней срочности (проценты)
+struct TriageMix {
+  double urgent_pct = 0; // Срочных пациентов
+  double low_pct = 0;    // Несрочных пациентов
+  std::string text;      // Исходная строка (для лога)
+};
+
+// Разбор строки --triage: "urgent=10,low=30"
+inline bool triage_parse(const char *text, TriageMix *mix) {
+  TriageMix result; // Разобранные доли
+  result.text = text;
+  if (!workload_parse_params(text, [&](const std::string &key, double v) {
+        if (key == "urgent" && v >= 0 && v <= 100) {
+          result.urgent_pct = v;
+        } else if (key == "low" && v >= 0 && v <= 100) {
+          result.low_pct = v;
+        } else {
+          return false;
+        }
+        return true;
+      })) {
+    return false;
+  }
+  if (result.urgent_pct + result.low_pct > 100) {
+    fprintf(stderr, "Triage shares exceed 100%%: %s\n", text);
+    return false;
+  }
+  *mix = result;
+  return true;
+}
+
+// Включена ли сортировка
+inline bool triage_enabled(const TriageMix &mix) {
+  return mix.urgent_pct > 0 || mix.low_pct > 0;
+}
+
+// Уровень срочности пациента pid
+inline TriageLevel triage_level(const TriageMix &mix, unsigned seed, int pid) {
+  if (!triage_enabled(mix)) {
+    return TRIAGE_NORMAL; // Все пациенты обычные
+  }
+  double u = (workload_random(seed, pid, WORKLOAD_STREAM_TRIAGE, 0) >> 11) *
+             (100.0 / 9007199254740992.0); // Равномерное число из [0, 100)
+  if (u < mix.urgent_pct) {
+    return TRIAGE_URGENT;
+  }
+  return u < mix.urgent_pct + mix.low_pct ? TRIAGE_LOW : TRIAGE_NORMAL;
+}
+
+template <typename T> class TriageQueue {
+public:
+  TriageQueue() : aging_(0), size_(0) {}
+
+  // Время (в единицах since), за которое уровень поднимается на один
+  void set_aging(uint64_t aging) { aging_ = aging; }
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  // Постановка в очередь уровня level; since - время постановки
+  void push(T item, int level, uint64_t since) {
+    Entry e = {item, since};
+    levels_[level].push_back(e);
+    size_++;
+  }
+
+  // Извлечение следующего по срочности с учетом ожидания (очередь не пуста)
+  T pop() {
+    int best = -1;         // Уровень, из которого берем
+    uint64_t best_key = 0; // Его виртуальное время прихода
+    for (int level = 0; level < TRIAGE_LEVELS; level++) {
+      if (levels_[level].empty()) {
+        continue;
+      }
+      if (aging_ == 0) { // Строгие уровни: первый непустой
+        best = level;
+        break;
+      }
+      uint64_t key = levels_[level].front().since + level * aging_;
+      if (best < 0 || key < best_key) { // При равенстве - более срочный
+        best = level;
+        best_key = key;
+      }
+    }
+    T item = levels_[best].front().item;
+    levels_[best].pop_front();
+    size_--;
+    return item;
+  }
+
+private:
+  struct Entry {
+    T item;         // Элемент очереди
+    uint64_t since; // Время постановки
+  };
+  std::deque<Entry> levels_[TRIAGE_LEVELS]; // FIFO-очереди уровней
+  uint64_t aging_;                           // Шаг старения уровней
+  size_t size_;                              // Элементов во всех уровнях
+};
+
+#endif // CLINIC_TRIAGE_H
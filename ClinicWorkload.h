@@ -0,0 +1,451 @@
+#ifndef CLINIC_WORKLOAD_H
+#define CLINIC_WORKLOAD_H
+
+// Генератор потока пациентов (-arrival). По умолчанию (all) все N пациентов
+// приходят одновременно в начале дня. Открытый поток задается строкой:
+//   poisson:rate=<в секунду>[,seed=<число>] - пуассоновский поток, интервалы
+//                                              между приходами экспоненциальны
+//   burst:size=<k>,every=<мс>                - волны по k пациентов каждые
+//                                              every мс
+//   trace:<файл>                             - моменты прихода из файла
+// Файл трассы прихода содержит по одному времени (мс от начала дня, можно
+// дробное) в строке; пустые строки и строки с '#' пропускаются. Число
+// пациентов в этом режиме равно числу строк.
+// Расписание строится заранее, до начала дня, отдельным генератором, так что
+// оно не сдвигает последовательность направлений к специалистам.
+//
+// Здесь же распределения времени приема (-service <этап>=<распределение>).
+// Этап - duty, dentist, surgeon, therapist или specialist (все три типа).
+// Распределения:
+//   const                                 - ровно t_d / t_s (по умолчанию)
+//   exp[:mean=<мс>][,seed=<n>]            - экспоненциальное
+//   lognormal[:mean=<мс>][,sigma=<s>][,seed=<n>] - логнормальное
+//   empirical:<файл>[,seed=<n>]           - гистограмма из файла: в каждой
+//                                           строке "время_мс [вес]"
+// Без mean среднее равно t_d / t_s. Время приема пациента зависит только от
+// сида, номера пациента и этапа, а не от порядка, в котором потоки врачей
+// берут пациентов, поэтому день воспроизводится при любом планировании.
+// Так же, через счетчиковый генератор Philox, выбирается специалист, к
+// которому дежурный врач направляет пациента (--seed).
+
+#include <algorithm> // Подключаем std::sort, std::upper_bound
+#include <cmath>     // Подключаем log, exp, sqrt, cos
+#include <cstdint>   // Подключаем целые фиксированного размера
+#include <cstdio>    // Подключаем fprintf
+#include <cstdlib>   // Подключаем strtod
+#include <cstring>   // Подключаем strspn
+#include <fstream>   // Подключаем std::ifstream
+#include <random>    // Подключаем std::mt19937 и распределения
+#include <string>    // Подключаем std::string
+#include <vector>    // Подключаем std::vector
+
+enum ArrivalKind {
+  ARRIVAL_ALL = 0,     // Все пациенты сразу (по умолчанию)
+  ARRIVAL_POISSON = 1, // Пуассоновский поток
+  ARRIVAL_BURST = 2,   // Волны пациентов
+  ARRIVAL_TRACE = 3    // Моменты прихода из файла
+};
+
+struct ArrivalSpec {
+  ArrivalKind kind = ARRIVAL_ALL; // Вид потока
+  double rate = 0;                // poisson: пациентов в секунду
+  unsigned seed = 1;              // poisson: сид генератора интервалов
+  int burst_size = 0;             // burst: пациентов в волне
+  double burst_every_ms = 0;      // burst: интервал между волнами (мс)
+  std::string trace_file;         // trace: файл с моментами прихода
+  std::string text = "all";       // Исходная строка (для лога)
+};
+
+// Разбор параметров вида "key=value,key=value"; on_param возвращает false
+// для неизвестного ключа или неверного значения
+template <typename F>
+bool workload_parse_params(const std::string &text, F on_param) {
+  size_t pos = 0; // Начало очередного параметра
+  while (pos < text.size()) {
+    size_t end = text.find(',', pos); // Конец параметра
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+    std::string item = text.substr(pos, end - pos); // Параметр "ключ=число"
+    size_t eq = item.find('=');
+    if (eq == std::string::npos) {
+      fprintf(stderr, "Bad parameter: %s\n", item.c_str());
+      return false;
+    }
+    char *tail = NULL; // Конец разобранного числа
+    double value = strtod(item.c_str() + eq + 1, &tail);
+    if (*tail != '\0' || !on_param(item.substr(0, eq), value)) {
+      fprintf(stderr, "Bad parameter: %s\n", item.c_str());
+      return false;
+    }
+    pos = end + 1; // Переходим к следующему параметру
+  }
+  return true;
+}
+
+// Разбор строки -arrival
+inline bool arrival_parse(const char *text, ArrivalSpec *spec) {
+  std::string s = text;          // Строка для разбора
+  size_t colon = s.find(':');    // Конец названия вида потока
+  std::string kind = s.substr(0, colon);
+  std::string params = colon == std::string::npos ? "" : s.substr(colon + 1);
+  ArrivalSpec result;            // Разобранный поток
+  result.text = s;
+  if (kind == "all" && params.empty()) {
+    result.kind = ARRIVAL_ALL;
+  } else if (kind == "poisson") {
+    result.kind = ARRIVAL_POISSON;
+    if (!workload_parse_params(params, [&](const std::string &key, double v) {
+          if (key == "rate" && v > 0) {
+            result.rate = v;
+          } else if (key == "seed" && v >= 0) {
+            result.seed = (unsigned)v;
+          } else {
+            return false;
+          }
+          return true;
+        })) {
+      return false;
+    }
+    if (result.rate <= 0) {
+      fprintf(stderr, "Poisson arrivals need rate=<patients per second>\n");
+      return false;
+    }
+  } else if (kind == "burst") {
+    result.kind = ARRIVAL_BURST;
+    if (!workload_parse_params(params, [&](const std::string &key, double v) {
+          if (key == "size" && v >= 1) {
+            result.burst_size = (int)v;
+          } else if (key == "every" && v >= 0) {
+            result.burst_every_ms = v;
+          } else {
+            return false;
+          }
+          return true;
+        })) {
+      return false;
+    }
+    if (result.burst_size < 1) {
+      fprintf(stderr, "Burst arrivals need size=<patients per burst>\n");
+      return false;
+    }
+  } else if (kind == "trace" && !params.empty()) {
+    result.kind = ARRIVAL_TRACE;
+    result.trace_file = params;
+  } else {
+    fprintf(stderr, "Unknown arrival process: %s\n", text);
+    return false;
+  }
+  *spec = result;
+  return true;
+}
+
+// Расписание прихода: times_us[i] - момент прихода пациента i + 1 (мкс от
+// начала дня), по возрастанию. Для trace число пациентов *n берется из файла.
+inline bool arrival_schedule(const ArrivalSpec &spec, int *n,
+                             std::vector<uint64_t> *times_us) {
+  times_us->clear();
+  if (spec.kind == ARRIVAL_TRACE) {
+    std::ifstream fin(spec.trace_file.c_str()); // Файл моментов прихода
+    if (!fin) {
+      fprintf(stderr, "Failed to open arrival trace %s\n",
+              spec.trace_file.c_str());
+      return false;
+    }
+    std::string line; // Строка файла
+    while (std::getline(fin, line)) {
+      if (line.find_first_not_of(" \t\r") == std::string::npos ||
+          line[line.find_first_not_of(" \t\r")] == '#') {
+        continue; // Пустая строка или комментарий
+      }
+      char *tail = NULL; // Конец разобранного числа
+      double ms = strtod(line.c_str(), &tail);
+      if (tail == line.c_str() || ms < 0) {
+        fprintf(stderr, "Bad arrival time: %s\n", line.c_str());
+        return false;
+      }
+      times_us->push_back((uint64_t)(ms * 1000 + 0.5));
+    }
+    std::sort(times_us->begin(), times_us->end()); // По возрастанию
+    *n = (int)times_us->size();
+    return true;
+  }
+
+  times_us->reserve(*n);
+  std::mt19937 gen(spec.seed); // Генератор интервалов (poisson)
+  std::exponential_distribution<double> gap(spec.rate > 0 ? spec.rate : 1);
+  double t_s = 0; // Текущий момент прихода (с)
+  for (int i = 0; i < *n; i++) {
+    switch (spec.kind) {
+    case ARRIVAL_ALL:
+      times_us->push_back(0); // Все приходят сразу
+      break;
+    case ARRIVAL_POISSON:
+      t_s += gap(gen); // Экспоненциальный интервал
+      times_us->push_back((uint64_t)(t_s * 1e6 + 0.5));
+      break;
+    case ARRIVAL_BURST:
+      times_us->push_back(
+          (uint64_t)((i / spec.burst_size) * spec.burst_every_ms * 1000 + 0.5));
+      break;
+    case ARRIVAL_TRACE:
+      break;
+    }
+  }
+  return true;
+}
+
+// Этапы приема для -service: типы специалистов совпадают с SpecialistType
+const int SERVICE_DUTY = 3;   // Прием у дежурного врача
+const int SERVICE_STAGES = 4; // Стоматолог, хирург, терапевт, дежурный
+
+enum ServiceKind {
+  SERVICE_CONST = 0,     // Постоянное время (по умолчанию)
+  SERVICE_EXP = 1,       // Экспоненциальное распределение
+  SERVICE_LOGNORMAL = 2, // Логнормальное распределение
+  SERVICE_EMPIRICAL = 3  // Гистограмма из файла
+};
+
+struct ServiceDist {
+  ServiceKind kind = SERVICE_CONST; // Вид распределения
+  double mean_ms = -1;              // Среднее (мс, < 0 - t_d / t_s)
+  double sigma = 0.5;               // lognormal: sigma логарифма
+  unsigned seed = 1;                // Сид выборки
+  std::vector<double> values;       // empirical: значения (мс)
+  std::vector<double> cdf;          // empirical: накопленные доли весов
+  std::string text = "const";       // Исходная строка (для лога)
+};
+
+// Счетчиковый генератор Philox4x32-10 (Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3"). Выход - функция только от счетчика и ключа,
+// без внутреннего состояния: поток случайных чисел с ключом (сид, пациент)
+// можно читать с любого места из любого потока без блокировок.
+struct PhiloxBlock {
+  uint32_t v[4]; // Четыре 32-битных случайных слова
+};
+
+inline PhiloxBlock philox4x32(const uint32_t ctr[4], const uint32_t key[2]) {
+  uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+  uint32_t k0 = key[0], k1 = key[1];
+  for (int round = 0; round < 10; round++) {
+    uint64_t p0 = (uint64_t)0xD2511F53u * c0; // Произведения раунда
+    uint64_t p1 = (uint64_t)0xCD9E8D57u * c2;
+    uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+    uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+    c1 = (uint32_t)p1;
+    c3 = (uint32_t)p0;
+    c0 = n0;
+    c2 = n2;
+    k0 += 0x9E3779B9u; // Сдвиг ключа (константы Вейля)
+    k1 += 0xBB67AE85u;
+  }
+  PhiloxBlock out = {{c0, c1, c2, c3}};
+  return out;
+}
+
+// Номера потоков случайных чисел пациента: этапы приема 0..SERVICE_STAGES-1,
+// дальше - выбор специалиста
+const int WORKLOAD_STREAM_REFERRAL = 16;
+
+// Случайное 64-битное число по ключу (сид, пациент) и счетчику (поток, номер
+// выборки)
+inline uint64_t workload_random(unsigned seed, int pid, int stream,
+                                int draw) {
+  const uint32_t ctr[4] = {(uint32_t)pid, (uint32_t)stream, (uint32_t)draw,
+                           0};
+  const uint32_t key[2] = {(uint32_t)seed, 0x436C6E63u}; // "Clnc"
+  PhiloxBlock b = philox4x32(ctr, key);
+  return ((uint64_t)b.v[0] << 32) | b.v[1];
+}
+
+// Равномерное число из (0, 1) по ключу (сид, пациент, этап, номер выборки)
+inline double workload_uniform(unsigned seed, int pid, int stage, int draw) {
+  uint64_t r = workload_random(seed, pid, stage, draw);
+  return ((r >> 11) + 0.5) * (1.0 / 9007199254740992.0); // 53 бита
+}
+
+// Направление пациента к специалисту (0..kinds-1): зависит только от сида и
+// номера пациента, а не от того, какой врач и когда его принял
+inline int workload_referral(unsigned seed, int pid, int kinds) {
+  uint32_t r = (uint32_t)(workload_random(seed, pid,
+                                          WORKLOAD_STREAM_REFERRAL, 0) >> 32);
+  return (int)(((uint64_t)r * (uint64_t)kinds) >> 32); // Без деления
+}
+
+// Чтение гистограммы времени приема: "время_мс [вес]" в строке
+inline bool service_load_empirical(const std::string &path, ServiceDist *d) {
+  std::ifstream fin(path.c_str()); // Файл гистограммы
+  if (!fin) {
+    fprintf(stderr, "Failed to open service time histogram %s\n",
+            path.c_str());
+    return false;
+  }
+  double total = 0; // Сумма весов
+  std::string line; // Строка файла
+  while (std::getline(fin, line)) {
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#') {
+      continue; // Пустая строка или комментарий
+    }
+    char *tail = NULL; // Конец разобранного числа
+    double value = strtod(line.c_str(), &tail);
+    double weight = 1;  // Вес значения (по умолчанию 1)
+    if (tail != line.c_str() && tail[strspn(tail, " \t\r")] != '\0') {
+      char *wtail = NULL;
+      weight = strtod(tail, &wtail);
+      if (wtail == tail) {
+        weight = -1; // Вес не разобран
+      }
+    }
+    if (tail == line.c_str() || value < 0 || weight < 0) {
+      fprintf(stderr, "Bad service time entry: %s\n", line.c_str());
+      return false;
+    }
+    total += weight;
+    d->values.push_back(value);
+    d->cdf.push_back(total);
+  }
+  if (total <= 0) {
+    fprintf(stderr, "Service time histogram %s is empty\n", path.c_str());
+    return false;
+  }
+  for (size_t i = 0; i < d->cdf.size(); i++) {
+    d->cdf[i] /= total; // Нормируем накопленные веса
+  }
+  return true;
+}
+
+// Разбор распределения: "exp:mean=1000", "empirical:times.txt,seed=3"
+inline bool service_parse(const std::string &text, ServiceDist *dist) {
+  size_t colon = text.find(':'); // Конец названия распределения
+  std::string kind = text.substr(0, colon);
+  std::string params = colon == std::string::npos ? "" : text.substr(colon + 1);
+  ServiceDist result; // Разобранное распределение
+  result.text = text;
+  auto on_param = [&](const std::string &key, double v) {
+    if (key == "mean" && v >= 0) {
+      result.mean_ms = v;
+    } else if (key == "sigma" && v >= 0 && result.kind == SERVICE_LOGNORMAL) {
+      result.sigma = v;
+    } else if (key == "seed" && v >= 0) {
+      result.seed = (unsigned)v;
+    } else {
+      return false;
+    }
+    return true;
+  };
+  if (kind == "const" && params.empty()) {
+    result.kind = SERVICE_CONST;
+  } else if (kind == "exp" || kind == "lognormal") {
+    result.kind = kind == "exp" ? SERVICE_EXP : SERVICE_LOGNORMAL;
+    if (!workload_parse_params(params, on_param)) {
+      return false;
+    }
+  } else if (kind == "empirical" && !params.empty()) {
+    result.kind = SERVICE_EMPIRICAL;
+    size_t comma = params.find(',');    // Файл, затем необязательный сид
+    if (comma != std::string::npos &&
+        !workload_parse_params(params.substr(comma + 1),
+                              [&](const std::string &key, double v) {
+                                if (key == "seed" && v >= 0) {
+                                  result.seed = (unsigned)v;
+                                  return true;
+                                }
+                                return false;
+                              })) {
+      return false;
+    }
+    if (!service_load_empirical(params.substr(0, comma), &result)) {
+      return false;
+    }
+  } else {
+    fprintf(stderr, "Unknown service time distribution: %s\n", text.c_str());
+    return false;
+  }
+  *dist = result;
+  return true;
+}
+
+// Разбор "-service <этап>=<распределение>" в массив по этапам
+inline bool service_parse_assignment(const char *text,
+                                     ServiceDist dists[SERVICE_STAGES]) {
+  std::string s = text;       // Строка для разбора
+  size_t eq = s.find('=');    // Конец названия этапа
+  if (eq == std::string::npos) {
+    fprintf(stderr, "Bad service time option: %s\n", text);
+    return false;
+  }
+  std::string stage = s.substr(0, eq);
+  ServiceDist dist; // Распределение этапа
+  if (!service_parse(s.substr(eq + 1), &dist)) {
+    return false;
+  }
+  if (stage == "dentist") {
+    dists[0] = dist;
+  } else if (stage == "surgeon") {
+    dists[1] = dist;
+  } else if (stage == "therapist") {
+    dists[2] = dist;
+  } else if (stage == "specialist") {
+    dists[0] = dists[1] = dists[2] = dist; // Все типы специалистов
+  } else if (stage == "duty") {
+    dists[SERVICE_DUTY] = dist;
+  } else {
+    fprintf(stderr, "Unknown service stage: %s\n", stage.c_str());
+    return false;
+  }
+  return true;
+}
+
+// Время приема пациента pid на этапе stage (мс); base_ms - t_d или t_s
+inline double service_sample(const ServiceDist &d, double base_ms, int pid,
+                             int stage) {
+  double mean = d.mean_ms >= 0 ? d.mean_ms : base_ms; // Среднее время
+  switch (d.kind) {
+  case SERVICE_CONST:
+    return mean;
+  case SERVICE_EXP:
+    return -mean * log(workload_uniform(d.seed, pid, stage, 0));
+  case SERVICE_LOGNORMAL: {
+    double u1 = workload_uniform(d.seed, pid, stage, 0); // Бокс - Мюллер
+    double u2 = workload_uniform(d.seed, pid, stage, 1);
+    double z = sqrt(-2 * log(u1)) * cos(6.283185307179586 * u2); // N(0, 1)
+    double mu = log(mean > 0 ? mean : 1e-9) - d.sigma * d.sigma / 2;
+    return mean > 0 ? exp(mu + d.sigma * z) : 0; // Среднее равно mean
+  }
+  case SERVICE_EMPIRICAL: {
+    double u = workload_uniform(d.seed, pid, stage, 0);
+    size_t i = std::upper_bound(d.cdf.begin(), d.cdf.end(), u) - d.cdf.begin();
+    return d.values[i < d.values.size() ? i : d.values.size() - 1];
+  }
+  }
+  return mean;
+}
+
+// Среднее время приема на этапе (мс) - оценка для политик направления
+inline double service_mean(const ServiceDist &d, double base_ms) {
+  if (d.kind != SERVICE_EMPIRICAL) {
+    return d.mean_ms >= 0 ? d.mean_ms : base_ms; // Задано явно или t_d / t_s
+  }
+  double mean = 0, prev = 0; // Сумма значений по весам, прошлая доля
+  for (size_t i = 0; i < d.values.size(); i++) {
+    mean += d.values[i] * (d.cdf[i] - prev);
+    prev = d.cdf[i];
+  }
+  return mean;
+}
+
+// Описание распределений для лога; пусто, если все времена постоянные
+inline std::string service_describe(const ServiceDist dists[SERVICE_STAGES]) {
+  bool custom = false; // Задано ли хоть одно распределение
+  for (int i = 0; i < SERVICE_STAGES; i++) {
+    custom = custom || dists[i].kind != SERVICE_CONST;
+  }
+  if (!custom) {
+    return "";
+  }
+  return "duty=" + dists[SERVICE_DUTY].text + ", dentist=" + dists[0].text +
+         ", surgeon=" + dists[1].text + ", therapist=" + dists[2].text;
+}
+
+#endif // CLINIC_WORKLOAD_H
@@ -0,0 +1,280 @@
+// Утилита clinic-bench: запускает одну из программ клиники с заданными
+// параметрами несколько раз и дописывает в CSV время работы (wall), время
+// процессора и переключения контекста из getrusage (wait4), пиковую память и
+// пропускную способность в пациентах в секунду. С --locks программа
+// запускается с --stats=on и логом во временный файл, из которого берется
+// число захватов мьютексов очередей и сигналов на пациента.
+// Сборка: g++ -O2 -o clinic-bench bench/ClinicBench.cpp
+
+#include <cerrno>        // Подключаем errno
+#include <csignal>       // Подключаем kill() и SIGKILL
+#include <cstdio>        // Подключаем printf, fopen
+#include <cstdlib>       // Подключаем atoi, atof
+#include <cstring>       // Подключаем strcmp
+#include <ctime>         // Подключаем clock_gettime
+#include <fcntl.h>       // Подключаем open()
+#include <string>        // Подключаем std::string
+#include <sys/resource.h> // Подключаем struct rusage
+#include <sys/stat.h>    // Подключаем stat()
+#include <sys/wait.h>    // Подключаем wait4()
+#include <unistd.h>      // Подключаем fork(), execv()
+#include <vector>        // Подключаем std::vector
+
+// Параметры запуска
+std::string csv_filename = "bench/results.csv"; // Файл результатов
+std::string label;        // Имя варианта программы в CSV
+std::string program;      // Путь к программе
+int N = 500;              // Число пациентов
+int t_d = 5;              // Время приема дежурного врача (мс)
+int t_s = 10;             // Время приема специалиста (мс)
+int duty = 2;             // Число дежурных врачей
+std::string specialists = "dentist=1,surgeon=1,therapist=1"; // Специалисты
+int repeat = 3;           // Число повторов
+double timeout_s = 300;   // Предельное время одного запуска (с)
+bool locks = false;       // Собирать ли счетчики захватов мьютексов
+std::vector<std::string> extra; // Дополнительные аргументы программы
+
+// Результат одного запуска
+struct RunResult {
+  int exit_code;    // Код завершения (-1 - убит по таймауту или сигналом)
+  double wall_s;    // Время работы (с)
+  double user_s;    // Время процессора в режиме пользователя (с)
+  double sys_s;     // Время процессора в режиме ядра (с)
+  long vol_cs;      // Добровольные переключения контекста
+  long invol_cs;    // Принудительные переключения контекста
+  long max_rss_kb;  // Пиковая резидентная память (КБ)
+  double locks_pp;  // Захватов мьютексов на пациента (-1 - нет данных)
+  double sigs_pp;   // Сигналов условных переменных на пациента
+};
+
+// Функция отображения справки
+void print_help() {
+  printf("Usage: clinic-bench [options] [-- extra program args]\n"
+         "Options:\n"
+         "  --program <path>   Clinic program to run (required)\n"
+         "  --label <name>     Variant name written to the CSV\n"
+         "  --csv <file>       Append results to this CSV file\n"
+         "  --n <number>       Number of patients (default 500)\n"
+         "  --t_d <ms>         Duty doctor time (default 5)\n"
+         "  --t_s <ms>         Specialist time (default 10)\n"
+         "  --duty <count>     Number of duty doctors (default 2)\n"
+         "  --specialists <list>\n"
+         "                     Specialists per specialty, passed as -s\n"
+         "  --repeat <count>   Runs per configuration (default 3)\n"
+         "  --timeout <s>      Kill a run after this many seconds\n"
+         "  --locks            Record queue lock acquisitions and signals\n"
+         "                     per patient (runs with --stats=on)\n"
+         "  --help [-h]        Display this help message\n");
+}
+
+// Разбор командной строки
+bool parse_args(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      print_help();
+      exit(0);
+    } else if (strcmp(argv[i], "--") == 0) {
+      for (i++; i < argc; i++) {
+        extra.push_back(argv[i]); // Все остальное - аргументы программы
+      }
+    } else if (strcmp(argv[i], "--locks") == 0) {
+      locks = true;
+    } else if (i + 1 >= argc) {
+      fprintf(stderr, "Missing value for %s\n", argv[i]);
+      return false;
+    } else if (strcmp(argv[i], "--program") == 0) {
+      program = argv[++i];
+    } else if (strcmp(argv[i], "--label") == 0) {
+      label = argv[++i];
+    } else if (strcmp(argv[i], "--csv") == 0) {
+      csv_filename = argv[++i];
+    } else if (strcmp(argv[i], "--n") == 0) {
+      N = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--t_d") == 0) {
+      t_d = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--t_s") == 0) {
+      t_s = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--duty") == 0) {
+      duty = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--specialists") == 0) {
+      specialists = argv[++i];
+    } else if (strcmp(argv[i], "--repeat") == 0) {
+      repeat = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--timeout") == 0) {
+      timeout_s = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (program.empty()) {
+    fprintf(stderr, "--program is required\n");
+    return false;
+  }
+  if (label.empty()) {
+    label = program; // По умолчанию вариант называется по программе
+  }
+  return true;
+}
+
+// Текущее время по монотонным часам (с)
+double now_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Чтение счетчиков "queue locks per patient" из лога программы
+void read_lock_counters(const char *log_path, RunResult *r) {
+  FILE *log = fopen(log_path, "r");
+  if (!log) {
+    return;
+  }
+  char line[512];
+  while (fgets(line, sizeof(line), log)) {
+    const char *at = strstr(line, "queue locks per patient:");
+    if (at) {
+      sscanf(at, "queue locks per patient: acquisitions=%lf signals=%lf",
+             &r->locks_pp, &r->sigs_pp);
+    }
+  }
+  fclose(log);
+}
+
+// Один запуск программы: fork + execv, ожидание через wait4 с учетом таймаута
+RunResult run_once() {
+  char log_path[] = "/tmp/clinic-bench-XXXXXX"; // Лог для --locks
+  if (locks) {
+    int fd = mkstemp(log_path);
+    if (fd < 0) {
+      perror("mkstemp");
+      locks = false;
+    } else {
+      close(fd);
+    }
+  }
+  std::vector<std::string> args = {program,
+                                   "-n",
+                                   std::to_string(N),
+                                   "-t_d",
+                                   std::to_string(t_d),
+                                   "-t_s",
+                                   std::to_string(t_s),
+                                   "-d",
+                                   std::to_string(duty),
+                                   "-s",
+                                   specialists,
+                                   "-o",
+                                   locks ? log_path : "/dev/null",
+                                   "--console=off"};
+  if (locks) {
+    args.push_back("--stats=on"); // Счетчики печатаются в отчете --stats
+  }
+  args.insert(args.end(), extra.begin(), extra.end());
+  std::vector<char *> argv; // Аргументы для execv
+  for (size_t i = 0; i < args.size(); i++) {
+    argv.push_back((char *)args[i].c_str());
+  }
+  argv.push_back(NULL);
+
+  RunResult r = {-1, 0, 0, 0, 0, 0, 0, -1, -1};
+  double start = now_s(); // Время запуска
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    return r;
+  }
+  if (pid == 0) { // Дочерний процесс: вывод программы не нужен
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+      dup2(devnull, STDOUT_FILENO);
+      close(devnull);
+    }
+    execv(program.c_str(), argv.data());
+    perror("execv"); // Сюда попадаем только при ошибке запуска
+    _exit(127);
+  }
+
+  int status = 0;
+  struct rusage usage;
+  bool killed = false; // Убили ли программу по таймауту
+  while (true) {
+    pid_t done = wait4(pid, &status, WNOHANG, &usage); // Проверяем завершение
+    if (done == pid) {
+      break;
+    }
+    if (done < 0 && errno != EINTR) {
+      perror("wait4");
+      return r;
+    }
+    if (!killed && now_s() - start > timeout_s) { // Программа зависла
+      kill(pid, SIGKILL);
+      killed = true;
+    }
+    usleep(200); // Ждем, не нагружая процессор
+  }
+  r.wall_s = now_s() - start;
+  r.user_s = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+  r.sys_s = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+  r.vol_cs = usage.ru_nvcsw;
+  r.invol_cs = usage.ru_nivcsw;
+  r.max_rss_kb = usage.ru_maxrss;
+  r.exit_code = (!killed && WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+  if (locks) {
+    read_lock_counters(log_path, &r);
+    unlink(log_path);
+  }
+  return r;
+}
+
+int main(int argc, char **argv) {
+  if (!parse_args(argc, argv)) {
+    print_help();
+    return 1;
+  }
+
+  struct stat st;
+  bool need_header = stat(csv_filename.c_str(), &st) != 0 || st.st_size == 0;
+  FILE *csv = fopen(csv_filename.c_str(), "a"); // Дописываем к результатам
+  if (!csv) {
+    perror("Failed to open CSV file");
+    return 1;
+  }
+  if (need_header) {
+    fprintf(csv, "variant,n,t_d,t_s,duty,specialists,extra,run,exit_code,"
+                 "wall_s,user_s,sys_s,cpu_s,vol_cs,invol_cs,max_rss_kb,"
+                 "patients_per_s,locks_per_patient,signals_per_patient\n");
+  }
+  std::string extra_text; // Дополнительные аргументы одной строкой
+  for (size_t i = 0; i < extra.size(); i++) {
+    extra_text += (i ? " " : "") + extra[i];
+  }
+
+  int failures = 0; // Число неудачных запусков
+  for (int run = 1; run <= repeat; run++) {
+    RunResult r = run_once();
+    if (r.exit_code != 0) {
+      failures++;
+    }
+    double cpu = r.user_s + r.sys_s; // Общее время процессора
+    fprintf(csv,
+            "%s,%d,%d,%d,%d,\"%s\",\"%s\",%d,%d,%.4f,%.4f,%.4f,%.4f,%ld,%ld,"
+            "%ld,%.2f,",
+            label.c_str(), N, t_d, t_s, duty, specialists.c_str(),
+            extra_text.c_str(), run, r.exit_code, r.wall_s, r.user_s, r.sys_s,
+            cpu, r.vol_cs, r.invol_cs, r.max_rss_kb,
+            r.wall_s > 0 ? N / r.wall_s : 0.0);
+    if (r.locks_pp >= 0) { // Счетчики есть только у --queue=mutex
+      fprintf(csv, "%.2f,%.2f\n", r.locks_pp, r.sigs_pp);
+    } else {
+      fprintf(csv, ",\n");
+    }
+    fflush(csv);
+    printf("%-8s n=%-6d t_d=%-4d t_s=%-4d duty=%-3d run %d: %.3f s wall, "
+           "%.3f s cpu, %ld/%ld cs, exit %d\n",
+           label.c_str(), N, t_d, t_s, duty, run, r.wall_s, cpu, r.vol_cs,
+           r.invol_cs, r.exit_code);
+  }
+  fclose(csv);
+  return failures == 0 ? 0 : 2;
+}
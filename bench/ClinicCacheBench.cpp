@@ -0,0 +1,320 @@
+// Утилита clinic-cache-bench: сравнивает раскладку состояния очередей к
+// специалистам в памяти:
+//   packed - прежние глобальные массивы: specialistQueue[3], specialistLock[3],
+//            specialistNotEmpty[3] и счетчики нагрузки [3] подряд, так что
+//            мьютексы и счетчики разных типов делят кэш-линии
+//   desk   - блоки QueueDesk из ClinicDesk.h, каждый на своих кэш-линиях
+// Каждый из --threads потоков работает со своим типом специалиста (поток i -
+// тип i % 3) и --rounds раз проходит путь пациента через очередь: захват
+// мьютекса, постановка и извлечение, освобождение, счетчики очереди, приема
+// и направлений. При потоке на тип общих данных у потоков нет, и все промахи
+// кэша между ними - ложное разделение.
+// Промахи считаются через perf_event_open в каждом потоке: промахи L1D на
+// чтение, промахи последнего уровня кэша и, если задан --raw, сырое событие
+// процессора - например, загрузки, попавшие в измененную линию чужого ядра
+// (HITM; код события свой у каждой модели, см. perf list). Если счетчики
+// недоступны (perf_event_paranoid, контейнер, виртуальная машина), печатается
+// n/a, а разница видна по времени и по числу общих кэш-линий, которое
+// считается по адресам полей. Подробный разбор HITM по адресам - perf c2c.
+// Сборка: g++ -O2 -pthread -o clinic-cache-bench bench/ClinicCacheBench.cpp
+
+#include <atomic>    // Подключаем атомарные операции (std::atomic)
+#include <cerrno>    // Подключаем errno
+#include <cstdint>   // Подключаем целые фиксированного размера
+#include <cstdio>    // Подключаем printf
+#include <cstdlib>   // Подключаем atoi, strtoull
+#include <cstring>   // Подключаем strcmp, strerror
+#include <ctime>     // Подключаем clock_gettime
+#include <pthread.h> // Подключаем pthread_mutex_t, pthread_create
+#include <set>       // Подключаем std::set
+#include <vector>    // Подключаем std::vector
+
+#if defined(__linux__)
+#include <linux/perf_event.h> // Подключаем perf_event_attr
+#include <sys/ioctl.h>        // Подключаем ioctl
+#include <sys/syscall.h>      // Подключаем SYS_perf_event_open
+#include <unistd.h>           // Подключаем syscall, read, close
+#endif
+
+#include "../ClinicDesk.h" // Подключаем QueueDesk
+
+int rounds = 1000000;     // Проходов пациента на поток
+int threads = 3;          // Рабочих потоков
+bool raw_enabled = false; // Считать ли сырое событие
+uint64_t raw_config = 0;  // Код сырого события (--raw)
+
+// Прежняя раскладка: поля одного типа в соседних массивах
+struct PackedState {
+  TriageQueue<int> queue[3];
+  pthread_mutex_t lock[3];
+  pthread_cond_t notEmpty[3];
+  std::atomic<int> queued[3];
+  std::atomic<int> queuedPeak[3];
+  std::atomic<int> busy[3];
+  std::atomic<int> referrals[3];
+
+  PackedState() {
+    for (int i = 0; i < 3; i++) {
+      pthread_mutex_init(&lock[i], NULL);
+      pthread_cond_init(&notEmpty[i], NULL);
+      queued[i].store(0);
+      queuedPeak[i].store(0);
+      busy[i].store(0);
+      referrals[i].store(0);
+    }
+  }
+};
+
+PackedState packed;     // Как прежние глобальные переменные, в .bss
+QueueDesk<int> desk[3]; // Новая раскладка
+
+// Поля, которые трогает путь пациента одного типа
+struct HotFields {
+  TriageQueue<int> *queue;
+  pthread_mutex_t *lock;
+  std::atomic<int> *queued;
+  std::atomic<int> *busy;
+  std::atomic<int> *referrals;
+};
+
+HotFields packed_fields(int type) {
+  HotFields f = {&packed.queue[type], &packed.lock[type],
+                 &packed.queued[type], &packed.busy[type],
+                 &packed.referrals[type]};
+  return f;
+}
+
+HotFields desk_fields(int type) {
+  HotFields f = {&desk[type].queue, &desk[type].lock, &desk[type].queued,
+                 &desk[type].busy, &desk[type].referrals};
+  return f;
+}
+
+// Кэш-линии, которые трогают потоки двух и более разных типов
+template <typename Fields> int shared_lines(Fields fields) {
+  std::set<uintptr_t> seen[3]; // Линии каждого типа
+  for (int t = 0; t < 3; t++) {
+    HotFields f = fields(t);
+    const void *addr[5] = {f.queue, f.lock, f.queued, f.busy, f.referrals};
+    size_t size[5] = {sizeof(*f.queue), sizeof(*f.lock), sizeof(*f.queued),
+                      sizeof(*f.busy), sizeof(*f.referrals)};
+    for (int k = 0; k < 5; k++) {
+      uintptr_t first = (uintptr_t)addr[k] / CLINIC_CACHE_LINE;
+      uintptr_t last = ((uintptr_t)addr[k] + size[k] - 1) / CLINIC_CACHE_LINE;
+      for (uintptr_t line = first; line <= last; line++) {
+        seen[t].insert(line);
+      }
+    }
+  }
+  int shared = 0;
+  for (int t = 0; t < 3; t++) {
+    for (std::set<uintptr_t>::iterator it = seen[t].begin();
+         it != seen[t].end(); ++it) {
+      bool earlier = false; // Линия уже посчитана у предыдущего типа
+      for (int u = 0; u < t; u++) {
+        earlier = earlier || seen[u].count(*it) > 0;
+      }
+      bool later = false; // Линию трогает и следующий тип
+      for (int u = t + 1; u < 3; u++) {
+        later = later || seen[u].count(*it) > 0;
+      }
+      if (!earlier && later) {
+        shared++;
+      }
+    }
+  }
+  return shared;
+}
+
+// Функция отображения справки
+void print_help() {
+  printf("Usage: clinic-cache-bench [options]\n"
+         "Options:\n"
+         "  --rounds <count>   Patient passes per thread (default 1000000)\n"
+         "  --threads <count>  Worker threads, thread i uses specialty i %% 3\n"
+         "                     (default 3)\n"
+         "  --raw <hex>        Extra raw PMU event, e.g. a HITM event of\n"
+         "                     this CPU from perf list\n"
+         "  --help [-h]        Display this help message\n");
+}
+
+// Разбор командной строки
+bool parse_args(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      print_help();
+      exit(0);
+    } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--raw") == 0 && i + 1 < argc) {
+      raw_config = strtoull(argv[++i], NULL, 16);
+      raw_enabled = true;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (rounds < 1 || threads < 1) {
+    fprintf(stderr, "--rounds and --threads must be positive\n");
+    return false;
+  }
+  return true;
+}
+
+// Текущее время по монотонным часам (с)
+double now_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Счетчики процессора
+enum Counter { L1D_MISSES = 0, LLC_MISSES = 1, RAW_EVENT = 2, COUNTERS = 3 };
+
+const char *counter_names[COUNTERS] = {"L1D misses", "LLC misses", "raw"};
+std::atomic<int> counter_errno[COUNTERS]; // Ошибка открытия (0 - нет)
+
+// Счетчик c для текущего потока: дескриптор или -1
+int counter_open(int c) {
+#if defined(__linux__)
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1; // Только код бенчмарка, без ядра
+  attr.exclude_hv = 1;
+  if (c == L1D_MISSES) {
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_L1D |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  } else if (c == LLC_MISSES) {
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  } else if (raw_enabled) {
+    attr.type = PERF_TYPE_RAW;
+    attr.config = raw_config;
+  } else {
+    return -1;
+  }
+  int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  if (fd < 0) {
+    counter_errno[c].store(errno);
+  }
+  return fd;
+#else
+  counter_errno[c].store(ENOSYS);
+  return -1;
+#endif
+}
+
+struct Worker {
+  HotFields fields;          // Поля своего типа специалиста
+  long long count[COUNTERS]; // Значения счетчиков (-1 - недоступен)
+};
+
+pthread_barrier_t startLine; // Все потоки начинают одновременно
+
+void *worker_thread(void *arg) {
+  Worker *w = (Worker *)arg;
+  int fd[COUNTERS];
+  for (int c = 0; c < COUNTERS; c++) {
+    fd[c] = counter_open(c);
+  }
+  pthread_barrier_wait(&startLine);
+#if defined(__linux__)
+  for (int c = 0; c < COUNTERS; c++) {
+    if (fd[c] >= 0) {
+      ioctl(fd[c], PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd[c], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+  HotFields &f = w->fields;
+  for (int i = 0; i < rounds; i++) { // Путь пациента через очередь
+    f.referrals->fetch_add(1, std::memory_order_relaxed); // Направлен
+    f.queued->fetch_add(1);                               // Ждет в очереди
+    pthread_mutex_lock(f.lock);
+    f.queue->push(i, TRIAGE_NORMAL, 0);
+    pthread_mutex_unlock(f.lock);
+    pthread_mutex_lock(f.lock);
+    f.queue->pop();
+    pthread_mutex_unlock(f.lock);
+    f.queued->fetch_sub(1); // Ушел на прием
+    f.busy->fetch_add(1);
+    f.busy->fetch_sub(1); // Вылечен
+  }
+  for (int c = 0; c < COUNTERS; c++) {
+    w->count[c] = -1;
+#if defined(__linux__)
+    if (fd[c] >= 0) {
+      ioctl(fd[c], PERF_EVENT_IOC_DISABLE, 0);
+      long long value = 0;
+      if (read(fd[c], &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+        w->count[c] = value;
+      }
+      close(fd[c]);
+    }
+#endif
+  }
+  return NULL;
+}
+
+// Прогон одной раскладки
+void bench_layout(const char *name, HotFields (*fields)(int)) {
+  std::vector<Worker> workers(threads);
+  std::vector<pthread_t> ids(threads);
+  pthread_barrier_init(&startLine, NULL, threads + 1);
+  for (int i = 0; i < threads; i++) {
+    workers[i].fields = fields(i % 3);
+    pthread_create(&ids[i], NULL, worker_thread, &workers[i]);
+  }
+  pthread_barrier_wait(&startLine);
+  double start = now_s();
+  for (int i = 0; i < threads; i++) {
+    pthread_join(ids[i], NULL);
+  }
+  double elapsed = now_s() - start;
+  pthread_barrier_destroy(&startLine);
+
+  double passes = (double)rounds * threads; // Всего проходов пациента
+  printf("%-7s %8.1f ns/pass, %d shared lines", name,
+         elapsed * 1e9 / rounds, shared_lines(fields));
+  for (int c = 0; c < COUNTERS; c++) {
+    if (c == RAW_EVENT && !raw_enabled) {
+      continue;
+    }
+    long long total = 0; // Сумма по потокам
+    for (int i = 0; i < threads && total >= 0; i++) {
+      total = workers[i].count[c] < 0 ? -1 : total + workers[i].count[c];
+    }
+    if (total < 0) {
+      printf(", %s n/a", counter_names[c]);
+    } else {
+      printf(", %s %.3f/pass", counter_names[c], total / passes);
+    }
+  }
+  printf("\n");
+}
+
+int main(int argc, char **argv) {
+  if (!parse_args(argc, argv)) {
+    return 1;
+  }
+  printf("sizeof(PackedState) = %zu, sizeof(QueueDesk) = %zu, cache line "
+         "%zu\n",
+         sizeof(PackedState), sizeof(QueueDesk<int>), CLINIC_CACHE_LINE);
+  bench_layout("packed", packed_fields);
+  bench_layout("desk", desk_fields);
+  for (int c = 0; c < COUNTERS; c++) {
+    int error = counter_errno[c].load();
+    if (error != 0) {
+      printf("%s counter unavailable: %s (no PMU in a VM or container, or "
+             "kernel.perf_event_paranoid too high)\n",
+             counter_names[c], strerror(error));
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,131 @@
+// Утилита clinic-rng-bench: сравнивает способы выбрать специалиста для
+// пациента из нескольких потоков дежурных врачей. Каждый поток делает
+// --draws направлений подряд; печатается время на одно направление (нс) для
+// числа потоков от 1 до --threads:
+//   mt19937+mutex - общий std::mt19937 под мьютексом (корректный вариант
+//                   прежнего кода)
+//   mt19937-race  - общий std::mt19937 без блокировки (прежний код; гонка
+//                   данных, результат зависит от планировщика)
+//   philox        - workload_referral(сид, пациент) без общего состояния
+// Сборка: g++ -O2 -pthread -o clinic-rng-bench bench/ClinicRngBench.cpp
+
+#include <atomic>   // Подключаем std::atomic
+#include <cstdio>   // Подключаем printf
+#include <cstdlib>  // Подключаем atoi
+#include <cstring>  // Подключаем strcmp
+#include <ctime>    // Подключаем clock_gettime
+#include <mutex>    // Подключаем std::mutex
+#include <random>   // Подключаем std::mt19937
+#include <thread>   // Подключаем std::thread
+#include <vector>   // Подключаем std::vector
+
+#include "../ClinicWorkload.h" // Подключаем workload_referral
+
+// Параметры запуска
+int max_threads = 4;    // Наибольшее число потоков
+int draws = 2000000;    // Направлений на поток
+unsigned seed = 42;     // Сид направлений
+
+// Общее состояние вариантов с std::mt19937
+std::mt19937 shared_rng(42);
+std::uniform_int_distribution<int> shared_dist(0, 2);
+std::mutex shared_lock;
+
+// Сумма выбранных специалистов, чтобы компилятор не выбросил цикл; потоки
+// прибавляют к ней свои суммы
+std::atomic<long long> sink(0);
+
+// Функция отображения справки
+void print_help() {
+  printf("Usage: clinic-rng-bench [options]\n"
+         "Options:\n"
+         "  --threads <count>  Largest number of threads (default 4)\n"
+         "  --draws <count>    Referrals per thread (default 2000000)\n"
+         "  --seed <number>    Referral seed for philox (default 42)\n"
+         "  --help [-h]        Display this help message\n");
+}
+
+// Разбор командной строки
+bool parse_args(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      print_help();
+      exit(0);
+    } else if (i + 1 >= argc) {
+      fprintf(stderr, "Missing value for %s\n", argv[i]);
+      return false;
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      max_threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--draws") == 0) {
+      draws = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      seed = (unsigned)atol(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (max_threads < 1 || draws < 1) {
+    fprintf(stderr, "--threads and --draws must be positive\n");
+    return false;
+  }
+  return true;
+}
+
+// Текущее время по монотонным часам (с)
+double now_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Направления одного потока; пациенты потока - t, t + threads, ...
+void worker(int variant, int t, int threads) {
+  long long sum = 0;
+  for (int i = 0; i < draws; i++) {
+    int pid = t + i * threads + 1; // Номер пациента
+    if (variant == 0) {
+      std::lock_guard<std::mutex> guard(shared_lock);
+      sum += shared_dist(shared_rng);
+    } else if (variant == 1) {
+      sum += shared_dist(shared_rng);
+    } else {
+      sum += workload_referral(seed, pid, 3);
+    }
+  }
+  sink.fetch_add(sum, std::memory_order_relaxed);
+}
+
+// Время одного направления (нс) для варианта и числа потоков
+double measure(int variant, int threads) {
+  std::vector<std::thread> pool;
+  double start = now_s();
+  for (int t = 0; t < threads; t++) {
+    pool.push_back(std::thread(worker, variant, t, threads));
+  }
+  for (size_t t = 0; t < pool.size(); t++) {
+    pool[t].join();
+  }
+  double elapsed = now_s() - start;
+  return elapsed * 1e9 / ((double)draws * threads);
+}
+
+int main(int argc, char **argv) {
+  if (!parse_args(argc, argv)) {
+    return 1;
+  }
+  const char *names[3] = {"mt19937+mutex", "mt19937-race", "philox"};
+  printf("threads");
+  for (int v = 0; v < 3; v++) {
+    printf(",%s_ns", names[v]);
+  }
+  printf("\n");
+  for (int threads = 1; threads <= max_threads; threads++) {
+    printf("%d", threads);
+    for (int v = 0; v < 3; v++) {
+      printf(",%.2f", measure(v, threads));
+    }
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,149 @@
+// Утилита clinic-timer-bench: сравнивает хранилища таймеров окончания приема
+// для --engine=coro при большом числе одновременно занятых врачей:
+//   heap  - двоичная куча std::priority_queue (прежний планировщик)
+//   wheel - иерархическое колесо TimerWheel из ClinicTimerWheel.h
+// Каждый из --busy врачей держит один таймер; когда таймер срабатывает, врач
+// сразу начинает следующий прием (равномерно от 1 до 2 * --mean мс). Часы
+// виртуальные, поэтому измеряется только цена постановки и срабатывания
+// таймера. Печатается время на одно срабатывание (нс) для числа врачей от
+// 1000 до --busy с шагом x10.
+// Сборка: g++ -O2 -o clinic-timer-bench bench/ClinicTimerBench.cpp
+
+#include <cstdio>     // Подключаем printf
+#include <cstdlib>    // Подключаем atoi
+#include <cstring>    // Подключаем strcmp
+#include <ctime>      // Подключаем clock_gettime
+#include <functional> // Подключаем std::greater
+#include <queue>      // Подключаем std::priority_queue
+#include <vector>     // Подключаем std::vector
+
+#include "../ClinicTimerWheel.h" // Подключаем TimerWheel
+
+// Параметры запуска
+int max_busy = 1000000; // Наибольшее число занятых врачей
+int events = 5000000;   // Срабатываний на замер
+int mean_ms = 100;      // Среднее время приема (мс)
+int tick_us = 100;      // Тик колеса (мкс)
+
+// Сумма номеров врачей, чтобы компилятор не выбросил цикл
+volatile unsigned long long sink = 0;
+
+// Функция отображения справки
+void print_help() {
+  printf("Usage: clinic-timer-bench [options]\n"
+         "Options:\n"
+         "  --busy <count>     Largest number of busy doctors (default "
+         "1000000)\n"
+         "  --events <count>   Timer expirations per run (default 5000000)\n"
+         "  --mean <ms>        Mean service time (default 100)\n"
+         "  --tick <us>        Timer wheel tick (default 100)\n"
+         "  --help [-h]        Display this help message\n");
+}
+
+// Разбор командной строки
+bool parse_args(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      print_help();
+      exit(0);
+    } else if (i + 1 >= argc) {
+      fprintf(stderr, "Missing value for %s\n", argv[i]);
+      return false;
+    } else if (strcmp(argv[i], "--busy") == 0) {
+      max_busy = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--events") == 0) {
+      events = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--mean") == 0) {
+      mean_ms = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--tick") == 0) {
+      tick_us = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (max_busy < 1 || events < 1 || mean_ms < 1 || tick_us < 1) {
+    fprintf(stderr, "All values must be positive\n");
+    return false;
+  }
+  return true;
+}
+
+// Текущее время по монотонным часам (с)
+double now_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Следующее время приема (нс): равномерно от 1 до 2 * mean_ms мс
+uint64_t next_service(uint64_t *state) {
+  *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return 1000000ULL + (*state >> 33) % (2000000ULL * mean_ms);
+}
+
+struct HeapTimer {
+  uint64_t due; // Момент срабатывания (нс)
+  int doctor;   // Номер врача
+
+  bool operator>(const HeapTimer &other) const { return due > other.due; }
+};
+
+// Время одного срабатывания (нс) на двоичной куче
+double measure_heap(int busy) {
+  uint64_t rng = 42;
+  std::priority_queue<HeapTimer, std::vector<HeapTimer>,
+                      std::greater<HeapTimer>>
+      heap;
+  for (int d = 0; d < busy; d++) {
+    heap.push(HeapTimer{next_service(&rng), d}); // Все врачи заняты
+  }
+  unsigned long long sum = 0;
+  double start = now_s();
+  for (int i = 0; i < events; i++) {
+    HeapTimer t = heap.top(); // Ближайшее окончание приема
+    heap.pop();
+    sum += t.doctor;
+    heap.push(HeapTimer{t.due + next_service(&rng), t.doctor}); // Новый прием
+  }
+  double elapsed = now_s() - start;
+  sink = sink + sum;
+  return elapsed * 1e9 / events;
+}
+
+// Время одного срабатывания (нс) на колесе таймеров
+double measure_wheel(int busy) {
+  uint64_t rng = 42;
+  TimerWheel<int> wheel(tick_us * 1000ULL, 0);
+  for (int d = 0; d < busy; d++) {
+    wheel.add(next_service(&rng), d); // Все врачи заняты
+  }
+  std::vector<int> fired; // Врачи, закончившие прием в этом тике
+  unsigned long long sum = 0;
+  long done = 0;
+  double start = now_s();
+  while (done < events) {
+    uint64_t now = wheel.next_due_ns(); // Переводим часы к ближайшему тику
+    wheel.advance(now, [&](int d) { fired.push_back(d); });
+    for (size_t i = 0; i < fired.size(); i++) {
+      sum += fired[i];
+      wheel.add(now + next_service(&rng), fired[i]); // Новый прием
+    }
+    done += fired.size();
+    fired.clear();
+  }
+  double elapsed = now_s() - start;
+  sink = sink + sum;
+  return elapsed * 1e9 / done;
+}
+
+int main(int argc, char **argv) {
+  if (!parse_args(argc, argv)) {
+    return 1;
+  }
+  printf("busy,heap_ns,wheel_ns\n");
+  for (int busy = 1000; busy <= max_busy; busy *= 10) {
+    printf("%d,%.1f,%.1f\n", busy, measure_heap(busy), measure_wheel(busy));
+  }
+  return 0;
+}
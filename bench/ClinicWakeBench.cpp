@@ -0,0 +1,150 @@
+// Утилита clinic-wake-bench: сравнивает, как специалист будит вылеченного
+// пациента:
+//   condvar - флаг под pthread_mutex_t и pthread_cond_t (прежний Patient)
+//   futex   - OneShotEvent из ClinicMpmcQueue.h (4 байта)
+// Два сценария по --rounds событий на каждый:
+//   pingpong - два потока будят друг друга по очереди, ожидающий всегда
+//              успевает уснуть (специалист будит спящего пациента)
+//   early    - событие отмечено до ожидания (пациент вылечен, пока его поток
+//              еще не дошел до ожидания)
+// Печатается время на событие (нс), добровольные переключения контекста на
+// событие и размер объекта ожидания. Число системных вызовов можно сравнить
+// через strace -f -c.
+// Сборка: g++ -O2 -pthread -o clinic-wake-bench bench/ClinicWakeBench.cpp
+
+#include <cstdio>         // Подключаем printf
+#include <cstdlib>        // Подключаем atoi
+#include <cstring>        // Подключаем strcmp
+#include <ctime>          // Подключаем clock_gettime
+#include <pthread.h>      // Подключаем pthread_mutex_t, pthread_cond_t
+#include <sys/resource.h> // Подключаем getrusage()
+#include <vector>         // Подключаем std::vector
+
+#include "../ClinicMpmcQueue.h" // Подключаем OneShotEvent
+
+int rounds = 100000; // Событий в каждом сценарии
+
+// Прежний способ: флаг, мьютекс и условная переменная
+struct CondEvent {
+  bool done = false;
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+  void complete() {
+    pthread_mutex_lock(&lock);
+    done = true;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+  }
+
+  void wait() {
+    pthread_mutex_lock(&lock);
+    while (!done) {
+      pthread_cond_wait(&cond, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+  }
+};
+
+// Функция отображения справки
+void print_help() {
+  printf("Usage: clinic-wake-bench [options]\n"
+         "Options:\n"
+         "  --rounds <count>   Events per scenario (default 100000)\n"
+         "  --help [-h]        Display this help message\n");
+}
+
+// Разбор командной строки
+bool parse_args(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+      print_help();
+      exit(0);
+    } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return false;
+    }
+  }
+  if (rounds < 1) {
+    fprintf(stderr, "--rounds must be positive\n");
+    return false;
+  }
+  return true;
+}
+
+// Текущее время по монотонным часам (с)
+double now_s() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Добровольные переключения контекста всех потоков процесса
+long voluntary_switches() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw;
+}
+
+// События пинг-понга: ping[i] отмечает главный поток, pong[i] - второй
+template <typename Event> struct PingPong {
+  std::vector<Event> ping;
+  std::vector<Event> pong;
+  PingPong() : ping(rounds), pong(rounds) {}
+};
+
+template <typename Event> void *pong_thread(void *arg) {
+  PingPong<Event> *pp = (PingPong<Event> *)arg;
+  for (int i = 0; i < rounds; i++) {
+    pp->ping[i].wait();
+    pp->pong[i].complete();
+  }
+  return NULL;
+}
+
+// Сценарий pingpong: два события (туда и обратно) на раунд
+template <typename Event> void bench_pingpong(const char *name) {
+  PingPong<Event> *pp = new PingPong<Event>();
+  long cs = voluntary_switches();
+  double start = now_s();
+  pthread_t other;
+  pthread_create(&other, NULL, pong_thread<Event>, pp);
+  for (int i = 0; i < rounds; i++) {
+    pp->ping[i].complete();
+    pp->pong[i].wait();
+  }
+  pthread_join(other, NULL);
+  double elapsed = now_s() - start;
+  cs = voluntary_switches() - cs;
+  printf("%-8s pingpong: %8.1f ns/event, %.2f cs/event, %zu bytes\n", name,
+         elapsed * 1e9 / (2.0 * rounds), cs / (2.0 * rounds), sizeof(Event));
+  delete pp;
+}
+
+// Сценарий early: событие отмечено до ожидания, ожидание не засыпает
+template <typename Event> void bench_early(const char *name) {
+  std::vector<Event> events(rounds);
+  long cs = voluntary_switches();
+  double start = now_s();
+  for (int i = 0; i < rounds; i++) {
+    events[i].complete();
+    events[i].wait();
+  }
+  double elapsed = now_s() - start;
+  cs = voluntary_switches() - cs;
+  printf("%-8s early:    %8.1f ns/event, %.2f cs/event, %zu bytes\n", name,
+         elapsed * 1e9 / rounds, cs / (double)rounds, sizeof(Event));
+}
+
+int main(int argc, char **argv) {
+  if (!parse_args(argc, argv)) {
+    return 1;
+  }
+  bench_pingpong<CondEvent>("condvar");
+  bench_pingpong<OneShotEvent>("futex");
+  bench_early<CondEvent>("condvar");
+  bench_early<OneShotEvent>("futex");
+  return 0;
+}
@@ -0,0 +1,89 @@
+#!/bin/sh
+# Сборка трех программ клиники и прогон сетки параметров через clinic-bench.
+# Результаты дописываются в CSV (по строке на каждый запуск), чтобы сравнивать
+# способы синхронизации между собой и между версиями кода.
+#
+# Параметры задаются переменными окружения (в скобках - значения по умолчанию):
+#   NS       - числа пациентов ("100 500")
+#   TDS      - времена приема дежурного врача, мс ("5")
+#   TSS      - времена приема специалиста, мс ("10")
+#   STAFF    - штат в виде "дежурные:специалисты"
+#              ("2:dentist=1,surgeon=1,therapist=1 4:dentist=2,surgeon=2,therapist=2")
+#   VARIANTS - варианты программ ("pthread other openmp")
+#   REPEAT   - число повторов каждой точки (3)
+#   TIMEOUT  - предельное время одного запуска, с (300)
+#   EXTRA    - дополнительные аргументы программ, например "--queue=lockfree"
+#   LOCKS    - 1 - записывать захваты мьютексов и сигналы на пациента (0);
+#              счетчики есть только у ClinicMultithreadPthread с --queue=mutex
+#   OUT      - файл результатов (bench/results.csv)
+#
+# Пример: NS="500" REPEAT=5 EXTRA="--log=off" bench/run_bench.sh
+
+set -e
+cd "$(dirname "$0")/.."
+
+BUILD=bench/build
+NS=${NS:-"100 500"}
+TDS=${TDS:-"5"}
+TSS=${TSS:-"10"}
+STAFF=${STAFF:-"2:dentist=1,surgeon=1,therapist=1 4:dentist=2,surgeon=2,therapist=2"}
+VARIANTS=${VARIANTS:-"pthread other openmp"}
+REPEAT=${REPEAT:-3}
+TIMEOUT=${TIMEOUT:-300}
+EXTRA=${EXTRA:-""}
+LOCKS=${LOCKS:-0}
+OUT=${OUT:-bench/results.csv}
+CXX=${CXX:-g++}
+CXXFLAGS=${CXXFLAGS:-"-O2"}
+
+# Сборка
+mkdir -p "$BUILD"
+echo "Building into $BUILD"
+$CXX $CXXFLAGS -pthread -o "$BUILD/ClinicMultithreadPthread" \
+  ClinicMultithreadPthread.cpp
+$CXX $CXXFLAGS -pthread -o "$BUILD/ClinicMultithreadPthreadOther" \
+  ClinicMultithreadPthreadOther.cpp
+$CXX $CXXFLAGS -fopenmp -o "$BUILD/ClinicMultithreadOpenMP" \
+  ClinicMultithreadOpenMP.cpp
+$CXX $CXXFLAGS -o "$BUILD/clinic-bench" bench/ClinicBench.cpp
+
+# Имя исполняемого файла по названию варианта
+program_of() {
+  case "$1" in
+  pthread) echo "$BUILD/ClinicMultithreadPthread" ;;
+  other) echo "$BUILD/ClinicMultithreadPthreadOther" ;;
+  openmp) echo "$BUILD/ClinicMultithreadOpenMP" ;;
+  *)
+    echo "Unknown variant: $1" >&2
+    exit 1
+    ;;
+  esac
+}
+
+# Прогон сетки параметров
+LOCKS_ARG=""
+if [ "$LOCKS" = "1" ]; then
+  LOCKS_ARG="--locks"
+fi
+status=0
+for n in $NS; do
+  for td in $TDS; do
+    for ts in $TSS; do
+      for staff in $STAFF; do
+        duty=${staff%%:*}
+        specialists=${staff#*:}
+        for variant in $VARIANTS; do
+          # shellcheck disable=SC2086 # EXTRA разбивается на аргументы
+          "$BUILD/clinic-bench" --csv "$OUT" --label "$variant" \
+            --program "$(program_of "$variant")" --n "$n" --t_d "$td" \
+            --t_s "$ts" --duty "$duty" --specialists "$specialists" \
+            --repeat "$REPEAT" --timeout "$TIMEOUT" $LOCKS_ARG -- $EXTRA ||
+            status=1
+        done
+      done
+    done
+  done
+done
+
+echo "Results appended to $OUT"
+exit $status